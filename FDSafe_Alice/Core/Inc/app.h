@@ -17,10 +17,24 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include "uart.h"
 #include "fdcan.h"
 #include "cmox_crypto.h"
 #include "crypto.h"
+#include "trace.h"
+#include "histogram.h"
+#include "diag.h"
+#include "command.h"
+#include "container.h"
+#include "cordic.h"
+#include "sim.h"
+#include "isotp.h"
+#include "txpolicy.h"
+#include "rekey.h"
+#include "clock.h"
+#include "counter.h"
+#include "timesync.h"
 
 #define MILLISECONDS *1
 #define SECONDS MILLISECONDS*1000
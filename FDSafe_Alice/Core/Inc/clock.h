@@ -0,0 +1,79 @@
+/**
+ * @file clock.h
+ * @author Luan
+ * @brief CPU clock profiles with flash wait states and ART accelerator
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_CLOCK_H
+#define FDSAFE_CLOCK_H
+
+
+#include "main.h"
+
+
+/* Runs of the workload per profile in clock_benchmark() */
+#define CLOCK_BENCH_ROUNDS 200
+
+
+/*
+ * CPU clock profiles. The PLL runs at 320 MHz (VCO) from boot in every
+ * profile and is never reconfigured: its Q output (40 MHz) is the FDCAN
+ * kernel clock, so the bit timing does not depend on the profile. USART1
+ * runs from HSI for the same reason.
+ */
+typedef enum {
+	CLOCK_PROFILE_16MHZ = 0,	/* HSI, range 1, 0 wait states */
+	CLOCK_PROFILE_80MHZ,		/* PLL / 2 (AHB), range 1 boost, 2 wait states */
+	CLOCK_PROFILE_160MHZ,		/* PLL, range 1 boost, 4 wait states */
+	CLOCK_PROFILES,
+} ClockProfile;
+
+/**
+ * @brief Workload timed by clock_benchmark()
+ *
+ */
+typedef void (*ClockWorkload)();
+
+
+/**
+ * @brief Enable the ART accelerator (flash instruction and data caches)
+ *
+ */
+void clock_setup();
+
+/**
+ * @brief Switch the CPU clock to a profile
+ *
+ * The regulator is moved to boost mode before the clock goes up and back to
+ * normal mode after it goes down, the flash wait states are set by the HAL
+ * on the right side of the switch. The flash prefetch is only enabled with
+ * wait states.
+ *
+ * @param profile Clock profile
+ * @return uint8_t 1 if switched, 0 if the profile does not exist
+ */
+uint8_t clock_set_profile(ClockProfile profile);
+
+/**
+ * @brief Get the current clock profile
+ *
+ * @return ClockProfile Current profile
+ */
+ClockProfile clock_profile();
+
+/**
+ * @brief Time a workload in every profile (cycles and nanoseconds per run), then restore the current profile
+ *
+ * @param name Name of the workload
+ * @param work Workload
+ */
+void clock_benchmark(const char *name, ClockWorkload work);
+
+
+#endif
@@ -0,0 +1,68 @@
+/**
+ * @file cordic.h
+ * @author Luan
+ * @brief Sine calculation on the CORDIC coprocessor (q1.31)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_CORDIC_H
+#define FDSAFE_CORDIC_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* Iterations / 4 (6 -> 24 iterations, ~2^-19 max error, 6 cycles per sine) */
+#define CORDIC_PRECISION 6
+
+/* Samples used by the benchmark */
+#define CORDIC_BENCH_SAMPLES 64
+
+/**
+ * Phases are 32-bit accumulators where 2^32 is a full turn, so they wrap at
+ * 2*pi without any test. Read as int32_t, they are the q1.31 angle / pi
+ * expected by the CORDIC.
+ */
+#define CORDIC_PHASE_FROM_RAD(rad) ((uint32_t)((rad) * 683565275.5764316))
+
+
+/**
+ * @brief Enable the CORDIC clock and configure the sine function
+ *
+ */
+void cordic_setup();
+
+/**
+ * @brief Calculate a sine
+ *
+ * @param phase Phase (2^32 is a full turn)
+ * @return int32_t Sine in q1.31
+ */
+int32_t cordic_sin(uint32_t phase);
+
+/**
+ * @brief Calculate a batch of sines
+ *
+ * The next argument is written while the previous result is being computed,
+ * so the coprocessor never waits for the CPU.
+ *
+ * @param phases Phases (2^32 is a full turn)
+ * @param sines Sines in q1.31
+ * @param count Amount of phases
+ */
+void cordic_sin_batch(const uint32_t *phases, int32_t *sines, size_t count);
+
+/**
+ * @brief Print the cycles per sine with sin(), sinf() and the CORDIC
+ *
+ */
+void cordic_benchmark();
+
+
+#endif
@@ -0,0 +1,83 @@
+/**
+ * @file counter.h
+ * @author Luan
+ * @brief Persistent freshness counter: log-structured store in the last two flash pages
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_COUNTER_H
+#define FDSAFE_COUNTER_H
+
+
+#include "main.h"
+
+
+/* Flash pages of the store (the last two of the 128 KB part, left out of FLASH in the linker script) */
+#define COUNTER_FIRST_PAGE 62
+#define COUNTER_PAGES 2
+
+/* Values handed out per persisted reservation */
+#define COUNTER_BLOCK 1024
+
+/* Values left in the reservation when counter_poll() persists the next one */
+#define COUNTER_LOW_WATER (COUNTER_BLOCK / 2)
+
+
+/**
+ * @brief Recover the counter from flash and reserve the first block
+ *
+ * The page with the highest generation holds the log, its last valid record
+ * is the limit persisted before the reset. Values below it may have been
+ * used, so counting restarts at the limit and a new block is reserved before
+ * any value is handed out. A blank or unreadable store starts at 0 (the
+ * receiver resynchronises on the key change made at boot). Runs
+ * before the flash is written by anything else (the cycle counter must be
+ * enabled to time the recovery).
+ *
+ */
+void counter_setup();
+
+/**
+ * @brief Hand out the next counter value
+ *
+ * Never writes the flash while the reservation holds: the next block is
+ * persisted ahead of use by counter_poll(). If the reservation runs out
+ * anyway, a block is persisted right here (counted as a stall).
+ *
+ * @return uint64_t Value never handed out before, across resets
+ */
+uint64_t counter_next();
+
+/**
+ * @brief Persist the next block once the reservation is down to COUNTER_LOW_WATER values
+ *
+ * Called from the main loop, out of the transmission path.
+ *
+ */
+void counter_poll();
+
+/**
+ * @brief Print the store statistics: write amplification, erase cycles per million values and boot recovery cost
+ *
+ */
+void counter_print();
+
+/**
+ * @brief Record a double ECC error of the flash, called by the NMI handler
+ *
+ * A reset while a slot is programmed can leave it with a double ECC error,
+ * and reading it raises an NMI. An error in the store makes the recovery
+ * skip the slot as an invalid record.
+ *
+ * @param address Offset of the double-word in error from the start of the flash (FLASH_ECCR)
+ * @return uint8_t 1 if the double-word belongs to the store (the NMI is handled), 0 otherwise
+ */
+uint8_t counter_ecc_error(uint32_t address);
+
+
+#endif
@@ -20,10 +20,178 @@
 #define AUTH_TAG_SIZE 16
 #define IV_SIZE 12
 
+/* Initialization vector: key epoch, session (random per boot of the sender) and message sequence (big-endian) */
+#define IV_EPOCH_SIZE 1
+#define IV_SESSION_SIZE 3
+#define IV_SEQUENCE_SIZE 8
+
+/* Key slots: the active key and the one being distributed */
+#define KEY_SIZE 32
+#define KEY_SLOTS 2
+
+/* Key wrap (RFC 3394): wrapped key is epoch + padding (8), receiver nonce (8) and key,
+ * proof of possession is the receiver's next nonce and a zero block (8) wrapped with the new key */
+#define KEY_NONCE_SIZE 8
+#define KEY_WRAP_OVERHEAD 8
+#define KEY_WRAP_NONCE_OFFSET 8
+#define KEY_WRAP_HEADER_SIZE (KEY_WRAP_NONCE_OFFSET + KEY_NONCE_SIZE)
+#define KEY_WRAP_SIZE (KEY_WRAP_HEADER_SIZE + KEY_SIZE + KEY_WRAP_OVERHEAD)
+#define KEY_PROOF_SIZE (KEY_NONCE_SIZE + 8 + KEY_WRAP_OVERHEAD)
+
+/* Header additional data: identifier (4, big-endian), frame size (1) and padding, one GHASH block */
+#define HEADER_AAD_SIZE 16
+#define HEADER_CACHE_SIZE 16
+
+/* Windowed MAC: full tag every window, running tag fragment on every frame */
+#define MAC_TAG_SIZE 16
+#define MAC_FRAGMENT_SIZE 4
+
+#define AUTH_OK 0
+#define AUTH_ERROR 1
+
+/* Implementations of the crypto library (same output, different speed and size) */
+typedef enum {
+  CRYPTO_ENGINE_FAST = 0,     /* Fast AES, fast GHASH */
+  CRYPTO_ENGINE_SMALL,        /* Small AES, small GHASH */
+  CRYPTO_ENGINE_BALANCED,     /* Fast AES, small GHASH */
+  CRYPTO_ENGINES
+} CryptoEngine;
+
+/* Header authentication (the IV is always authenticated, it is the GCM nonce) */
+typedef enum {
+  HEADER_AAD_OFF = 0,
+  HEADER_AAD_CACHED,          /* Absorbed once per identifier, the GHASH state is restored per frame */
+  HEADER_AAD_APPEND,          /* Absorbed on every frame (reference for the cycle counts) */
+  HEADER_AAD_MODES
+} HeaderAad;
+
 
 void crypto_setup();
 
-void encrypt(uint8_t *plaintext, size_t plain_size, uint8_t *ciphertext, size_t cipher_size);
+void crypto_set_engine(CryptoEngine engine);
+
+/**
+ * @brief Select how the frame header is bound to the tag
+ * 
+ * The identifier and the frame size are authenticated as additional data, so
+ * a valid frame cannot be moved to another identifier or resized. Both sides
+ * must agree on whether it is off, the cached and appended modes give the
+ * same tags.
+ * 
+ * @param mode Header authentication mode
+ */
+void crypto_set_header_aad(HeaderAad mode);
+
+/**
+ * @brief Store a new key in the spare slot and precompute its context
+ * 
+ * The active key keeps being used until crypto_activate_key().
+ * 
+ * @param epoch Epoch of the new key
+ * @param new_key Key (KEY_SIZE bytes)
+ */
+void crypto_install_key(uint8_t epoch, const uint8_t *new_key);
+
+/**
+ * @brief Encrypt the next messages with an installed key
+ * 
+ * @param epoch Epoch of the key
+ * @return uint8_t 1 if the key was installed, 0 otherwise
+ */
+uint8_t crypto_activate_key(uint8_t epoch);
+
+/**
+ * @brief Get the epoch of the active key
+ * 
+ * @return uint8_t Epoch
+ */
+uint8_t crypto_key_epoch();
+
+/**
+ * @brief Wrap a key, its epoch and the receiver's nonce with the key-encryption key
+ * 
+ * @param epoch Epoch of the key
+ * @param nonce Nonce announced by the receiver (KEY_NONCE_SIZE bytes)
+ * @param new_key Key (KEY_SIZE bytes)
+ * @param wrapped Buffer to store the wrapped key (KEY_WRAP_SIZE bytes)
+ */
+void crypto_wrap_key(uint8_t epoch, const uint8_t *nonce, const uint8_t *new_key, uint8_t *wrapped);
+
+/**
+ * @brief Check that a receiver holds an installed key and recover its next nonce
+ * 
+ * @param epoch Epoch of the key
+ * @param proof Next nonce and zero block wrapped by the receiver with that key (KEY_PROOF_SIZE bytes)
+ * @param next_nonce Buffer to store the receiver's next nonce (KEY_NONCE_SIZE bytes)
+ * @return uint8_t AUTH_OK if the proof is valid
+ */
+uint8_t crypto_check_key_proof(uint8_t epoch, const uint8_t *proof, uint8_t *next_nonce);
+
+/**
+ * @brief Encrypt a message under the active key (ciphertext, tag and IV)
+ * 
+ * @param id Identifier of the message (authenticated with the frame size)
+ * @param plaintext Plaintext to be encrypted
+ * @param plain_size Size of the plaintext
+ * @param ciphertext Buffer to store the frame payload (plain_size + AUTH_TAG_SIZE + IV_SIZE bytes)
+ * @param cipher_size Size of the buffer
+ */
+void encrypt(uint32_t id, uint8_t *plaintext, size_t plain_size, uint8_t *ciphertext, size_t cipher_size);
+
+/**
+ * @brief Start a MAC window under the key derived from the active key slot
+ * 
+ * The window keeps its key until it is finished, even if another key is
+ * activated meanwhile.
+ * 
+ */
+void mac_window_start();
+
+/**
+ * @brief Append a frame to the MAC window
+ * 
+ * @param data Authenticated data of the frame
+ * @param size Size of the data
+ * @param fragment Buffer to store the fragment (MAC_FRAGMENT_SIZE bytes) of the tag covering the window so far
+ */
+void mac_window_append(const uint8_t *data, size_t size, uint8_t *fragment);
+
+/**
+ * @brief Close the MAC window
+ * 
+ * @param tag Buffer to store the tag (MAC_TAG_SIZE bytes) covering every frame of the window
+ */
+void mac_window_finish(uint8_t *tag);
+
+/**
+ * @brief Start encrypting a message appended in parts
+ * 
+ * The identifier and the message length are authenticated as additional
+ * data, unless the header authentication is off.
+ * 
+ * @param id Identifier of the segments
+ * @param length Plaintext length of the message
+ * @param iv_out Buffer to store the new initialization vector (IV_SIZE bytes)
+ */
+void stream_encrypt_start(uint32_t id, uint32_t length, uint8_t *iv_out);
+
+/**
+ * @brief Encrypt the next part of the message
+ * 
+ * Every part but the last one must be a multiple of 16 bytes.
+ * 
+ * @param plaintext Plaintext of the part
+ * @param size Size of the part
+ * @param ciphertext Buffer to store the ciphertext (size bytes)
+ */
+void stream_encrypt_append(const uint8_t *plaintext, size_t size, uint8_t *ciphertext);
+
+/**
+ * @brief Finish the message
+ * 
+ * @param tag Buffer to store the tag (AUTH_TAG_SIZE bytes) covering every part
+ */
+void stream_encrypt_finish(uint8_t *tag);
 
 
 #endif
\ No newline at end of file
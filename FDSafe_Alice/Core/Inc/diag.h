@@ -0,0 +1,105 @@
+/**
+ * @file diag.h
+ * @author Luan
+ * @brief Diagnostic ReadDataByIdentifier service (UDS-like) over reserved CAN IDs
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_DIAG_H
+#define FDSAFE_DIAG_H
+
+
+#include "main.h"
+#include "histogram.h"
+
+
+/* Reserved identifiers of each node (request / response) */
+#define DIAG_ALICE_REQUEST_ID 0x7E0
+#define DIAG_ALICE_RESPONSE_ID 0x7E8
+#define DIAG_BOB_REQUEST_ID 0x7E1
+#define DIAG_BOB_RESPONSE_ID 0x7E9
+
+/* Service identifiers */
+#define DIAG_SID_READ_DATA_BY_ID 0x22
+#define DIAG_POSITIVE_RESPONSE 0x40
+#define DIAG_NEGATIVE_RESPONSE 0x7F
+
+/* Negative response codes */
+#define DIAG_NRC_SERVICE_NOT_SUPPORTED 0x11
+#define DIAG_NRC_INCORRECT_LENGTH 0x13
+#define DIAG_NRC_REQUEST_OUT_OF_RANGE 0x31
+
+/* Data identifiers */
+#define DID_CONFIGURATION 0xFD00
+#define DID_COUNTERS 0xFD01
+#define DID_HISTOGRAM 0xFD10    /* + histogram index */
+#define DID_HIGH_WATER 0xFD20
+#define DID_ID_STATS 0xFD40     /* + statistics table slot */
+
+/* Response header (SID + DID) and maximum data size */
+#define DIAG_HEADER_SIZE 3
+#define DIAG_MAX_DATA_SIZE (64 - DIAG_HEADER_SIZE)
+
+
+/**
+ * @brief Application handler that fills the data of a DID
+ *
+ * @param did Data identifier
+ * @param data Buffer of DIAG_MAX_DATA_SIZE bytes
+ * @return size_t Amount of bytes written, 0 if the DID is not supported
+ */
+typedef size_t (*DiagReadHandler)(uint16_t did, uint8_t *data);
+
+
+/**
+ * @brief Setup the identifiers of this node and the data handler
+ *
+ * @param request_id Identifier of the requests to this node
+ * @param response_id Identifier of the responses from this node
+ * @param handler Data handler
+ */
+void diag_setup(uint32_t request_id, uint32_t response_id, DiagReadHandler handler);
+
+/**
+ * @brief Check if a received message is a diagnostic request to this node
+ *
+ * @param RxHeader Header of the received message
+ * @return uint8_t 1 if it is a request, 0 otherwise
+ */
+uint8_t diag_is_request(const FDCAN_RxHeaderTypeDef *RxHeader);
+
+/**
+ * @brief Answer a diagnostic request
+ *
+ * No response is sent if the TX FIFO is full.
+ *
+ * @param RxHeader Header of the received message
+ * @param data Payload of the received message
+ */
+void diag_process(const FDCAN_RxHeaderTypeDef *RxHeader, const uint8_t *data);
+
+/**
+ * @brief Write a 32-bit value (big-endian)
+ *
+ * @param data Destination
+ * @param value Value to be written
+ * @return uint8_t* Position right after the value
+ */
+uint8_t *diag_put_u32(uint8_t *data, uint32_t value);
+
+/**
+ * @brief Write a histogram summary: count, min, p50, p99 and max (20 bytes)
+ *
+ * @param data Destination
+ * @param hist Histogram
+ * @return uint8_t* Position right after the summary
+ */
+uint8_t *diag_put_hist(uint8_t *data, const Histogram *hist);
+
+
+#endif
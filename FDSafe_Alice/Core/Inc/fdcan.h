@@ -17,6 +17,11 @@
 #include "main.h"
 
 
+/* Timestamp counter unit: 16 nominal bit times (wraps every 2^20 bit times) */
+#define FDCAN_TIMESTAMP_PRESCALER FDCAN_TIMESTAMP_PRESC_16
+#define FDCAN_TIMESTAMP_BITS_PER_TICK 16
+
+
 /**
  * @brief Start FDCAN and enable the FDCAN transceiver
  * 
@@ -32,12 +37,173 @@ void fdcan_setup();
  */
 void fdcan_send(uint32_t id, uint8_t *data, size_t size);
 
+/**
+ * @brief Build and send the message, and store its TX event (start of frame timestamp)
+ * 
+ * @param id Identifier of the message
+ * @param data Payload
+ * @param size Size of the payload
+ * @param marker Marker of the TX event, read back by fdcan_tx_event()
+ */
+void fdcan_send_with_event(uint32_t id, uint8_t *data, size_t size, uint8_t marker);
+
+/**
+ * @brief Read the oldest TX event
+ * 
+ * @param marker Marker given to fdcan_send_with_event()
+ * @param timestamp Extended timestamp of the start of the frame on the bus
+ * @return uint8_t 1 if an event was read, 0 if the TX event FIFO is empty
+ */
+uint8_t fdcan_tx_event(uint8_t *marker, uint32_t *timestamp);
+
+/**
+ * @brief FDCAN timestamp counter wrap-around callback
+ * 
+ * @param hfdcan FDCAN handler
+ */
+void fdcan_timestamp_wrap_callback(FDCAN_HandleTypeDef *hfdcan);
+
+/**
+ * @brief Extend a 16-bit hardware timestamp with the wrap-around count
+ * 
+ * The event must be read less than one wrap-around period after it happened.
+ * 
+ * @param timestamp Timestamp of a TX event
+ * @return uint32_t Extended timestamp in ticks
+ */
+uint32_t fdcan_timestamp_extend(uint32_t timestamp);
+
+/**
+ * @brief Get the current value of the timestamp counter, extended
+ * 
+ * @return uint32_t Extended timestamp in ticks
+ */
+uint32_t fdcan_timestamp_now();
+
+/**
+ * @brief Convert timestamp ticks to microseconds
+ * 
+ * @param ticks Amount of ticks
+ * @return uint32_t Time in microseconds
+ */
+uint32_t fdcan_timestamp_to_usec(uint32_t ticks);
+
+/**
+ * @brief Send the message, cancelling the frames of the same identifier still pending in the TX FIFO
+ * 
+ * Only the latest value of the identifier is sent: bus time is not spent on
+ * stale frames under congestion. A cancelled frame behind the head of the
+ * TX FIFO does not free its slot, so the new frame is staged (and moved to
+ * the TX FIFO by the TX complete interrupt) while the TX FIFO is full, and
+ * a replacement is only counted when a slot is free. If the stage is full
+ * too (with other identifiers), the value is dropped and counted.
+ * 
+ * @param id Identifier of the message
+ * @param data Payload
+ * @param size Size of the payload
+ */
+void fdcan_send_latest(uint32_t id, uint8_t *data, size_t size);
+
+/**
+ * @brief Enable or disable the CPU/TX pipeline
+ * 
+ * When enabled, frames sent while the TX FIFO is full are staged in a
+ * double buffer and moved to the TX FIFO by the TX complete interrupt, so the
+ * next frames are built and encrypted while the previous ones are on the bus.
+ * The staged frames are sent before the pipeline is disabled.
+ * 
+ * @param enabled 1 to stage frames ahead of the TX FIFO
+ */
+void fdcan_set_pipeline(uint8_t enabled);
+
+/**
+ * @brief FDCAN TX complete callback (moves the staged frames to the TX FIFO)
+ * 
+ * @param hfdcan FDCAN handler
+ * @param BufferIndexes Buffers whose transmission completed
+ */
+void fdcan_tx_complete_callback(FDCAN_HandleTypeDef *hfdcan, uint32_t BufferIndexes);
+
+/**
+ * @brief Setup FDCAN filter (diagnostic requests only)
+ * 
+ */
+void fdcan_filter_setup();
+
+/**
+ * @brief Check if there is any messages available on FIFO0
+ * 
+ * @return uint32_t Amount of messages available
+ */
+uint32_t fdcan_available();
+
+/**
+ * @brief Read a message from FIFO0
+ * 
+ * @param RxHeader Structure to store the message header
+ * @param RxData Buffer to store the message data
+ */
+void fdcan_read(FDCAN_RxHeaderTypeDef *RxHeader, uint8_t *RxData);
+
 /**
  * @brief Check it is possible to send a new message
  * 
- * @return uint8_t 0 if not free, or >1 if free
+ * @return uint8_t 0 if not free (TX FIFO and, with the pipeline, staging buffers full), or >1 if free
  */
 uint8_t fdcan_free_to_send();
 
+/**
+ * @brief Get the amount of messages sent
+ * 
+ * @return uint32_t Messages added to the TX FIFO
+ */
+uint32_t fdcan_tx_count();
+
+/**
+ * @brief Get the highest amount of messages pending in the TX FIFO
+ * 
+ * @return uint32_t TX FIFO high-water mark
+ */
+uint32_t fdcan_tx_high_water();
+
+/**
+ * @brief Get the amount of stale frames replaced before being sent
+ * 
+ * @return uint32_t Frames cancelled by fdcan_send_latest()
+ */
+uint32_t fdcan_tx_replaced();
+
+/**
+ * @brief Get the amount of latest values dropped because the stage and the TX FIFO were full
+ * 
+ * @return uint32_t Frames dropped by fdcan_send_latest()
+ */
+uint32_t fdcan_tx_dropped();
+
+/**
+ * @brief Enable or disable the bit rate switch of the next messages
+ * 
+ * @param enabled 1 to send the data phase at the data bit rate
+ */
+void fdcan_set_brs(uint8_t enabled);
+
+/**
+ * @brief Get the smallest valid CAN FD payload size able to hold a payload
+ * 
+ * @param size Size of the payload
+ * @return size_t Valid payload size (64 at most)
+ */
+size_t fdcan_frame_size(size_t size);
+
+/**
+ * @brief Estimate the time a message takes on the bus
+ * 
+ * Standard ID, current bit rate switch setting, dynamic stuff bits not counted.
+ * 
+ * @param size Valid payload size
+ * @return uint32_t Frame time in nanoseconds (interframe space included)
+ */
+uint32_t fdcan_frame_time_ns(size_t size);
+
 
 #endif
\ No newline at end of file
@@ -0,0 +1,94 @@
+/**
+ * @file isotp.h
+ * @author Luan
+ * @brief Segmented transmission (ISO-TP-like) of messages encrypted on the fly
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_ISOTP_H
+#define FDSAFE_ISOTP_H
+
+
+#include "main.h"
+#include "crypto.h"
+
+
+/* Reserved identifiers (segments from Alice / flow control from Bob) */
+#define ISOTP_DATA_ID 0x600
+#define ISOTP_FC_ID 0x601
+
+/* Protocol control information (high nibble of the first byte) */
+#define ISOTP_PCI_FIRST 0x10
+#define ISOTP_PCI_CONSECUTIVE 0x20
+#define ISOTP_PCI_FLOW_CONTROL 0x30
+
+/* Flow status (low nibble of a flow control frame) */
+#define ISOTP_FLOW_CTS 0
+#define ISOTP_FLOW_WAIT 1
+#define ISOTP_FLOW_OVERFLOW 2
+
+/* Frame layout: first frame PCI + length (4) + IV, consecutive frame PCI */
+#define ISOTP_FRAME_SIZE 64
+#define ISOTP_FF_HEADER_SIZE (1 + 4 + IV_SIZE)
+#define ISOTP_CF_HEADER_SIZE 1
+
+/* Largest plaintext accepted by the receiver */
+#define ISOTP_MAX_MESSAGE_SIZE 8192
+
+/* Time without a flow control frame before the transfer is aborted */
+#define ISOTP_TIMEOUT 1000
+
+
+/**
+ * @brief Application handler that fills a slice of the plaintext
+ *
+ * @param offset Position of the slice in the message
+ * @param data Buffer of size bytes
+ * @param size Size of the slice
+ */
+typedef void (*IsotpSource)(uint32_t offset, uint8_t *data, size_t size);
+
+
+/**
+ * @brief Start sending a message
+ *
+ * Only the first frame is sent here (or by isotp_poll() once the TX FIFO has
+ * room), the consecutive frames are sent by isotp_poll() as the receiver
+ * grants them. The plaintext is requested from
+ * the source and encrypted one frame ahead, so the message is never held
+ * whole: the stream carried by the frames is the ciphertext followed by the tag.
+ *
+ * @param length Plaintext size (1 to ISOTP_MAX_MESSAGE_SIZE)
+ * @param source Plaintext handler
+ * @return uint8_t 1 if the transfer started, 0 if another one is in progress
+ */
+uint8_t isotp_send(uint32_t length, IsotpSource source);
+
+/**
+ * @brief Send the pending first frame or the next consecutive frame when allowed and check the flow control timeout
+ *
+ */
+void isotp_poll();
+
+/**
+ * @brief Check if a received message is a flow control frame for this node
+ *
+ * @param RxHeader Header of the received message
+ * @return uint8_t 1 if it is a flow control frame, 0 otherwise
+ */
+uint8_t isotp_is_flow_control(const FDCAN_RxHeaderTypeDef *RxHeader);
+
+/**
+ * @brief Apply a flow control frame (continue, wait or abort)
+ *
+ * @param data Payload of the received message
+ */
+void isotp_flow_control(const uint8_t *data);
+
+
+#endif
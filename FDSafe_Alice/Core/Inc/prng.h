@@ -0,0 +1,55 @@
+/**
+ * @file prng.h
+ * @author Luan
+ * @brief Fast pseudo-random number generator (xoshiro128**) for the simulations
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_PRNG_H
+#define FDSAFE_PRNG_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * @brief Seed the generator once from the hardware RNG
+ *
+ * Not suitable for cryptographic use: keys and IVs keep using the hardware RNG.
+ */
+void prng_setup();
+
+/**
+ * @brief Get the next pseudo-random number
+ *
+ * @return uint32_t Pseudo-random number
+ */
+uint32_t prng_next();
+
+/**
+ * @brief Fill a buffer with pseudo-random numbers
+ *
+ * @param values Buffer
+ * @param count Amount of numbers
+ */
+void prng_fill(uint32_t *values, size_t count);
+
+/**
+ * @brief Map a pseudo-random number to [0, range) without a division
+ *
+ * @param value Pseudo-random number
+ * @param range Amount of possible results
+ * @return uint32_t Number in [0, range)
+ */
+static inline uint32_t prng_range(uint32_t value, uint32_t range) {
+	return (uint32_t)(((uint64_t)value * range) >> 32);
+}
+
+
+#endif
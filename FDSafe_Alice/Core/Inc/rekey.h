@@ -0,0 +1,102 @@
+/**
+ * @file rekey.h
+ * @author Luan
+ * @brief Distribution of new keys over the bus, switched without losing messages
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_REKEY_H
+#define FDSAFE_REKEY_H
+
+
+#include "main.h"
+#include "crypto.h"
+
+
+/* Reserved identifiers (wrapped key from Alice / acknowledgement from Bob / nonce from Bob / nonce request from Alice) */
+#define ID_KEY_UPDATE 0x050
+#define ID_KEY_ACK 0x051
+#define ID_KEY_NONCE 0x052
+#define ID_KEY_REQUEST 0x053
+
+/* Acknowledgement: epoch, padding (7) and proof of possession of the new key */
+#define KEY_ACK_PROOF_OFFSET 8
+#define KEY_ACK_SIZE (KEY_ACK_PROOF_OFFSET + KEY_PROOF_SIZE)
+
+/* Nonce: active epoch of the receiver, padding (7) and the nonce the next key update must carry */
+#define KEY_NONCE_OFFSET 8
+#define KEY_NONCE_FRAME_SIZE (KEY_NONCE_OFFSET + KEY_NONCE_SIZE)
+
+/* Interval between two key updates without acknowledgement, and updates sent before giving up */
+#define REKEY_RETRY_INTERVAL 100
+#define REKEY_MAX_ATTEMPTS 5
+
+/* Minimum interval between two distributions started on an unsolicited nonce */
+#define REKEY_RESTART_INTERVAL 1000
+
+
+/**
+ * @brief Start distributing a new key
+ *
+ * The key is drawn from the RNG, its context is precomputed in the spare slot
+ * and it is sent wrapped with the key-encryption key and bound to the
+ * receiver's nonce by rekey_poll(). Without an unused nonce, one is
+ * requested first. The epoch is the one after Alice's active epoch. If the
+ * update is not acknowledged, a new nonce is requested once and the next
+ * epoch tried. The messages are encrypted with the current key until
+ * the receiver acknowledges the new one, then the next message uses the new
+ * key.
+ *
+ * @return uint8_t 1 if the distribution started, 0 if another one is in progress
+ */
+uint8_t rekey_start();
+
+/**
+ * @brief Send the nonce request or the key update when the TX FIFO has room, resend them without answer
+ *
+ */
+void rekey_poll();
+
+/**
+ * @brief Check if a received message is a key acknowledgement
+ *
+ * @param RxHeader Header of the received message
+ * @return uint8_t 1 if it is a key acknowledgement, 0 otherwise
+ */
+uint8_t rekey_is_ack(const FDCAN_RxHeaderTypeDef *RxHeader);
+
+/**
+ * @brief Switch to the new key if the acknowledgement proves the receiver holds it
+ *
+ * @param data Payload of the received message
+ */
+void rekey_ack(const uint8_t *data);
+
+/**
+ * @brief Check if a received message is a receiver nonce
+ *
+ * @param RxHeader Header of the received message
+ * @return uint8_t 1 if it is a receiver nonce, 0 otherwise
+ */
+uint8_t rekey_is_nonce(const FDCAN_RxHeaderTypeDef *RxHeader);
+
+/**
+ * @brief Bind the key update to a nonce of the receiver
+ *
+ * The nonce is not authenticated, so it is only taken while Alice waits for
+ * the answer to her request, and its epoch is ignored. An unsolicited nonce
+ * (the receiver announces one after its reset) only makes Alice request a
+ * new one, at most once per REKEY_RESTART_INTERVAL and never during a
+ * distribution.
+ *
+ * @param data Payload of the received message
+ */
+void rekey_nonce(const uint8_t *data);
+
+
+#endif
@@ -0,0 +1,89 @@
+/**
+ * @file sim.h
+ * @author Luan
+ * @brief Table-driven signal simulator
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_SIM_H
+#define FDSAFE_SIM_H
+
+
+#include <stdint.h>
+
+
+/* Maximum amount of simulated signals */
+#define SIM_MAX_SIGNALS 128
+
+
+/* Signal behaviour */
+typedef enum {
+	SIM_OSCILLATING = 0,	/* Sine wave over the range with random jitter */
+	SIM_CUMULATIVE,			/* Random initial value with random increments (or decrements) */
+} SimKind;
+
+/* Signal definition */
+typedef struct {
+	SimKind kind;
+	int32_t min_value;
+	int32_t max_value;
+	uint32_t phase_step;	/* Phase increment per update (oscillating) */
+	int32_t variation;		/* Jitter amplitude (oscillating) or maximum increment, negative to decrement (cumulative) */
+	uint32_t updt_interval;
+} SimSignal;
+
+
+/**
+ * @brief Remove every signal and seed the pseudo-random number generator
+ *
+ */
+void sim_setup();
+
+/**
+ * @brief Add a signal to the table
+ *
+ * @param signal Signal definition
+ * @return int32_t Signal index, -1 if the table is full
+ */
+int32_t sim_add(const SimSignal *signal);
+
+/**
+ * @brief Remove the signals from a given index on
+ *
+ * @param count Amount of signals kept
+ */
+void sim_truncate(uint32_t count);
+
+/**
+ * @brief Get the amount of signals in the table
+ *
+ * @return uint32_t Amount of signals
+ */
+uint32_t sim_count();
+
+/**
+ * @brief Update every due signal in a single pass
+ *
+ * The sines of the due oscillating signals are calculated in one CORDIC batch
+ * and the random numbers are drawn in bulk.
+ *
+ * @param now Current tick
+ * @return uint32_t Amount of updated signals
+ */
+uint32_t sim_update(uint32_t now);
+
+/**
+ * @brief Get the current value of a signal
+ *
+ * @param index Signal index
+ * @return int32_t Current value
+ */
+int32_t sim_value(uint32_t index);
+
+
+#endif
@@ -0,0 +1,55 @@
+/**
+ * @file timesync.h
+ * @author Luan
+ * @brief Bus time synchronisation, master side (sync and follow-up frames)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_TIMESYNC_H
+#define FDSAFE_TIMESYNC_H
+
+
+#include "main.h"
+
+
+/* Reserved identifiers (high priority, sent by the master) */
+#define TIMESYNC_SYNC_ID 0x010
+#define TIMESYNC_FOLLOW_UP_ID 0x011
+
+/* Frames: sequence (1), padding (3) and master time in timestamp ticks (4, little-endian) */
+#define TIMESYNC_FRAME_SIZE 8
+
+
+/**
+ * @brief Set the interval between synchronisations
+ *
+ * @param interval Interval in milliseconds (0: no synchronisation)
+ */
+void timesync_set_interval(uint32_t interval);
+
+/**
+ * @brief Send the sync frame when due, and its follow-up once its TX event is available
+ *
+ * The master time is the extended FDCAN timestamp counter of this node. The
+ * sync frame carries its value when the frame is queued, the follow-up the
+ * start of frame timestamp of the sync frame on the bus (TX event), which is
+ * the same instant the receivers stamp it. A sync frame whose event is lost
+ * is replaced by the next one.
+ *
+ */
+void timesync_poll();
+
+/**
+ * @brief Get the current master time
+ *
+ * @return uint32_t Master time in timestamp ticks
+ */
+uint32_t timesync_now();
+
+
+#endif
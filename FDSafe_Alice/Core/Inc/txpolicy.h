@@ -0,0 +1,71 @@
+/**
+ * @file txpolicy.h
+ * @author Luan
+ * @brief Transmission policies (periodic, on change, on change with heartbeat)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_TXPOLICY_H
+#define FDSAFE_TXPOLICY_H
+
+
+#include <stdint.h>
+
+
+/* When a message is sent */
+typedef enum {
+	TX_PERIODIC = 0,			/* Every interval */
+	TX_ON_CHANGE,				/* When the value moves beyond the deadband, at most once per interval */
+	TX_ON_CHANGE_HEARTBEAT,		/* On change, and at least once per heartbeat interval */
+	TX_POLICIES
+} TxPolicy;
+
+/* Policy of a message */
+typedef struct {
+	TxPolicy policy;
+	uint32_t interval;		/* Period (periodic) or minimum interval (on change) */
+	uint32_t heartbeat;		/* Maximum interval (on change with heartbeat) */
+	uint32_t deadband;		/* Largest change not sent (encoded units) */
+} TxPolicyConfig;
+
+/* Last transmission of a message */
+typedef struct {
+	uint8_t sent;
+	uint32_t last_value;
+	uint32_t last_time;
+	uint32_t last_check;	/* Last sent or suppressed interval */
+} TxPolicyState;
+
+
+/**
+ * @brief Decide if a message is sent now, and account the decision
+ *
+ * The first evaluation of a message always sends it.
+ *
+ * @param config Policy of the message
+ * @param state Last transmission of the message (updated when sent)
+ * @param value Current encoded value
+ * @param now Current tick
+ * @return uint8_t 1 if the message is sent, 0 otherwise
+ */
+uint8_t txpolicy_check(const TxPolicyConfig *config, TxPolicyState *state, uint32_t value, uint32_t now);
+
+/**
+ * @brief Print the frames sent and suppressed by each policy, and their rate
+ *
+ */
+void txpolicy_print();
+
+/**
+ * @brief Clear the counters
+ *
+ */
+void txpolicy_reset();
+
+
+#endif
@@ -12,325 +12,815 @@
 
 #include <app.h>
 #include "main.h"
+#include "ram.h"
 
 
+/* Default operating modes (changed at run time through the UART command channel) */
 #define ENCRYPTION_ENABLED 1
 #define SIMULATIONS 1
+#define BRS_ENABLED 0
+#define AGGREGATION 0
+#define MAC_WINDOW 0
+#define TX_POLICY 1
+#define LATEST_VALUE 0
+#define TX_PIPELINE 1
+#define CLOCK_PROFILE CLOCK_PROFILE_160MHZ
 
 /* Message parameters */
 #define DATA_SIZE 20
 #define EMPTY_BYTE_VALUE 0xFF
+#define RX_DATA_SIZE 64
+#define MAX_FRAME_SIZE 64
 
-#if SIMULATIONS
 #define ID_ENGINE_CONTROLLER 0x6F
 #define ID_TACHOGRAPH 0x14D
 #define ID_ENGINE_TEMPERATURE 0x309
 #define ID_FUEL 0x3E7
 #define ID_DISTANCE 0x7B5
+#define ID_STATISTICS 0x1F
+#define ID_BENCH_END 0x1E
+#define ID_CONTAINER 0x3A0
+#define ID_MAC_WINDOW 0x70
+
+/* Windowed MAC frames: payload (8), sequence (4) and running tag fragment (4) */
+#define WINDOW_PAYLOAD_SIZE 8
+#define WINDOW_FRAME_SIZE (WINDOW_PAYLOAD_SIZE + 4 + MAC_FRAGMENT_SIZE)
+
+/* Window tag frames: first sequence (4), frame count (1), padding (3) and tag */
+#define WINDOW_TAG_FRAME_SIZE (8 + MAC_TAG_SIZE)
+#define MAC_WINDOW_MAX 32
 
 #define FREQ_INTERVAL_HI 25 MILLISECONDS
 #define FREQ_INTERVAL_ST 100 MILLISECONDS
 #define FREQ_INTERVAL_LO 1 SECONDS
-#else
-#define ID_STATISTICS 0x1F
-#endif
+
+/* Maximum interval of the messages sent on change with heartbeat */
+#define HEARTBEAT_INTERVAL 10 SECONDS
+
+/* Statistics messages are sent as soon as the TX FIFO has room */
+#define FREQ_INTERVAL_STATISTICS 0 MILLISECONDS
+
+/* Throughput benchmark (simulations disabled): plaintext payload size and run duration */
+#define BENCH_SIZE DATA_SIZE
+#define BENCH_DURATION 10 SECONDS
+
+/* Extra signals simulated for load testing (not transmitted) */
+#define SIM_LOAD 0
+
+/* Size of the segmented test message and its content (checked by Bob) */
+#define SEGMENT_SIZE 1024
+#define SEGMENT_PATTERN(i) ((uint8_t)((i) * 31 + 7))
+
+/* Interval between automatic key changes (0: only on the rekey command) */
+#define REKEY_INTERVAL 0
+
+/* Interval between bus time synchronisations (0: disabled) */
+#define SYNC_INTERVAL 1 SECONDS
 
 
-#if SIMULATIONS
-/* Simulated variable struct */
+/* Runtime configuration struct */
 typedef struct {
-	float value;
-	uint32_t max_value;
-	uint32_t min_value;
-	float time;
-	float time_step;
-	int variation;
-	uint32_t updt_interval;
-	uint32_t next_updt;
-} SimulatedVar;
-#endif
+	uint32_t encryption;
+	uint32_t simulations;
+	uint32_t interval_hi;
+	uint32_t interval_st;
+	uint32_t interval_lo;
+	uint32_t heartbeat;
+	uint32_t tx_policy;
+	uint32_t latest_value;
+	uint32_t pipeline;
+	uint32_t interval_statistics;
+	uint32_t crypto_engine;
+	uint32_t header_aad;
+	uint32_t sim_load;
+	uint32_t brs;
+	uint32_t aggregation;
+	uint32_t mac_window;
+	uint32_t bench_size;
+	uint32_t bench_duration;
+	uint32_t segment_size;
+	uint32_t rekey_interval;
+	uint32_t clock;
+	uint32_t sync_interval;
+} Config;
+
+static Config config = {
+	.encryption = ENCRYPTION_ENABLED,
+	.simulations = SIMULATIONS,
+	.interval_hi = FREQ_INTERVAL_HI,
+	.interval_st = FREQ_INTERVAL_ST,
+	.interval_lo = FREQ_INTERVAL_LO,
+	.heartbeat = HEARTBEAT_INTERVAL,
+	.tx_policy = TX_POLICY,
+	.latest_value = LATEST_VALUE,
+	.pipeline = TX_PIPELINE,
+	.interval_statistics = FREQ_INTERVAL_STATISTICS,
+	.crypto_engine = CRYPTO_ENGINE_FAST,
+	.header_aad = HEADER_AAD_CACHED,
+	.sim_load = SIM_LOAD,
+	.brs = BRS_ENABLED,
+	.aggregation = AGGREGATION,
+	.mac_window = MAC_WINDOW,
+	.bench_size = BENCH_SIZE,
+	.bench_duration = BENCH_DURATION,
+	.segment_size = SEGMENT_SIZE,
+	.rekey_interval = REKEY_INTERVAL,
+	.clock = CLOCK_PROFILE,
+	.sync_interval = SYNC_INTERVAL,
+};
+
+/* Throughput benchmark run */
+static struct {
+	uint32_t run;
+	uint32_t start;
+	uint32_t frames;
+	uint32_t payload_size;
+	uint64_t payload_bytes;
+	uint64_t encrypt_cycles;
+	uint8_t marker_pending;		/* End marker of the last run not sent yet (no room in the TX FIFO) */
+	uint8_t marker[8];
+} bench;
+
+/* Window of the engine speed stream authenticated with a single MAC */
+static struct {
+	uint32_t seq;
+	uint32_t first_seq;
+	uint32_t count;
+} window;
+
+/* Encryption, simulation and windowed MAC (per frame and per window) cycles histograms */
+static Histogram hist_encrypt RAM_LOGS;
+static Histogram hist_simulate RAM_LOGS;
+static Histogram hist_mac_frame RAM_LOGS;
+static Histogram hist_mac_window RAM_LOGS;
+
+/* Simulated signals (indexes in the simulator table) */
+typedef enum {
+	SIG_ENG_SPEED = 0,
+	SIG_ENG_TEMPERATURE,
+	SIG_VEHICLE_SPEED,
+	SIG_VEHICLE_DISTANCE,
+	SIG_FUEL_LEVEL,
+	SIGNALS,
+} Signal;
+
+static const SimSignal signals[SIGNALS] = {
+	[SIG_ENG_SPEED] = {SIM_OSCILLATING, 800, 7000, CORDIC_PHASE_FROM_RAD(0.01), 100, 25 MILLISECONDS},
+	[SIG_ENG_TEMPERATURE] = {SIM_OSCILLATING, 60, 100, CORDIC_PHASE_FROM_RAD(0.01), 3, 2 SECONDS},
+	[SIG_VEHICLE_SPEED] = {SIM_OSCILLATING, 0, 120, CORDIC_PHASE_FROM_RAD(0.01), 7, 1 SECONDS},
+	[SIG_VEHICLE_DISTANCE] = {SIM_CUMULATIVE, 0, 1000000000, 0, 150, 10 SECONDS},
+	[SIG_FUEL_LEVEL] = {SIM_CUMULATIVE, 20, 100, 0, -1, 60 SECONDS},
+};
+
+/* Signal added sim_load times for load testing (40 Hz) */
+static const SimSignal load_signal = {SIM_OSCILLATING, 0, 1000, CORDIC_PHASE_FROM_RAD(0.01), 10, 25 MILLISECONDS};
+
+/* Transmitted message: encoding of its signal and transmission policy */
+typedef struct {
+	uint32_t id;
+	Signal signal;
+	int32_t offset;			/* Encoded value: (value + offset) * scale_num / scale_den */
+	uint32_t scale_num;
+	uint32_t scale_den;
+	uint8_t position;		/* First byte of the encoded value in the payload (little-endian) */
+	uint8_t length;
+	TxPolicy policy;
+	uint32_t *interval;		/* Period or minimum interval (runtime parameter) */
+	uint32_t deadband;
+} TxMessage;
+
+static const TxMessage tx_messages[] = {
+	{ID_ENGINE_CONTROLLER, SIG_ENG_SPEED, 0, 8, 1, 4, 2, TX_PERIODIC, &config.interval_hi, 0},
+	{ID_TACHOGRAPH, SIG_VEHICLE_SPEED, 0, 256, 1, 6, 2, TX_ON_CHANGE_HEARTBEAT, &config.interval_st, 0},
+	{ID_ENGINE_TEMPERATURE, SIG_ENG_TEMPERATURE, 40, 1, 1, 7, 1, TX_ON_CHANGE_HEARTBEAT, &config.interval_lo, 0},
+	{ID_FUEL, SIG_FUEL_LEVEL, 0, 5, 2, 1, 1, TX_ON_CHANGE_HEARTBEAT, &config.interval_lo, 0},
+	{ID_DISTANCE, SIG_VEHICLE_DISTANCE, 0, 1, 5, 0, 4, TX_ON_CHANGE_HEARTBEAT, &config.interval_lo, 0},
+};
+
+#define TX_MESSAGES (sizeof(tx_messages) / sizeof(tx_messages[0]))
+
+/* Last transmission of each message */
+static TxPolicyState tx_state[TX_MESSAGES] RAM_TABLES;
 
 /* Static function prototypes */
-#if SIMULATIONS
-static void simulate_osc_value(SimulatedVar *variable);
-static void simulate_cumul_value(SimulatedVar *variable);
+static uint32_t send_message(uint32_t id, uint8_t *data, size_t size);
+static void send_due_messages(Container *container, uint8_t *data);
+static uint8_t is_latest_value(uint32_t id);
+static void send_signal(Container *container, uint32_t id, uint8_t *data, uint8_t offset, uint8_t length);
+static void flush_container(Container *container);
+static void send_window_frame(uint32_t id, uint8_t *data);
+static void close_window();
+static size_t bench_payload_size();
+static void bench_finish();
+static void send_bench_marker();
+static void segment_source(uint32_t offset, uint8_t *data, size_t size);
+static void send_segmented();
+static void start_rekey();
 static void print_data(uint32_t id, uint8_t *data, size_t size);
-#else
-#if ENCRYPTION_ENABLED
 static uint32_t get_clock_cycles();
-#endif
-#endif
 static void clear_data(uint8_t *data, uint8_t size, uint8_t value);
+static size_t read_did(uint16_t did, uint8_t *data);
+static void apply_crypto_engine(uint32_t engine);
+static void apply_header_aad(uint32_t mode);
+static void apply_sim_load(uint32_t load);
+static void apply_brs(uint32_t enabled);
+static void apply_pipeline(uint32_t enabled);
+static void apply_mac_window(uint32_t frames);
+static void apply_clock(uint32_t profile);
+static void apply_sync_interval(uint32_t interval);
+static void clock_workload();
+static void clock_bench();
+static void print_histograms();
+static void reset_histograms();
+
+
+/* Parameters changed through the UART command channel */
+static const CommandParam params[] = {
+	{"encryption", &config.encryption, 0, 1, NULL},
+	{"simulations", &config.simulations, 0, 1, NULL},
+	{"interval_hi", &config.interval_hi, 1, 60 SECONDS, NULL},
+	{"interval_st", &config.interval_st, 1, 60 SECONDS, NULL},
+	{"interval_lo", &config.interval_lo, 1, 60 SECONDS, NULL},
+	{"heartbeat", &config.heartbeat, 1, 600 SECONDS, NULL},
+	{"tx_policy", &config.tx_policy, 0, 1, NULL},
+	{"latest_value", &config.latest_value, 0, 1, NULL},
+	{"pipeline", &config.pipeline, 0, 1, apply_pipeline},
+	{"interval_statistics", &config.interval_statistics, 0, 60 SECONDS, NULL},
+	{"engine", &config.crypto_engine, 0, CRYPTO_ENGINES - 1, apply_crypto_engine},
+	{"header_aad", &config.header_aad, 0, HEADER_AAD_MODES - 1, apply_header_aad},
+	{"sim_load", &config.sim_load, 0, SIM_MAX_SIGNALS - SIGNALS, apply_sim_load},
+	{"brs", &config.brs, 0, 1, apply_brs},
+	{"aggregation", &config.aggregation, 0, 1, NULL},
+	{"mac_window", &config.mac_window, 0, MAC_WINDOW_MAX, apply_mac_window},
+	{"bench_size", &config.bench_size, 4, MAX_FRAME_SIZE, NULL},
+	{"bench_duration", &config.bench_duration, 100 MILLISECONDS, 600 SECONDS, NULL},
+	{"segment_size", &config.segment_size, 1, ISOTP_MAX_MESSAGE_SIZE, NULL},
+	{"rekey_interval", &config.rekey_interval, 0, 3600 SECONDS, NULL},
+	{"clock", &config.clock, 0, CLOCK_PROFILES - 1, apply_clock},
+	{"sync_interval", &config.sync_interval, 0, 60 SECONDS, apply_sync_interval},
+};
+
+/* Actions triggered through the UART command channel */
+static const CommandAction actions[] = {
+	{"stats", print_histograms},
+	{"reset", reset_histograms},
+	{"trace", trace_dump},
+	{"cordic", cordic_benchmark},
+	{"bench", bench_finish},
+	{"segment", send_segmented},
+	{"rekey", start_rekey},
+	{"clockbench", clock_bench},
+};
 
 void fdsafe_setup() {
 
+	uart_setup();
+	clock_setup();
+	clock_set_profile(config.clock);
     fdcan_setup();
+	fdcan_set_brs(config.brs);
+	fdcan_set_pipeline(config.pipeline);
+	timesync_set_interval(config.sync_interval);
 	crypto_setup();
+	crypto_set_engine(config.crypto_engine);
+	crypto_set_header_aad(config.header_aad);
+	cordic_setup();
+
+	sim_setup();
+	for (uint32_t i = 0; i < SIGNALS; i++) {
+		sim_add(&signals[i]);
+	}
+	apply_sim_load(config.sim_load);
+
+	hist_init(&hist_encrypt, "encrypt");
+	hist_init(&hist_simulate, "simulate");
+	hist_init(&hist_mac_frame, "mac_frame");
+	hist_init(&hist_mac_window, "mac_window");
+	txpolicy_reset();
+
+	diag_setup(DIAG_ALICE_REQUEST_ID, DIAG_ALICE_RESPONSE_ID, read_did);
+	command_setup(params, sizeof(params) / sizeof(params[0]), actions, sizeof(actions) / sizeof(actions[0]));
 	    
     // enable core debug timers
     SET_BIT(CoreDebug->DEMCR, CoreDebug_DEMCR_TRCENA_Msk);
 
     // enable the clock counter
     SET_BIT(DWT->CTRL, DWT_CTRL_CYCCNTENA_Msk);
+
+	/* Recover the IV sequence from flash (timed with the clock counter) */
+	counter_setup();
+
+	/* The keys are not persisted: Bob may hold a later epoch, so resynchronise with a new key */
+	rekey_start();
 }
 
 void fdsafe_main() {
 
-#if SIMULATIONS
-    SimulatedVar eng_speed = {
-		.value = 0.0,
-		.max_value = 7000,
-		.min_value = 800,
-		.time = 0.0,
-		.time_step = 0.01,
-		.variation = 100,
-		.updt_interval = 25 MILLISECONDS,
-		.next_updt = 0,
-	};
-	SimulatedVar eng_temperature = {
-		.value = 0.0,
-		.max_value = 100,
-		.min_value = 60,
-		.time = 0.0,
-		.time_step = 0.01,
-		.variation = 3,
-		.updt_interval = 2 SECONDS,
-		.next_updt = 0,
-	};
-	SimulatedVar vehicle_speed = {
-		.value = 0.0,
-		.max_value = 120,
-		.min_value = 0,
-		.time = 0.0,
-		.time_step = 0.01,
-		.variation = 7,
-		.updt_interval = 1 SECONDS,
-		.next_updt = 0,
-	};
-	SimulatedVar vehicle_distance = {
-		.value = 0.0,
-		.max_value = 1000000000,
-		.min_value = 0.0,
-		.time = 0.0,
-		.time_step = 0.0,
-		.variation = 150,
-		.updt_interval = 10 SECONDS,
-		.next_updt = 0,
-	};
-	SimulatedVar fuel_level = {
-		.value = 0.0,
-		.max_value = 100,
-		.min_value = 20,
-		.time = 0.0,
-		.time_step = 0.0,
-		.variation = -1,
-		.updt_interval = 60 SECONDS,
-		.next_updt = 0,
-	};
-
-	uint32_t seed = 0;
-	uint32_t next_send_hi = 0;
-	uint32_t next_send_st = 0;
-	uint32_t next_send_lo = 0;
-	uint32_t value;
-#else
-	uint32_t counter = 0;
-#endif
-
-	uint8_t TxData[DATA_SIZE];
-
-#if ENCRYPTION_ENABLED
-	uint8_t cipher_tx_buffer[DATA_SIZE + AUTH_TAG_SIZE + IV_SIZE];
-#endif
+	uint32_t next_send_statistics = 0;
+	uint32_t next_rekey = config.rekey_interval;
 
-    while(1) {
+	/* Frame buffers live in the buffers arena, not on the stack */
+	static uint8_t TxData[DATA_SIZE] RAM_BUFFERS;
+	static uint8_t BenchData[MAX_FRAME_SIZE] RAM_BUFFERS;
 
-/* Simulations enabled: generate messages with pseudo-randomic variables */
-#if SIMULATIONS
+	/* Signals due in the same loop iteration (aggregation mode) */
+	Container container;
+	container_init(&container);
 
-        /* Seed the random number generator */
-		HAL_RNG_GenerateRandomNumber(&hrng, &seed);
-		srand(seed);
+	/* Buffers to store received diagnostic requests */
+	FDCAN_RxHeaderTypeDef RxHeader;
+	static uint8_t RxData[RX_DATA_SIZE] RAM_BUFFERS;
 
-		/* Generate simulated engine speed */
-		if (HAL_GetTick() >= eng_speed.next_updt) {
-			simulate_osc_value(&eng_speed);
-			eng_speed.next_updt = eng_speed.updt_interval + HAL_GetTick();
+    while(1) {
+
+		/* Execute pending UART commands */
+		command_poll();
+
+		/* Answer diagnostic requests and apply flow control (kept in the RX FIFO while the TX FIFO is full) */
+		if (fdcan_available() && fdcan_free_to_send()) {
+			fdcan_read(&RxHeader, RxData);
+			if (diag_is_request(&RxHeader)) {
+				diag_process(&RxHeader, RxData);
+			}
+			else if (isotp_is_flow_control(&RxHeader)) {
+				isotp_flow_control(RxData);
+			}
+			else if (rekey_is_ack(&RxHeader)) {
+				rekey_ack(RxData);
+			}
+			else if (rekey_is_nonce(&RxHeader)) {
+				rekey_nonce(RxData);
+			}
 		}
 
-		/* Generate simulated engine temperature */
-		if (HAL_GetTick() >= eng_temperature.next_updt) {
-			simulate_osc_value(&eng_temperature);
-			eng_temperature.next_updt = eng_temperature.updt_interval + HAL_GetTick();
+		/* Next segment of a segmented transfer */
+		isotp_poll();
+
+		/* Bus time synchronisation (sync frame when due, then its follow-up) */
+		timesync_poll();
+
+		/* Periodic key change, and key update (re)transmission */
+		if (config.rekey_interval && HAL_GetTick() >= next_rekey) {
+			rekey_start();
+			next_rekey = config.rekey_interval + HAL_GetTick();
 		}
+		rekey_poll();
+
+		/* Persist the next block of IV sequences before the reservation runs out */
+		counter_poll();
+
+		/* End marker of the last benchmark run, once the TX FIFO has room */
+		send_bench_marker();
+
+		/* Simulations enabled: generate messages with pseudo-randomic variables */
+		if (config.simulations) {
+			/* Update every due signal */
+			uint32_t start_time = get_clock_cycles();
+			if (sim_update(HAL_GetTick())) {
+				hist_record(&hist_simulate, get_clock_cycles() - start_time);
+			}
+
+			/* Build and send the messages due according to their transmission policy */
+			send_due_messages(&container, TxData);
 
-		/* Generate simulated vehicle speed */
-		if (HAL_GetTick() >= vehicle_speed.next_updt) {
-			simulate_osc_value(&vehicle_speed);
-			vehicle_speed.next_updt = vehicle_speed.updt_interval + HAL_GetTick();
+			/* Send the signals aggregated in this iteration */
+			flush_container(&container);
 		}
 
-		/* Generate simulated vehicle distance */
-		if (HAL_GetTick() >= vehicle_distance.next_updt) {
-			simulate_cumul_value(&vehicle_distance);
-			vehicle_distance.next_updt = vehicle_distance.updt_interval + HAL_GetTick();
+		/* Simulations disabled: saturate the TX FIFO with counter messages (throughput benchmark) */
+		else {
+			/* The messages of the next run wait behind the end marker of the last one */
+			if (!bench.marker_pending && fdcan_free_to_send() && HAL_GetTick() >= next_send_statistics) {
+				bench.payload_size = bench_payload_size();
+				clear_data(BenchData, bench.payload_size, EMPTY_BYTE_VALUE);
+				BenchData[0] = (uint8_t)(bench.frames & 0xFF);
+				BenchData[1] = (uint8_t)(bench.frames >> 8 & 0xFF);
+				BenchData[2] = (uint8_t)(bench.frames >> 16 & 0xFF);
+				BenchData[3] = (uint8_t)(bench.frames >> 24 & 0xFF);
+
+				/* Bus time of the message creation, for the one-way latency measured by Bob */
+				if (bench.payload_size >= 8) {
+					uint32_t origin = timesync_now();
+					BenchData[4] = (uint8_t)(origin & 0xFF);
+					BenchData[5] = (uint8_t)(origin >> 8 & 0xFF);
+					BenchData[6] = (uint8_t)(origin >> 16 & 0xFF);
+					BenchData[7] = (uint8_t)(origin >> 24 & 0xFF);
+				}
+				bench.encrypt_cycles += send_message(ID_STATISTICS, BenchData, bench.payload_size);
+				bench.frames++;
+				bench.payload_bytes += bench.payload_size;
+				next_send_statistics = config.interval_statistics + HAL_GetTick();
+			}
+
+			/* Report the run and start the next one */
+			if (HAL_GetTick() - bench.start >= config.bench_duration) {
+				bench_finish();
+			}
 		}
 
-		/* Generate simulated fuel level */
-		if (HAL_GetTick() >= fuel_level.next_updt) {
-			simulate_cumul_value(&fuel_level);
-			fuel_level.next_updt = fuel_level.updt_interval + HAL_GetTick();
+		/* Dump trace records once the ring is filled, a few per iteration */
+		trace_poll();
+	}
+}
+
+/**
+ * @brief Encode and send every message whose transmission policy allows it
+ *
+ * With tx_policy set to 0, every message is sent periodically (legacy behaviour).
+ *
+ * @param container Container of the signals due in this iteration
+ * @param data Payload buffer of DATA_SIZE bytes
+ */
+static void send_due_messages(Container *container, uint8_t *data) {
+	for (uint32_t i = 0; i < TX_MESSAGES; i++) {
+		const TxMessage *msg = &tx_messages[i];
+		TxPolicyConfig policy = {
+			.policy = config.tx_policy ? msg->policy : TX_PERIODIC,
+			.interval = *msg->interval,
+			.heartbeat = config.heartbeat,
+			.deadband = msg->deadband,
+		};
+		uint32_t value = (uint32_t)((int64_t)(sim_value(msg->signal) + msg->offset) * msg->scale_num / msg->scale_den);
+
+		if (!txpolicy_check(&policy, &tx_state[i], value, HAL_GetTick())) {
+			continue;
 		}
 
-		/* Build and send high frequence messages */
-		if (HAL_GetTick() >= next_send_hi) {
-
-			value = eng_speed.value * 8;
-			clear_data(TxData, sizeof(TxData), EMPTY_BYTE_VALUE);
-			TxData[4] = (uint8_t)(value & 0xFF);
-			TxData[5] = (uint8_t)(value >> 8 & 0xFF);
-#if ENCRYPTION_ENABLED
-			encrypt(TxData, sizeof(TxData), cipher_tx_buffer, sizeof(cipher_tx_buffer));
-			fdcan_send(ID_ENGINE_CONTROLLER, cipher_tx_buffer, sizeof(cipher_tx_buffer));
-			print_data(ID_ENGINE_CONTROLLER, cipher_tx_buffer, sizeof(cipher_tx_buffer));
-#else
-			fdcan_send(ID_ENGINE_CONTROLLER, TxData, sizeof(TxData));
-			print_data(ID_ENGINE_CONTROLLER, TxData, sizeof(TxData));
-#endif
-			next_send_hi = FREQ_INTERVAL_HI + HAL_GetTick();
+		clear_data(data, DATA_SIZE, EMPTY_BYTE_VALUE);
+		for (uint8_t b = 0; b < msg->length; b++) {
+			data[msg->position + b] = (uint8_t)(value >> (8 * b) & 0xFF);
 		}
 
-		/* Build and send standard frequence messages */
-		if (HAL_GetTick() >= next_send_st) {
-
-			value = vehicle_speed.value * 256;
-			clear_data(TxData, sizeof(TxData), EMPTY_BYTE_VALUE);
-			TxData[6] = (uint8_t)(value & 0xFF);
-			TxData[7] = (uint8_t)(value >> 8 & 0xFF);
-#if ENCRYPTION_ENABLED
-			encrypt(TxData, sizeof(TxData), cipher_tx_buffer, sizeof(cipher_tx_buffer));
-			fdcan_send(ID_TACHOGRAPH, cipher_tx_buffer, sizeof(cipher_tx_buffer));
-			print_data(ID_TACHOGRAPH, cipher_tx_buffer, sizeof(cipher_tx_buffer));
-#else
-			fdcan_send(ID_TACHOGRAPH, TxData, sizeof(TxData));
-			print_data(ID_TACHOGRAPH, TxData, sizeof(TxData));
-#endif
-			next_send_st = FREQ_INTERVAL_ST + HAL_GetTick();
+		/* The engine speed stream is authenticated by windows when enabled */
+		if (msg->id == ID_ENGINE_CONTROLLER && config.mac_window) {
+			send_window_frame(msg->id, data);
 		}
-		
-		/* Build and send low frequence messages */
-		if (HAL_GetTick() >= next_send_lo) {
-
-			value = eng_temperature.value + 40;
-			clear_data(TxData, sizeof(TxData), EMPTY_BYTE_VALUE);
-			TxData[7] = (uint8_t)(value & 0xFF);
-#if ENCRYPTION_ENABLED
-			encrypt(TxData, sizeof(TxData), cipher_tx_buffer, sizeof(cipher_tx_buffer));
-			fdcan_send(ID_ENGINE_TEMPERATURE, cipher_tx_buffer, sizeof(cipher_tx_buffer));
-			print_data(ID_ENGINE_TEMPERATURE, cipher_tx_buffer, sizeof(cipher_tx_buffer));
-#else
-			fdcan_send(ID_ENGINE_TEMPERATURE, TxData, sizeof(TxData));
-			print_data(ID_ENGINE_TEMPERATURE, TxData, sizeof(TxData));
-#endif
-
-			value = fuel_level.value / 0.4;
-			clear_data(TxData, sizeof(TxData), EMPTY_BYTE_VALUE);
-			TxData[1] = (uint8_t)(value & 0xFF);
-#if ENCRYPTION_ENABLED
-			encrypt(TxData, sizeof(TxData), cipher_tx_buffer, sizeof(cipher_tx_buffer));
-			fdcan_send(ID_FUEL, cipher_tx_buffer, sizeof(cipher_tx_buffer));
-			print_data(ID_FUEL, cipher_tx_buffer, sizeof(cipher_tx_buffer));
-#else
-			fdcan_send(ID_FUEL, TxData, sizeof(TxData));
-			print_data(ID_FUEL, TxData, sizeof(TxData));
-#endif
-			
-			value = vehicle_distance.value / 5;
-			clear_data(TxData, sizeof(TxData), EMPTY_BYTE_VALUE);
-			TxData[0] = (uint8_t)(value & 0xFF);
-			TxData[1] = (uint8_t)(value >> 8 & 0xFF);
-			TxData[2] = (uint8_t)(value >> 16 & 0xFF);
-			TxData[3] = (uint8_t)(value >> 24 & 0xFF);
-#if ENCRYPTION_ENABLED
-			encrypt(TxData, sizeof(TxData), cipher_tx_buffer, sizeof(cipher_tx_buffer));
-			fdcan_send(ID_DISTANCE, cipher_tx_buffer, sizeof(cipher_tx_buffer));
-			print_data(ID_DISTANCE, cipher_tx_buffer, sizeof(cipher_tx_buffer));
-#else
-			fdcan_send(ID_DISTANCE, TxData, sizeof(TxData));
-			print_data(ID_DISTANCE, TxData, sizeof(TxData));
-#endif
-			next_send_lo = FREQ_INTERVAL_LO + HAL_GetTick();
+		else {
+			send_signal(container, msg->id, data, msg->position, msg->length);
 		}
+	}
+}
 
-/* Simulations disabled: generate a single message for calculating statistics */
-#else
-		if (fdcan_free_to_send()) {
-			clear_data(TxData, sizeof(TxData), EMPTY_BYTE_VALUE);
-			TxData[0] = (uint8_t)(counter & 0xFF);
-			TxData[1] = (uint8_t)(counter >> 8 & 0xFF);
-			TxData[2] = (uint8_t)(counter >> 16 & 0xFF);
-			TxData[3] = (uint8_t)(counter >> 24 & 0xFF);
-#if ENCRYPTION_ENABLED
-			/* Measure time spent on encryption */
-			uint32_t start_time = get_clock_cycles();
-			encrypt(TxData, sizeof(TxData), cipher_tx_buffer, sizeof(cipher_tx_buffer));
-			uint32_t end_time = get_clock_cycles();
-			printf("%u, %u\r\n", (unsigned int)counter, (unsigned int)(end_time-start_time));
-			fdcan_send(ID_STATISTICS, cipher_tx_buffer, sizeof(cipher_tx_buffer));
-#else
-			fdcan_send(ID_STATISTICS, TxData, sizeof(TxData));
-#endif
-			counter++;
+/**
+ * @brief Encrypt (if enabled) and send a message
+ *
+ * In simulation mode, the sent payload is printed. The encryption cycles are
+ * recorded in the histogram.
+ *
+ * @param id Message identifier
+ * @param data Plaintext payload
+ * @param size Plaintext size (valid CAN FD payload size with the tag and IV when encrypted)
+ * @return uint32_t Cycles spent on encryption
+ */
+static uint32_t send_message(uint32_t id, uint8_t *data, size_t size) {
+	uint8_t cipher_tx_buffer[MAX_FRAME_SIZE];
+	uint8_t *payload = data;
+	uint32_t cycles = 0;
+
+	if (config.encryption) {
+		/* Measure time spent on encryption */
+		uint32_t start_time = get_clock_cycles();
+		encrypt(id, data, size, cipher_tx_buffer, sizeof(cipher_tx_buffer));
+		cycles = get_clock_cycles() - start_time;
+		hist_record(&hist_encrypt, cycles);
+		payload = cipher_tx_buffer;
+		size += AUTH_TAG_SIZE + IV_SIZE;
+	}
+
+	if (is_latest_value(id)) {
+		fdcan_send_latest(id, payload, size);
+	}
+	else {
+		fdcan_send(id, payload, size);
+	}
+
+	if (config.simulations) {
+		print_data(id, payload, size);
+	}
+
+	return cycles;
+}
+
+/**
+ * @brief Check if a pending frame of a message is replaced by a newer one
+ *
+ * In latest-value mode, this applies to the periodic messages: a stale frame
+ * still in the TX FIFO is cancelled when the next one is sent.
+ *
+ * @param id Message identifier
+ * @return uint8_t 1 if only the latest value is sent, 0 otherwise
+ */
+static uint8_t is_latest_value(uint32_t id) {
+	if (!config.latest_value) {
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < TX_MESSAGES; i++) {
+		if (tx_messages[i].id == id) {
+			return !config.tx_policy || tx_messages[i].policy == TX_PERIODIC;
 		}
-#endif
 	}
+	return 0;
 }
 
-#if SIMULATIONS
 /**
- * @brief Update a simulated oscillating variable with a new value
- * 
- * 1. Generate the base value using a sine wave
- * 2. Add random jitter in range [-jitter, +jitter]
- * 3. Increment the time variable for smooth variation
- * 4. Clamp the value within the specified range
- * 
- * @param variable Pointer to the simulated variable
+ * @brief Send a signal message, or add its meaningful bytes to the container in aggregation mode
+ *
+ * @param container Container of the current loop iteration
+ * @param id Message identifier
+ * @param data Plaintext payload of DATA_SIZE bytes
+ * @param offset Position of the signal in the payload
+ * @param length Size of the signal
+ */
+static void send_signal(Container *container, uint32_t id, uint8_t *data, uint8_t offset, uint8_t length) {
+	if (!config.aggregation) {
+		send_message(id, data, DATA_SIZE);
+		return;
+	}
+
+	ContainerEntry entry = {id, offset, length, &data[offset]};
+	if (!container_add(container, &entry)) {
+		flush_container(container);
+		container_add(container, &entry);
+	}
+}
+
+/**
+ * @brief Send the aggregated signals under a single tag and clear the container
+ *
+ * A container with a single signal is sent as the original message, which is
+ * smaller than the container.
+ *
+ * @param container Container of the current loop iteration
+ */
+static void flush_container(Container *container) {
+	if (container->count == 0) {
+		return;
+	}
+
+	if (container->count == 1) {
+		uint8_t data[DATA_SIZE];
+		ContainerEntry entry;
+		container_next(container->data, container->size, CONTAINER_HEADER_SIZE, &entry);
+		clear_data(data, sizeof(data), EMPTY_BYTE_VALUE);
+		memcpy(&data[entry.offset], entry.data, entry.length);
+		send_message(entry.id, data, DATA_SIZE);
+	}
+	else {
+		size_t size = config.encryption ? CONTAINER_SIZE : fdcan_frame_size(container->size);
+		send_message(ID_CONTAINER, container->data, size);
+	}
+
+	container_init(container);
+}
+
+/**
+ * @brief Send a message authenticated by the MAC window (not encrypted)
+ *
+ * 1. Open a window if none is open
+ * 2. Append the ID, payload and sequence to the window and get the running tag fragment
+ * 3. Send the payload, sequence and fragment
+ * 4. Close the window after mac_window frames
+ *
+ * @param id Message identifier
+ * @param data Plaintext payload (the first WINDOW_PAYLOAD_SIZE bytes are sent)
+ */
+static void send_window_frame(uint32_t id, uint8_t *data) {
+	uint8_t frame[WINDOW_FRAME_SIZE];
+	uint8_t input[2 + WINDOW_FRAME_SIZE - MAC_FRAGMENT_SIZE];
+
+	uint32_t start_time = get_clock_cycles();
+	if (window.count == 0) {
+		window.first_seq = window.seq;
+		mac_window_start();
+	}
+
+	memcpy(frame, data, WINDOW_PAYLOAD_SIZE);
+	frame[WINDOW_PAYLOAD_SIZE + 0] = (uint8_t)(window.seq & 0xFF);
+	frame[WINDOW_PAYLOAD_SIZE + 1] = (uint8_t)(window.seq >> 8 & 0xFF);
+	frame[WINDOW_PAYLOAD_SIZE + 2] = (uint8_t)(window.seq >> 16 & 0xFF);
+	frame[WINDOW_PAYLOAD_SIZE + 3] = (uint8_t)(window.seq >> 24 & 0xFF);
+
+	input[0] = (uint8_t)(id >> 8);
+	input[1] = (uint8_t)(id & 0xFF);
+	memcpy(&input[2], frame, sizeof(input) - 2);
+	mac_window_append(input, sizeof(input), &frame[sizeof(input) - 2]);
+	hist_record(&hist_mac_frame, get_clock_cycles() - start_time);
+
+	fdcan_send(id, frame, sizeof(frame));
+	if (config.simulations) {
+		print_data(id, frame, sizeof(frame));
+	}
+
+	window.seq++;
+	window.count++;
+	if (window.count >= config.mac_window) {
+		close_window();
+	}
+}
+
+/**
+ * @brief Send the tag covering every frame of the open window
+ *
+ */
+static void close_window() {
+	uint8_t frame[WINDOW_TAG_FRAME_SIZE];
+
+	if (window.count == 0) {
+		return;
+	}
+
+	clear_data(frame, sizeof(frame), EMPTY_BYTE_VALUE);
+	frame[0] = (uint8_t)(window.first_seq & 0xFF);
+	frame[1] = (uint8_t)(window.first_seq >> 8 & 0xFF);
+	frame[2] = (uint8_t)(window.first_seq >> 16 & 0xFF);
+	frame[3] = (uint8_t)(window.first_seq >> 24 & 0xFF);
+	frame[4] = (uint8_t)window.count;
+
+	uint32_t start_time = get_clock_cycles();
+	mac_window_finish(&frame[8]);
+	hist_record(&hist_mac_window, get_clock_cycles() - start_time);
+
+	fdcan_send(ID_MAC_WINDOW, frame, sizeof(frame));
+	if (config.simulations) {
+		print_data(ID_MAC_WINDOW, frame, sizeof(frame));
+	}
+
+	window.count = 0;
+}
+
+/**
+ * @brief Get the benchmark plaintext size
+ *
+ * The requested size is rounded up so the message (with the tag and IV when
+ * encrypted) is a valid CAN FD payload size, without exceeding 64 bytes.
+ *
+ * @return size_t Plaintext size
+ */
+static size_t bench_payload_size() {
+	size_t overhead = config.encryption ? AUTH_TAG_SIZE + IV_SIZE : 0;
+	size_t size = config.bench_size + overhead;
+
+	if (size > MAX_FRAME_SIZE) {
+		size = MAX_FRAME_SIZE;
+	}
+
+	return fdcan_frame_size(size) - overhead;
+}
+
+/**
+ * @brief Finish the benchmark run and start the next one
+ *
+ * 1. Send the end marker (run and sent messages, not encrypted) so the receiver reports its losses,
+ *    deferred to the main loop without room in the TX FIFO
+ * 2. Print the throughput, estimated bus load and encryption cycles of the run
+ * 3. Clear the counters
  */
-static void simulate_osc_value(SimulatedVar *variable) {
-	float base_value = variable->min_value + (variable->max_value - variable->min_value) * 0.5 * (1 + sin(variable->time));
+static void bench_finish() {
+	uint32_t elapsed = HAL_GetTick() - bench.start;
+
+	bench.marker[0] = (uint8_t)(bench.run & 0xFF);
+	bench.marker[1] = (uint8_t)(bench.run >> 8 & 0xFF);
+	bench.marker[2] = (uint8_t)(bench.run >> 16 & 0xFF);
+	bench.marker[3] = (uint8_t)(bench.run >> 24 & 0xFF);
+	bench.marker[4] = (uint8_t)(bench.frames & 0xFF);
+	bench.marker[5] = (uint8_t)(bench.frames >> 8 & 0xFF);
+	bench.marker[6] = (uint8_t)(bench.frames >> 16 & 0xFF);
+	bench.marker[7] = (uint8_t)(bench.frames >> 24 & 0xFF);
+	bench.marker_pending = 1;
+	send_bench_marker();
+
+	if (elapsed == 0) {
+		elapsed = 1;
+	}
 
-	variable->value = base_value + (rand() % (2 * variable->variation + 1) - variable->variation);
-	variable->time += variable->time_step;
+	size_t frame_size = bench.payload_size + (config.encryption ? AUTH_TAG_SIZE + IV_SIZE : 0);
+	uint64_t bus_time_ns = (uint64_t)bench.frames * fdcan_frame_time_ns(frame_size);
+	uint32_t bus_load = (uint32_t)(bus_time_ns / elapsed / 1000);
+
+	printf(
+		"Bench run %u: %u ms, %u messages of %u bytes (payload %u), encryption %u, engine %u, BRS %u, pipeline %u\r\n",
+		(unsigned int) bench.run,
+		(unsigned int) elapsed,
+		(unsigned int) bench.frames,
+		(unsigned int) frame_size,
+		(unsigned int) bench.payload_size,
+		(unsigned int) config.encryption,
+		(unsigned int) config.crypto_engine,
+		(unsigned int) config.brs,
+		(unsigned int) config.pipeline
+	);
+	printf(
+		"%u msg/s, %u payload B/s, bus load %u.%u%%, encrypt %u cycles/msg\r\n",
+		(unsigned int) ((uint64_t)bench.frames * 1000 / elapsed),
+		(unsigned int) (bench.payload_bytes * 1000 / elapsed),
+		(unsigned int) (bus_load / 10),
+		(unsigned int) (bus_load % 10),
+		(unsigned int) (bench.frames ? bench.encrypt_cycles / bench.frames : 0)
+	);
+
+	bench.run++;
+	bench.frames = 0;
+	bench.payload_bytes = 0;
+	bench.encrypt_cycles = 0;
+	bench.start = HAL_GetTick();
+}
 
-	if (variable->value > variable->max_value) variable->value = variable->max_value;
-	if (variable->value < variable->min_value) variable->value = variable->min_value;
+/**
+ * @brief Send the pending end marker of the last benchmark run if the TX FIFO has room
+ *
+ */
+static void send_bench_marker() {
+	if (!bench.marker_pending || !fdcan_free_to_send()) {
+		return;
+	}
+
+	fdcan_send(ID_BENCH_END, bench.marker, sizeof(bench.marker));
+	bench.marker_pending = 0;
+}
+
+/**
+ * @brief Fill a slice of the segmented test message
+ * 
+ * @param offset Position of the slice in the message
+ * @param data Buffer of size bytes
+ * @param size Size of the slice
+ */
+static void segment_source(uint32_t offset, uint8_t *data, size_t size) {
+	for (size_t i = 0; i < size; i++) {
+		data[i] = SEGMENT_PATTERN(offset + i);
+	}
 }
 
 /**
- * @brief Update a simulated cumulative variable with a new value
+ * @brief Start sending the segmented test message (segment_size bytes)
  * 
- * 1. Get a randomic initial value
- * 2. Add random increment or decrement
- * 3. Clamp the value within the specified range
+ */
+static void send_segmented() {
+	if (!isotp_send(config.segment_size, segment_source)) {
+		printf("ISO-TP transfer in progress\r\n");
+	}
+}
+
+/**
+ * @brief Start distributing a new key
  * 
- * @param variable Pointer to the simulated variable
  */
-static void simulate_cumul_value(SimulatedVar *variable) {
-	if (variable->value < 0.1) {
-		variable->value = variable->min_value + rand() % (variable->max_value - variable->min_value + 1);
+static void start_rekey() {
+	if (!rekey_start()) {
+		printf("Key change in progress\r\n");
 	}
+}
 
-	int32_t incdec = (rand() % (abs(variable->variation) + 1));
-	if (variable->variation < 0) {
-		incdec = -incdec;
+/**
+ * @brief Fill the data of a diagnostic identifier
+ * 
+ * @param did Data identifier
+ * @param data Buffer of DIAG_MAX_DATA_SIZE bytes
+ * @return size_t Amount of bytes written, 0 if the DID is not supported
+ */
+static size_t read_did(uint16_t did, uint8_t *data) {
+	uint8_t *end = data;
+
+	switch (did)
+	{
+		case DID_CONFIGURATION:
+			end = diag_put_u32(end, SystemCoreClock);
+			*end++ = config.encryption | (config.simulations << 1);
+			*end++ = DATA_SIZE;
+			break;
+
+		case DID_COUNTERS:
+			end = diag_put_u32(end, fdcan_tx_count());
+			end = diag_put_u32(end, fdcan_tx_replaced());
+			break;
+
+		case DID_HISTOGRAM:
+			end = diag_put_hist(end, &hist_encrypt);
+			break;
+
+		case DID_HISTOGRAM + 1:
+			end = diag_put_hist(end, &hist_simulate);
+			break;
+
+		case DID_HISTOGRAM + 2:
+			end = diag_put_hist(end, &hist_mac_frame);
+			break;
+
+		case DID_HISTOGRAM + 3:
+			end = diag_put_hist(end, &hist_mac_window);
+			break;
+
+		case DID_HIGH_WATER:
+			end = diag_put_u32(end, fdcan_tx_high_water());
+			break;
+
+		default:
+			break;
 	}
-	variable->value = variable->value + incdec;
 
-	if (variable->value > variable->max_value) variable->value = variable->max_value;
-	if (variable->value < variable->min_value) variable->value = variable->min_value;
+	return end - data;
 }
-#endif
 
 /**
  * @brief Clear the payload array
@@ -345,7 +835,6 @@ static void clear_data(uint8_t *data, uint8_t size, uint8_t value) {
 	}
 }
 
-#if SIMULATIONS
 /**
  * @brief Print message identifier and data
  * 
@@ -360,15 +849,133 @@ static void print_data(uint32_t id, uint8_t *data, size_t size) {
 	}
 	printf("\r\n");
 }
-#else
-#if ENCRYPTION_ENABLED
+
+/**
+ * @brief Select the crypto engine
+ *
+ * @param engine Crypto engine (CryptoEngine)
+ */
+static void apply_crypto_engine(uint32_t engine) {
+	crypto_set_engine((CryptoEngine)engine);
+}
+
+/**
+ * @brief Select the header authentication mode
+ *
+ * @param mode Header authentication mode (HeaderAad)
+ */
+static void apply_header_aad(uint32_t mode) {
+	crypto_set_header_aad((HeaderAad)mode);
+}
+
+/**
+ * @brief Enable or disable the bit rate switch
+ *
+ * @param enabled 1 to send the data phase at the data bit rate
+ */
+static void apply_brs(uint32_t enabled) {
+	fdcan_set_brs(enabled);
+}
+
+/**
+ * @brief Enable or disable the CPU/TX pipeline
+ *
+ * @param enabled 1 to stage frames ahead of the TX FIFO
+ */
+static void apply_pipeline(uint32_t enabled) {
+	fdcan_set_pipeline(enabled);
+}
+
+/**
+ * @brief Change the MAC window size, closing the open window
+ *
+ * @param frames Frames per window, 0 to encrypt every frame
+ */
+static void apply_mac_window(uint32_t frames) {
+	(void)frames;
+	close_window();
+}
+
+/**
+ * @brief Switch the CPU clock profile
+ *
+ * @param profile Clock profile (ClockProfile)
+ */
+static void apply_clock(uint32_t profile) {
+	clock_set_profile((ClockProfile)profile);
+}
+
+/**
+ * @brief Change the interval between bus time synchronisations (the next one is sent right away)
+ *
+ * @param interval Interval in milliseconds (0: disabled)
+ */
+static void apply_sync_interval(uint32_t interval) {
+	timesync_set_interval(interval);
+}
+
+/**
+ * @brief Encrypt one standard message (workload of the clock benchmark)
+ *
+ */
+static void clock_workload() {
+	uint8_t plaintext[DATA_SIZE] = {0};
+	uint8_t frame[MAX_FRAME_SIZE];
+
+	encrypt(ID_ENGINE_CONTROLLER, plaintext, DATA_SIZE, frame, sizeof(frame));
+}
+
+/**
+ * @brief Time the encryption of a standard message in every clock profile
+ *
+ */
+static void clock_bench() {
+	clock_benchmark("encrypt", clock_workload);
+}
+
+/**
+ * @brief Set the amount of extra simulated signals
+ *
+ * @param load Amount of load signals
+ */
+static void apply_sim_load(uint32_t load) {
+	sim_truncate(SIGNALS);
+	for (uint32_t i = 0; i < load; i++) {
+		sim_add(&load_signal);
+	}
+}
+
+/**
+ * @brief Print the summary of the encryption, simulation and MAC histograms, the transmission policy counters and the IV sequence store
+ *
+ */
+static void print_histograms() {
+	printf("Cycles @ %u Hz, %u messages (%u replaced, %u dropped), %u signals\r\n", (unsigned int)SystemCoreClock, (unsigned int)fdcan_tx_count(), (unsigned int)fdcan_tx_replaced(), (unsigned int)fdcan_tx_dropped(), (unsigned int)sim_count());
+	hist_print(&hist_encrypt);
+	hist_print(&hist_simulate);
+	hist_print(&hist_mac_frame);
+	hist_print(&hist_mac_window);
+	txpolicy_print();
+	counter_print();
+}
+
+/**
+ * @brief Clear the encryption, simulation and MAC histograms, and the transmission policy counters
+ *
+ */
+static void reset_histograms() {
+	hist_reset(&hist_encrypt);
+	hist_reset(&hist_simulate);
+	hist_reset(&hist_mac_frame);
+	hist_reset(&hist_mac_window);
+	txpolicy_reset();
+}
+
 /**
  * @brief Get the current clock cycles counter
- * 
+ *
  * @return uint32_t Current clock cycle counter value
  */
 static uint32_t get_clock_cycles() {
     return DWT->CYCCNT;
-}
-#endif
-#endif
\ No newline at end of file
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+/**
+ * @file command.c
+ * @author Luan
+ * @brief UART command channel to change the operating modes at run time
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include "command.h"
+#include "uart.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+/* Registered tables */
+static const CommandParam *command_params = NULL;
+static size_t command_params_count = 0;
+static const CommandAction *command_actions = NULL;
+static size_t command_actions_count = 0;
+
+
+/* Static function prototypes */
+static const CommandParam *find_param(const char *name);
+static void print_param(const CommandParam *param);
+static void set_param(const CommandParam *param, const char *text);
+
+
+void command_setup(const CommandParam *params, size_t params_count,
+		const CommandAction *actions, size_t actions_count) {
+	command_params = params;
+	command_params_count = params_count;
+	command_actions = actions;
+	command_actions_count = actions_count;
+
+	uart_rx_start();
+}
+
+void command_poll() {
+	char line[UART_LINE_SIZE];
+
+	if (!uart_read_line(line)) {
+		return;
+	}
+
+	char *saveptr;
+	char *command = strtok_r(line, " ", &saveptr);
+	char *name = strtok_r(NULL, " ", &saveptr);
+	char *value = strtok_r(NULL, " ", &saveptr);
+
+	if (command == NULL) {
+		return;
+	}
+
+	if (strcmp(command, "list") == 0) {
+		for (size_t i = 0; i < command_params_count; i++) {
+			print_param(&command_params[i]);
+		}
+		return;
+	}
+
+	if (strcmp(command, "get") == 0 || strcmp(command, "set") == 0) {
+		const CommandParam *param = name ? find_param(name) : NULL;
+		if (param == NULL) {
+			printf("ERR unknown parameter\r\n");
+		}
+		else if (command[0] == 'g') {
+			print_param(param);
+		}
+		else if (value == NULL) {
+			printf("ERR missing value\r\n");
+		}
+		else {
+			set_param(param, value);
+		}
+		return;
+	}
+
+	for (size_t i = 0; i < command_actions_count; i++) {
+		if (strcmp(command, command_actions[i].name) == 0) {
+			command_actions[i].run();
+			printf("OK\r\n");
+			return;
+		}
+	}
+
+	printf("ERR unknown command\r\n");
+}
+
+/**
+ * @brief Find a parameter by name
+ *
+ * @param name Name of the parameter
+ * @return const CommandParam* Parameter or NULL if not found
+ */
+static const CommandParam *find_param(const char *name) {
+	for (size_t i = 0; i < command_params_count; i++) {
+		if (strcmp(name, command_params[i].name) == 0) {
+			return &command_params[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Print a parameter as "<name> <value>"
+ *
+ * @param param Parameter
+ */
+static void print_param(const CommandParam *param) {
+	printf("%s %u\r\n", param->name, (unsigned int)*param->value);
+}
+
+/**
+ * @brief Validate and set the value of a parameter
+ *
+ * @param param Parameter
+ * @param text Value as decimal (or 0x hexadecimal) text
+ */
+static void set_param(const CommandParam *param, const char *text) {
+	char *end;
+	unsigned long value = strtoul(text, &end, 0);
+
+	if (*end != '\0' || value < param->min || value > param->max) {
+		printf("ERR %s range %u..%u\r\n", param->name, (unsigned int)param->min, (unsigned int)param->max);
+		return;
+	}
+
+	*param->value = (uint32_t)value;
+	if (param->apply != NULL) {
+		param->apply(*param->value);
+	}
+	print_param(param);
+}
@@ -0,0 +1,57 @@
+/**
+ * @file container.c
+ * @author Luan
+ * @brief Container PDU carrying several signals under a single authentication tag
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include <string.h>
+#include "container.h"
+
+
+void container_init(Container *container) {
+	memset(container->data, 0xFF, sizeof(container->data));
+	container->data[0] = 0;
+	container->size = CONTAINER_HEADER_SIZE;
+	container->count = 0;
+}
+
+uint8_t container_add(Container *container, const ContainerEntry *entry) {
+	if (container->size + CONTAINER_ENTRY_HEADER_SIZE + entry->length > CONTAINER_SIZE) {
+		return 0;
+	}
+
+	uint8_t *end = &container->data[container->size];
+	*end++ = (uint8_t)(entry->id >> 8);
+	*end++ = (uint8_t)(entry->id & 0xFF);
+	*end++ = entry->offset;
+	*end++ = entry->length;
+	memcpy(end, entry->data, entry->length);
+
+	container->size += CONTAINER_ENTRY_HEADER_SIZE + entry->length;
+	container->data[0] = ++container->count;
+	return 1;
+}
+
+size_t container_next(const uint8_t *pdu, size_t size, size_t pos, ContainerEntry *entry) {
+	if (pos + CONTAINER_ENTRY_HEADER_SIZE > size) {
+		return 0;
+	}
+
+	entry->id = (pdu[pos] << 8) | pdu[pos + 1];
+	entry->offset = pdu[pos + 2];
+	entry->length = pdu[pos + 3];
+	entry->data = &pdu[pos + CONTAINER_ENTRY_HEADER_SIZE];
+
+	pos += CONTAINER_ENTRY_HEADER_SIZE + entry->length;
+	if (pos > size || entry->offset + entry->length > CONTAINER_MAX_MESSAGE_SIZE) {
+		return 0;
+	}
+
+	return pos;
+}
@@ -0,0 +1,124 @@
+/**
+ * @file cordic.c
+ * @author Luan
+ * @brief Sine calculation on the CORDIC coprocessor (q1.31)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include <math.h>
+#include "cordic.h"
+#include "main.h"
+#include "uart.h"
+
+
+/* q1.31 full scale */
+#define Q31_SCALE 2147483648.0f
+
+
+/* Sink for the benchmark results (keeps the loops from being optimized out) */
+static volatile float bench_sink;
+
+
+void cordic_setup() {
+	__HAL_RCC_CORDIC_CLK_ENABLE();
+
+	/**
+	 * Load the modulus (second argument) once with a two-argument calculation.
+	 * It is kept by the coprocessor, so every sine after it only writes the
+	 * angle and reads the sine (32-bit arguments and results).
+	 */
+	CORDIC->CSR = (1U << CORDIC_CSR_FUNC_Pos)
+		| (CORDIC_PRECISION << CORDIC_CSR_PRECISION_Pos)
+		| CORDIC_CSR_NARGS;
+	CORDIC->WDATA = 0;
+	CORDIC->WDATA = 0x7FFFFFFF;
+	(void)CORDIC->RDATA;
+
+	CORDIC->CSR = (1U << CORDIC_CSR_FUNC_Pos)
+		| (CORDIC_PRECISION << CORDIC_CSR_PRECISION_Pos);
+}
+
+int32_t cordic_sin(uint32_t phase) {
+	CORDIC->WDATA = phase;
+
+	/* Reading before the result is ready stalls the bus until it is */
+	return (int32_t)CORDIC->RDATA;
+}
+
+void cordic_sin_batch(const uint32_t *phases, int32_t *sines, size_t count) {
+	if (count == 0) {
+		return;
+	}
+
+	CORDIC->WDATA = phases[0];
+	for (size_t i = 1; i < count; i++) {
+		CORDIC->WDATA = phases[i];
+		sines[i - 1] = (int32_t)CORDIC->RDATA;
+	}
+	sines[count - 1] = (int32_t)CORDIC->RDATA;
+}
+
+void cordic_benchmark() {
+	uint32_t phases[CORDIC_BENCH_SAMPLES];
+	int32_t sines[CORDIC_BENCH_SAMPLES];
+	float angles[CORDIC_BENCH_SAMPLES];
+	uint32_t start_time;
+	float sum;
+
+	for (uint32_t i = 0; i < CORDIC_BENCH_SAMPLES; i++) {
+		phases[i] = i * (UINT32_MAX / CORDIC_BENCH_SAMPLES);
+		angles[i] = (float)(int32_t)phases[i] * (3.14159265f / Q31_SCALE);
+	}
+
+	/* Double precision (software emulated) */
+	sum = 0;
+	start_time = DWT->CYCCNT;
+	for (uint32_t i = 0; i < CORDIC_BENCH_SAMPLES; i++) {
+		sum += sin(angles[i]);
+	}
+	uint32_t cycles_sin = DWT->CYCCNT - start_time;
+	bench_sink = sum;
+
+	/* Single precision */
+	sum = 0;
+	start_time = DWT->CYCCNT;
+	for (uint32_t i = 0; i < CORDIC_BENCH_SAMPLES; i++) {
+		sum += sinf(angles[i]);
+	}
+	uint32_t cycles_sinf = DWT->CYCCNT - start_time;
+	bench_sink = sum;
+
+	/* CORDIC, one sine at a time */
+	sum = 0;
+	start_time = DWT->CYCCNT;
+	for (uint32_t i = 0; i < CORDIC_BENCH_SAMPLES; i++) {
+		sum += cordic_sin(phases[i]);
+	}
+	uint32_t cycles_cordic = DWT->CYCCNT - start_time;
+	bench_sink = sum;
+
+	/* CORDIC, batched */
+	start_time = DWT->CYCCNT;
+	cordic_sin_batch(phases, sines, CORDIC_BENCH_SAMPLES);
+	uint32_t cycles_batch = DWT->CYCCNT - start_time;
+
+	/* Largest difference to sinf(), in q1.31 LSBs */
+	uint32_t max_error = 0;
+	for (uint32_t i = 0; i < CORDIC_BENCH_SAMPLES; i++) {
+		int64_t error = (int64_t)(sinf(angles[i]) * Q31_SCALE) - sines[i];
+		if (error < 0) error = -error;
+		if (error > max_error) max_error = (uint32_t)error;
+	}
+
+	printf("Sine cycles @ %u Hz, %u samples\r\n", (unsigned int)SystemCoreClock, CORDIC_BENCH_SAMPLES);
+	printf("sin: %u/sample\r\n", (unsigned int)(cycles_sin / CORDIC_BENCH_SAMPLES));
+	printf("sinf: %u/sample\r\n", (unsigned int)(cycles_sinf / CORDIC_BENCH_SAMPLES));
+	printf("cordic: %u/sample\r\n", (unsigned int)(cycles_cordic / CORDIC_BENCH_SAMPLES));
+	printf("cordic batch: %u/sample\r\n", (unsigned int)(cycles_batch / CORDIC_BENCH_SAMPLES));
+	printf("cordic max error: %u LSB (q1.31)\r\n", (unsigned int)max_error);
+}
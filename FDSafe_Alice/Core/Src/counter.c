@@ -0,0 +1,319 @@
+/**
+ * @file counter.c
+ * @author Luan
+ * @brief Persistent freshness counter: log-structured store in the last two flash pages
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include "counter.h"
+#include "ccmram.h"
+#include "uart.h"
+
+
+/* Double-words per page: the header, then the records */
+#define SLOTS_PER_PAGE (FLASH_PAGE_SIZE / 8)
+
+/* Header of the page holding the log: magic (high word) and generation (low word) */
+#define COUNTER_MAGIC 0x46445343U
+
+/* Erased double-word */
+#define ERASED 0xFFFFFFFFFFFFFFFFULL
+
+/* Address of a slot of a store page */
+#define SLOT_ADDRESS(page, slot) (FLASH_BASE + (COUNTER_FIRST_PAGE + (page)) * FLASH_PAGE_SIZE + (slot) * 8)
+
+
+/* Log position and reservation */
+static struct {
+	uint32_t page;			/* Page holding the log */
+	uint32_t generation;	/* Generation of that page */
+	uint32_t slot;			/* Next free slot of that page */
+	uint64_t next;			/* Next value handed out */
+	uint64_t limit;			/* Persisted limit (values below it are reserved) */
+} store;
+
+/* Set by the NMI handler when a read of the store hits a double ECC error */
+static volatile uint8_t ecc_error = 0;
+
+/* Statistics since boot */
+static struct {
+	uint64_t start;			/* Value recovered at boot */
+	uint32_t reservations;
+	uint32_t programmed;	/* Double-words programmed (records and headers) */
+	uint32_t erases;
+	uint32_t stalls;		/* Reservations made by counter_next() */
+	uint32_t recovery_cycles;
+	uint32_t recovery_slots;
+	uint32_t ecc_errors;	/* Unreadable slots skipped by the recovery */
+} stats;
+
+
+/* Static function prototypes */
+static uint8_t read_slot(uint32_t page, uint32_t slot, uint64_t *value);
+static uint64_t make_record(uint64_t limit);
+static uint8_t record_limit(uint64_t record, uint64_t *limit);
+static uint8_t recover_page(uint32_t page, uint64_t *limit, uint32_t *slot);
+static void reserve();
+static void program(uint32_t page, uint32_t slot, uint64_t data);
+static void erase(uint32_t page);
+
+
+/**
+ * 1. Read the header of every page, the log is in the valid one with the highest generation
+ * 2. Scan its records up to the first erased slot, the last valid one is the limit
+ * 3. If that page has no valid record, fall back to the other one
+ */
+void counter_setup() {
+	uint32_t start_time = DWT->CYCCNT;
+	uint8_t valid[COUNTER_PAGES];
+	uint32_t generations[COUNTER_PAGES];
+	uint8_t found = 0;
+
+	stats.recovery_slots = 0;
+	for (uint32_t page = 0; page < COUNTER_PAGES; page++) {
+		uint64_t header;
+		valid[page] = read_slot(page, 0, &header) && (uint32_t)(header >> 32) == COUNTER_MAGIC;
+		generations[page] = (uint32_t)header;
+		stats.recovery_slots++;
+	}
+
+	/* Newest page first, the other one if it holds no valid record */
+	while (!found) {
+		uint8_t best = 0;
+		for (uint32_t page = 0; page < COUNTER_PAGES; page++) {
+			if (valid[page] && (!best || generations[page] > store.generation)) {
+				best = 1;
+				store.page = page;
+				store.generation = generations[page];
+			}
+		}
+		if (!best) {
+			break;
+		}
+		valid[store.page] = 0;
+		found = recover_page(store.page, &store.limit, &store.slot);
+	}
+
+	/* Blank or unreadable store: the first reservation starts a log in page 0 */
+	if (!found) {
+		store.page = COUNTER_PAGES - 1;
+		store.generation = 0;
+		store.slot = SLOTS_PER_PAGE;
+		store.limit = 0;
+	}
+	stats.recovery_cycles = DWT->CYCCNT - start_time;
+
+	store.next = store.limit;
+	stats.start = store.limit;
+	reserve();
+}
+
+CCMRAM_CODE uint64_t counter_next() {
+	if (store.next == store.limit) {
+		stats.stalls++;
+		reserve();
+	}
+	return store.next++;
+}
+
+void counter_poll() {
+	if (store.limit - store.next <= COUNTER_LOW_WATER) {
+		reserve();
+	}
+}
+
+void counter_print() {
+	uint64_t used = store.next - stats.start;
+	uint32_t amplification = stats.reservations ? stats.programmed * 100 / stats.reservations : 0;
+	uint32_t erases_per_million = used ? (uint32_t)((uint64_t)stats.erases * 100000000ULL / used) : 0;
+
+	printf("counter: next %u, limit %u, %u values since boot, page %u generation %u slot %u/%u\r\n",
+		(unsigned int)store.next,
+		(unsigned int)store.limit,
+		(unsigned int)used,
+		(unsigned int)store.page,
+		(unsigned int)store.generation,
+		(unsigned int)store.slot,
+		(unsigned int)SLOTS_PER_PAGE);
+	printf("counter: %u reservations, %u double-words programmed (write amplification %u.%02u), %u erases (%u.%02u per million values), %u stalls\r\n",
+		(unsigned int)stats.reservations,
+		(unsigned int)stats.programmed,
+		(unsigned int)(amplification / 100),
+		(unsigned int)(amplification % 100),
+		(unsigned int)stats.erases,
+		(unsigned int)(erases_per_million / 100),
+		(unsigned int)(erases_per_million % 100),
+		(unsigned int)stats.stalls);
+	printf("counter: boot recovery %u cycles, %u slots read, %u unreadable\r\n",
+		(unsigned int)stats.recovery_cycles,
+		(unsigned int)stats.recovery_slots,
+		(unsigned int)stats.ecc_errors);
+}
+
+uint8_t counter_ecc_error(uint32_t address) {
+	uint32_t start = SLOT_ADDRESS(0, 0) - FLASH_BASE;
+
+	if (address < start || address >= start + COUNTER_PAGES * FLASH_PAGE_SIZE) {
+		return 0;
+	}
+	ecc_error = 1;
+	return 1;
+}
+
+/**
+ * @brief Read a double-word of the store
+ *
+ * A slot left half-programmed by a reset may hold a double ECC error: the
+ * read raises an NMI, whose handler records it through counter_ecc_error()
+ * and returns (as the EEPROM emulation of ST does).
+ *
+ * @param page Store page (0 to COUNTER_PAGES - 1)
+ * @param slot Slot of the page
+ * @param value Content of the slot
+ * @return uint8_t 1 if the slot was read, 0 on a double ECC error
+ */
+static uint8_t read_slot(uint32_t page, uint32_t slot, uint64_t *value) {
+	ecc_error = 0;
+	*value = *(const volatile uint64_t *)SLOT_ADDRESS(page, slot);
+	__DSB();
+
+	if (ecc_error) {
+		stats.ecc_errors++;
+		return 0;
+	}
+	return 1;
+}
+
+/**
+ * @brief Build a record: limit (48 bits) and its check (16 bits)
+ *
+ * The check rejects erased (all ones) and zeroed slots, and slots left
+ * half-programmed by a reset.
+ *
+ * @param limit Limit to persist
+ * @return uint64_t Record
+ */
+static uint64_t make_record(uint64_t limit) {
+	limit &= 0xFFFFFFFFFFFFULL;
+	uint16_t check = (uint16_t)~(limit ^ (limit >> 16) ^ (limit >> 32));
+	return (limit << 16) | check;
+}
+
+/**
+ * @brief Get the limit of a record
+ *
+ * @param record Content of a slot
+ * @param limit Limit of the record
+ * @return uint8_t 1 if the record is valid, 0 otherwise
+ */
+static uint8_t record_limit(uint64_t record, uint64_t *limit) {
+	*limit = record >> 16;
+	return record == make_record(*limit);
+}
+
+/**
+ * @brief Find the last valid record of a page and its first free slot
+ *
+ * @param page Store page
+ * @param limit Limit of the last valid record
+ * @param slot First slot after the last written one
+ * @return uint8_t 1 if the page holds a valid record, 0 otherwise
+ */
+static uint8_t recover_page(uint32_t page, uint64_t *limit, uint32_t *slot) {
+	uint8_t found = 0;
+
+	*slot = 1;
+	for (uint32_t i = 1; i < SLOTS_PER_PAGE; i++) {
+		uint64_t record;
+		uint64_t value;
+		uint8_t readable = read_slot(page, i, &record);
+		stats.recovery_slots++;
+
+		if (readable && record == ERASED) {
+			break;
+		}
+
+		/* Slots that do not check or cannot be read are skipped, their space is lost */
+		*slot = i + 1;
+		if (readable && record_limit(record, &value) && (!found || value > *limit)) {
+			*limit = value;
+			found = 1;
+		}
+	}
+	return found;
+}
+
+/**
+ * @brief Persist the limit of the next block
+ *
+ * The record is appended to the log. When the page is full, the other page
+ * is erased and gets the record first and its header last: the header is
+ * the commit point, until it is written the recovery still uses the full page.
+ */
+static void reserve() {
+	uint64_t limit = store.limit + COUNTER_BLOCK;
+	uint64_t record = make_record(limit);
+
+	HAL_FLASH_Unlock();
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+
+	if (store.slot < SLOTS_PER_PAGE) {
+		program(store.page, store.slot, record);
+		store.slot++;
+	}
+	else {
+		uint32_t page = (store.page + 1) % COUNTER_PAGES;
+		erase(page);
+		program(page, 1, record);
+		program(page, 0, ((uint64_t)COUNTER_MAGIC << 32) | (store.generation + 1));
+		store.page = page;
+		store.generation++;
+		store.slot = 2;
+	}
+
+	HAL_FLASH_Lock();
+
+	store.limit = limit;
+	stats.reservations++;
+}
+
+/**
+ * @brief Program a double-word of the store
+ *
+ * @param page Store page
+ * @param slot Slot of the page (erased)
+ * @param data Double-word
+ */
+static void program(uint32_t page, uint32_t slot, uint64_t data) {
+	if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, SLOT_ADDRESS(page, slot), data) != HAL_OK) {
+		printf("Counter flash program error\r\n");
+		Error_Handler();
+	}
+	stats.programmed++;
+}
+
+/**
+ * @brief Erase a store page
+ *
+ * @param page Store page
+ */
+static void erase(uint32_t page) {
+	FLASH_EraseInitTypeDef EraseInit = {0};
+	uint32_t page_error;
+
+	EraseInit.TypeErase = FLASH_TYPEERASE_PAGES;
+	EraseInit.Banks = FLASH_BANK_1;
+	EraseInit.Page = COUNTER_FIRST_PAGE + page;
+	EraseInit.NbPages = 1;
+
+	if (HAL_FLASHEx_Erase(&EraseInit, &page_error) != HAL_OK) {
+		printf("Counter flash erase error\r\n");
+		Error_Handler();
+	}
+	stats.erases++;
+}
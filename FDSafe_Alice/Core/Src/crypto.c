@@ -13,43 +13,230 @@
 #include "crypto.h"
 #include "cmox_crypto.h"
 #include "uart.h"
+#include "ccmram.h"
+#include "counter.h"
 #include <string.h>
+#include "ram.h"
+
+
+/* GCM handle of any engine (the handles hold no pointers to themselves, so they can be copied) */
+typedef union {
+  cmox_cipher_handle_t super;
+  cmox_gcmFast_handle_t fast;
+  cmox_gcmSmall_handle_t small;
+} GcmHandle;
+
+/* Key slot: raw key and its context, keyed and waiting for an IV */
+typedef struct {
+  uint8_t valid;
+  uint8_t epoch;
+  uint8_t key[KEY_SIZE];
+  GcmHandle ctx;
+} KeySlot;
+
+/* Header of a frame absorbed under a key: GHASH state of the handle after the block */
+typedef struct {
+  uint8_t valid;
+  uint8_t epoch;
+  uint8_t frame_size;
+  uint32_t id;
+  uint32_t state;
+  cmox_gcm_poly_t partial_auth;
+} HeaderPrefix;
 
 
 static void update_iv();
+static void running_tag(uint8_t *tag);
+static void derive_mac_key(const uint8_t *slot_key, uint8_t *mac_key);
+static void prepare_slot(KeySlot *slot);
+static cmox_cipher_handle_t *keyed_copy(const KeySlot *slot, GcmHandle *copy);
+static cmox_cipher_retval_t bind_header(GcmHandle *ctx, uint32_t id, uint8_t epoch, size_t frame_size);
+static cmox_cipher_retval_t bind_stream_header(cmox_cipher_handle_t *ctx, uint32_t id, uint32_t length);
 
 
+/* Initial key (epoch 0) */
 const uint8_t key[] =
 {
   0x22, 0x4E, 0x61, 0x6D, 0xE1, 0x72, 0x69, 0xEB, 0x21, 0x20, 0x4E, 0x61, 0x69, 0x20, 0x68, 0x69,
   0x72, 0x75, 0x76, 0x61, 0x6C, 0x79, 0xEB, 0x20, 0x56, 0x61, 0x6C, 0x69, 0x6D, 0x61, 0x72, 0x22
 };
 
+/* Key-encryption key, only used to wrap the keys distributed over the bus */
+static const uint8_t kek[] =
+{
+  0x41, 0x20, 0x45, 0x6C, 0x62, 0x65, 0x72, 0x65, 0x74, 0x68, 0x20, 0x47, 0x69, 0x6C, 0x74, 0x68,
+  0x6F, 0x6E, 0x69, 0x65, 0x6C, 0x2C, 0x20, 0x6F, 0x20, 0x6D, 0x65, 0x6E, 0x65, 0x6C, 0x20, 0x70
+};
+
+/* Default initial value of the key wrap (RFC 3394) */
+static const uint8_t wrap_iv[] = {0xA6, 0xA6, 0xA6, 0xA6, 0xA6, 0xA6, 0xA6, 0xA6};
+
+/* Label of the windowed MAC key, derived from the key slot (not shared with the AEAD) */
+static const uint8_t mac_label[] = "FDSafe MAC window";
+
 uint8_t iv[IV_SIZE];
 
 cmox_cipher_retval_t retval;
 cmox_init_arg_t init_target = {CMOX_INIT_TARGET_AUTO, NULL};
 
+/* Selected engine */
+static CryptoEngine crypto_engine = CRYPTO_ENGINE_FAST;
+
+/* Key slots: the active one and the one being distributed */
+static KeySlot slots[KEY_SLOTS] CCMRAM_DATA;
+static uint8_t active_slot = 0;
+
+/* Header authentication, absorbed headers (direct-mapped by identifier) */
+static HeaderAad header_aad = HEADER_AAD_CACHED;
+static HeaderPrefix header_cache[HEADER_CACHE_SIZE] RAM_CRYPTO;
+
+/* Context of the message being encrypted */
+static GcmHandle work_ctx CCMRAM_DATA;
+
+/* Windowed MAC context (the handles hold no pointers to themselves, so they can be copied) */
+static cmox_cmac_handle_t cmac_ctx RAM_CRYPTO;
+static cmox_mac_handle_t *mac_ctx;
+
+/* Streaming encryption context (segmented messages) */
+static GcmHandle gcm_ctx RAM_CRYPTO;
+static cmox_cipher_handle_t *stream_ctx;
+
 
 void crypto_setup() {
 	if (cmox_initialize(&init_target) != CMOX_INIT_SUCCESS)
 	{
 		Error_Handler();
 	}
+
+	/* New session: fresh random prefix (the sequence goes on from the persistent counter) */
+	uint32_t session;
+	if (HAL_RNG_GenerateRandomNumber(&hrng, &session) != HAL_OK)
+	{
+		printf("Random number generation error\r\n");
+		Error_Handler();
+	}
+	iv[1] = (session >> 16) & 0xFF;
+	iv[2] = (session >> 8) & 0xFF;
+	iv[3] = session & 0xFF;
+
+	slots[0].valid = 1;
+	slots[0].epoch = 0;
+	memcpy(slots[0].key, key, KEY_SIZE);
+	active_slot = 0;
+
+	crypto_set_engine(CRYPTO_ENGINE_FAST);
+}
+
+void crypto_set_engine(CryptoEngine engine) {
+  crypto_engine = engine;
+
+  /* The contexts are engine specific */
+  for (uint8_t i = 0; i < KEY_SLOTS; i++) {
+    if (slots[i].valid) {
+      prepare_slot(&slots[i]);
+    }
+  }
+  memset(header_cache, 0, sizeof(header_cache));
+}
+
+void crypto_set_header_aad(HeaderAad mode) {
+  header_aad = mode;
+}
+
+void crypto_install_key(uint8_t epoch, const uint8_t *new_key) {
+  KeySlot *slot = &slots[(active_slot + 1) % KEY_SLOTS];
+
+  slot->valid = 1;
+  slot->epoch = epoch;
+  memcpy(slot->key, new_key, KEY_SIZE);
+  prepare_slot(slot);
+
+  /* The epoch wraps around: headers absorbed under an old key of the same epoch are dropped */
+  memset(header_cache, 0, sizeof(header_cache));
+}
+
+uint8_t crypto_activate_key(uint8_t epoch) {
+  for (uint8_t i = 0; i < KEY_SLOTS; i++) {
+    if (slots[i].valid && slots[i].epoch == epoch) {
+      active_slot = i;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+uint8_t crypto_key_epoch() {
+  return slots[active_slot].epoch;
+}
+
+void crypto_wrap_key(uint8_t epoch, const uint8_t *nonce, const uint8_t *new_key, uint8_t *wrapped) {
+  uint8_t plaintext[KEY_WRAP_HEADER_SIZE + KEY_SIZE] = {epoch};
+
+  memcpy(&plaintext[KEY_WRAP_NONCE_OFFSET], nonce, KEY_NONCE_SIZE);
+  memcpy(&plaintext[KEY_WRAP_HEADER_SIZE], new_key, KEY_SIZE);
+  retval = cmox_cipher_encrypt(CMOX_AESFAST_KEYWRAP_ENC_ALGO,
+                              plaintext, sizeof(plaintext),
+                              kek, sizeof(kek),
+                              wrap_iv, sizeof(wrap_iv),
+                              wrapped, NULL);
+  memset(plaintext, 0, sizeof(plaintext));
+
+  if (retval != CMOX_CIPHER_SUCCESS)
+  {
+    printf("Key wrap error\r\n");
+    Error_Handler();
+  }
 }
 
-void encrypt(uint8_t *plaintext, size_t plain_size, uint8_t *ciphertext, size_t cipher_size) {
+uint8_t crypto_check_key_proof(uint8_t epoch, const uint8_t *proof, uint8_t *next_nonce) {
+  uint8_t plaintext[KEY_PROOF_SIZE - KEY_WRAP_OVERHEAD];
+  uint8_t diff = 0;
+
+  for (uint8_t i = 0; i < KEY_SLOTS; i++) {
+    if (slots[i].valid && slots[i].epoch == epoch) {
+      retval = cmox_cipher_decrypt(CMOX_AESFAST_KEYWRAP_DEC_ALGO,
+                                  proof, KEY_PROOF_SIZE,
+                                  slots[i].key, KEY_SIZE,
+                                  wrap_iv, sizeof(wrap_iv),
+                                  plaintext, NULL);
+      if (retval != CMOX_CIPHER_AUTH_SUCCESS) {
+        return AUTH_ERROR;
+      }
+
+      /* The proof is the key wrapping the next nonce and a block of zeros */
+      for (uint8_t j = KEY_NONCE_SIZE; j < sizeof(plaintext); j++) {
+        diff |= plaintext[j];
+      }
+      if (diff) {
+        return AUTH_ERROR;
+      }
+      memcpy(next_nonce, plaintext, KEY_NONCE_SIZE);
+      return AUTH_OK;
+    }
+  }
+  return AUTH_ERROR;
+}
+
+CCMRAM_CODE void encrypt(uint32_t id, uint8_t *plaintext, size_t plain_size, uint8_t *ciphertext, size_t cipher_size) {
+  TRACE(TRACE_ENCRYPT_START, plain_size);
   update_iv();
-  retval = cmox_aead_encrypt(CMOX_AES_GCM_ENC_ALGO,         /* Use AES GCM algorithm */
-                            plaintext, plain_size,          /* Plaintext to encrypt */
-                            AUTH_TAG_SIZE,                  /* Authentication tag size */
-                            key, sizeof(key),               /* AES key to use */
-                            iv, IV_SIZE,                    /* Initialization vector */
-                            NULL, 0,                        /* Additional authenticated data */
-                            ciphertext, &cipher_size);      /* Data buffer to receive generated ciphertext and authentication tag */
+
+  /* Only the IV is set per message, the key schedule and GHASH table are precomputed */
+  cmox_cipher_handle_t *ctx = keyed_copy(&slots[active_slot], &work_ctx);
+  retval = cmox_cipher_setIV(ctx, iv, IV_SIZE);
+  if (retval == CMOX_CIPHER_SUCCESS) {
+    retval = bind_header(&work_ctx, id, slots[active_slot].epoch, plain_size + AUTH_TAG_SIZE + IV_SIZE);
+  }
+  if (retval == CMOX_CIPHER_SUCCESS) {
+    retval = cmox_cipher_append(ctx, plaintext, plain_size, ciphertext, NULL);
+  }
+  if (retval == CMOX_CIPHER_SUCCESS) {
+    retval = cmox_cipher_generateTag(ctx, &ciphertext[plain_size], NULL);
+  }
   
   /* Append IV to the ciphertext */
   memcpy(&ciphertext[plain_size + AUTH_TAG_SIZE], iv, IV_SIZE);
+  TRACE(TRACE_ENCRYPT_END, retval == CMOX_CIPHER_SUCCESS);
   
   if (retval != CMOX_CIPHER_SUCCESS)
   {
@@ -58,17 +245,250 @@ void encrypt(uint8_t *plaintext, size_t plain_size, uint8_t *ciphertext, size_t
   }
 }
 
+void mac_window_start() {
+  uint8_t mac_key[KEY_SIZE];
+
+  derive_mac_key(slots[active_slot].key, mac_key);
+
+  mac_ctx = cmox_cmac_construct(&cmac_ctx, CMOX_CMAC_AESFAST);
+  if (mac_ctx == NULL
+      || cmox_mac_init(mac_ctx) != CMOX_MAC_SUCCESS
+      || cmox_mac_setTagLen(mac_ctx, MAC_TAG_SIZE) != CMOX_MAC_SUCCESS
+      || cmox_mac_setKey(mac_ctx, mac_key, sizeof(mac_key)) != CMOX_MAC_SUCCESS)
+  {
+    printf("MAC setup error\r\n");
+    Error_Handler();
+  }
+  memset(mac_key, 0, sizeof(mac_key));
+}
+
+void mac_window_append(const uint8_t *data, size_t size, uint8_t *fragment) {
+  uint8_t tag[MAC_TAG_SIZE];
+
+  if (cmox_mac_append(mac_ctx, data, size) != CMOX_MAC_SUCCESS)
+  {
+    printf("MAC error\r\n");
+    Error_Handler();
+  }
+  running_tag(tag);
+  memcpy(fragment, tag, MAC_FRAGMENT_SIZE);
+}
+
+void mac_window_finish(uint8_t *tag) {
+  if (cmox_mac_generateTag(mac_ctx, tag, NULL) != CMOX_MAC_SUCCESS)
+  {
+    printf("MAC error\r\n");
+    Error_Handler();
+  }
+  cmox_mac_cleanup(mac_ctx);
+}
+
+void stream_encrypt_start(uint32_t id, uint32_t length, uint8_t *iv_out) {
+  update_iv();
+  stream_ctx = keyed_copy(&slots[active_slot], &gcm_ctx);
+  if (cmox_cipher_setIV(stream_ctx, iv, IV_SIZE) != CMOX_CIPHER_SUCCESS
+      || bind_stream_header(stream_ctx, id, length) != CMOX_CIPHER_SUCCESS)
+  {
+    printf("Encryption setup error\r\n");
+    Error_Handler();
+  }
+  memcpy(iv_out, iv, IV_SIZE);
+}
+
+void stream_encrypt_append(const uint8_t *plaintext, size_t size, uint8_t *ciphertext) {
+  if (cmox_cipher_append(stream_ctx, plaintext, size, ciphertext, NULL) != CMOX_CIPHER_SUCCESS)
+  {
+    printf("Encryption error\r\n");
+    Error_Handler();
+  }
+}
+
+void stream_encrypt_finish(uint8_t *tag) {
+  if (cmox_cipher_generateTag(stream_ctx, tag, NULL) != CMOX_CIPHER_SUCCESS)
+  {
+    printf("Encryption error\r\n");
+    Error_Handler();
+  }
+  cmox_cipher_cleanup(stream_ctx);
+}
+
+/**
+ * @brief Store the next initialization vector (key epoch, session and sequence)
+ * 
+ * The sequence comes from the persistent counter, so it never repeats, not
+ * even across resets: every IV is unique under the key and the receiver can
+ * reject replayed messages before decrypting them. The epoch tells the
+ * receiver which key slot to use.
+ * 
+ */
+CCMRAM_CODE static void update_iv() {
+  uint64_t sequence = counter_next();
+  iv[0] = slots[active_slot].epoch;
+  for (uint8_t i=0; i<IV_SEQUENCE_SIZE; i++) {
+    iv[IV_EPOCH_SIZE + IV_SESSION_SIZE + i] = (sequence >> (8 * (IV_SEQUENCE_SIZE - 1 - i))) & 0xFF;
+  }
+}
+
+/**
+ * @brief Derive the windowed MAC key from a key slot
+ * 
+ * NIST SP 800-108 KDF in counter mode with CMAC as the PRF: block i is the
+ * CMAC of i, the label, a zero byte and the key length in bits. A new key
+ * slot gives a new MAC key, the AEAD key itself is never used by CMAC.
+ * 
+ * @param slot_key Key of the slot (KEY_SIZE bytes)
+ * @param mac_key Buffer to store the MAC key (KEY_SIZE bytes)
+ */
+static void derive_mac_key(const uint8_t *slot_key, uint8_t *mac_key) {
+  /* The label is stored with its terminating zero, the separator */
+  uint8_t input[1 + sizeof(mac_label) + 2];
+  size_t tag_size;
+
+  memcpy(&input[1], mac_label, sizeof(mac_label));
+  input[1 + sizeof(mac_label)] = (uint8_t)((KEY_SIZE * 8) >> 8);
+  input[2 + sizeof(mac_label)] = (uint8_t)((KEY_SIZE * 8) & 0xFF);
+  for (uint8_t i = 0; i < KEY_SIZE / MAC_TAG_SIZE; i++) {
+    input[0] = i + 1;
+    if (cmox_mac_compute(CMOX_CMAC_AESFAST_ALGO, input, sizeof(input), slot_key, KEY_SIZE, NULL, 0,
+                         &mac_key[i * MAC_TAG_SIZE], MAC_TAG_SIZE, &tag_size) != CMOX_MAC_SUCCESS)
+    {
+      printf("MAC key derivation error\r\n");
+      Error_Handler();
+    }
+  }
+}
+
+/**
+ * @brief Get the tag of everything appended so far, without closing the window
+ * 
+ * @param tag Buffer of MAC_TAG_SIZE bytes
+ */
+static void running_tag(uint8_t *tag) {
+  cmox_cmac_handle_t running = cmac_ctx;
+  if (cmox_mac_generateTag(&running.super, tag, NULL) != CMOX_MAC_SUCCESS)
+  {
+    printf("MAC error\r\n");
+    Error_Handler();
+  }
+}
+
 /**
- * @brief Generate and store a new random initialization vector
+ * @brief Build the context of a key slot for the selected engine (key schedule and GHASH table)
+ * 
+ * @param slot Key slot with its key set
+ */
+static void prepare_slot(KeySlot *slot) {
+  cmox_cipher_handle_t *ctx;
+
+  switch (crypto_engine)
+  {
+    case CRYPTO_ENGINE_SMALL:
+      ctx = cmox_gcmSmall_construct(&slot->ctx.small, CMOX_AESSMALL_GCMSMALL_ENC);
+      break;
+    case CRYPTO_ENGINE_BALANCED:
+      ctx = cmox_gcmSmall_construct(&slot->ctx.small, CMOX_AESFAST_GCMSMALL_ENC);
+      break;
+    default:
+      ctx = cmox_gcmFast_construct(&slot->ctx.fast, CMOX_AESFAST_GCMFAST_ENC);
+      break;
+  }
+
+  if (ctx == NULL
+      || cmox_cipher_init(ctx) != CMOX_CIPHER_SUCCESS
+      || cmox_cipher_setTagLen(ctx, AUTH_TAG_SIZE) != CMOX_CIPHER_SUCCESS
+      || cmox_cipher_setKey(ctx, slot->key, KEY_SIZE) != CMOX_CIPHER_SUCCESS)
+  {
+    printf("Encryption setup error\r\n");
+    Error_Handler();
+  }
+}
+
+/**
+ * @brief Copy the keyed context of a slot, so it can take an IV
+ * 
+ * @param slot Key slot
+ * @param copy Handle to store the copy
+ * @return cmox_cipher_handle_t* Cipher handle of the copy
+ */
+CCMRAM_CODE static cmox_cipher_handle_t *keyed_copy(const KeySlot *slot, GcmHandle *copy) {
+  memcpy(copy, &slot->ctx, crypto_engine == CRYPTO_ENGINE_FAST ? sizeof(copy->fast) : sizeof(copy->small));
+  return &copy->super;
+}
+
+/**
+ * @brief Authenticate the header of a frame (handle with its IV set, before the payload)
+ * 
+ * GHASH over the additional data does not depend on the IV, only on the key:
+ * the state after the header block is kept per identifier and restored into
+ * the handle of the next frame instead of absorbing the block again.
  * 
+ * @param ctx Handle of the message
+ * @param id Identifier of the message
+ * @param epoch Epoch of the key of the handle
+ * @param frame_size Size of the frame (payload, tag and IV)
+ * @return cmox_cipher_retval_t Cipher return value
  */
-static void update_iv() {
-  uint32_t rand;
-  for (uint8_t i=0; i<3; i++) {
-    HAL_RNG_GenerateRandomNumber(&hrng, &rand);
-    iv[i * 4 + 0] = (rand >> 24) & 0xFF;
-    iv[i * 4 + 1] = (rand >> 16) & 0xFF;
-    iv[i * 4 + 2] = (rand >> 8) & 0xFF;
-    iv[i * 4 + 3] = rand & 0xFF;
-  }
-}
\ No newline at end of file
+CCMRAM_CODE static cmox_cipher_retval_t bind_header(GcmHandle *ctx, uint32_t id, uint8_t epoch, size_t frame_size) {
+  cmox_gcm_common_t *common = crypto_engine == CRYPTO_ENGINE_FAST ? &ctx->fast.common : &ctx->small.common;
+  HeaderPrefix *prefix = &header_cache[id % HEADER_CACHE_SIZE];
+  uint8_t aad[HEADER_AAD_SIZE] = {0};
+
+  if (header_aad == HEADER_AAD_OFF) {
+    return CMOX_CIPHER_SUCCESS;
+  }
+
+  if (header_aad == HEADER_AAD_CACHED && prefix->valid && prefix->id == id
+      && prefix->epoch == epoch && prefix->frame_size == frame_size)
+  {
+    memcpy(common->partialAuth, prefix->partial_auth, sizeof(cmox_gcm_poly_t));
+    common->AdLen = HEADER_AAD_SIZE;
+    ctx->super.internalState = prefix->state;
+    return CMOX_CIPHER_SUCCESS;
+  }
+
+  aad[0] = (uint8_t)(id >> 24);
+  aad[1] = (uint8_t)(id >> 16);
+  aad[2] = (uint8_t)(id >> 8);
+  aad[3] = (uint8_t)id;
+  aad[4] = (uint8_t)frame_size;
+  cmox_cipher_retval_t result = cmox_cipher_appendAD(&ctx->super, aad, HEADER_AAD_SIZE);
+
+  if (result == CMOX_CIPHER_SUCCESS && header_aad == HEADER_AAD_CACHED) {
+    prefix->valid = 1;
+    prefix->id = id;
+    prefix->epoch = epoch;
+    prefix->frame_size = (uint8_t)frame_size;
+    prefix->state = ctx->super.internalState;
+    memcpy(prefix->partial_auth, common->partialAuth, sizeof(cmox_gcm_poly_t));
+  }
+  return result;
+}
+
+/**
+ * @brief Absorb the header of a segmented message as additional data
+ * 
+ * Identifier (4, big-endian) and message length (4, big-endian) in one
+ * zero-padded block, absorbed once per message (not cached).
+ * 
+ * @param ctx Cipher handle with the IV set
+ * @param id Identifier of the segments
+ * @param length Plaintext length of the message
+ * @return cmox_cipher_retval_t Cipher return value
+ */
+static cmox_cipher_retval_t bind_stream_header(cmox_cipher_handle_t *ctx, uint32_t id, uint32_t length) {
+  uint8_t aad[HEADER_AAD_SIZE] = {0};
+
+  if (header_aad == HEADER_AAD_OFF) {
+    return CMOX_CIPHER_SUCCESS;
+  }
+
+  aad[0] = (uint8_t)(id >> 24);
+  aad[1] = (uint8_t)(id >> 16);
+  aad[2] = (uint8_t)(id >> 8);
+  aad[3] = (uint8_t)id;
+  aad[4] = (uint8_t)(length >> 24);
+  aad[5] = (uint8_t)(length >> 16);
+  aad[6] = (uint8_t)(length >> 8);
+  aad[7] = (uint8_t)length;
+  return cmox_cipher_appendAD(ctx, aad, HEADER_AAD_SIZE);
+}
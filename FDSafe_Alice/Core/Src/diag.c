@@ -0,0 +1,132 @@
+/**
+ * @file diag.c
+ * @author Luan
+ * @brief Diagnostic ReadDataByIdentifier service (UDS-like) over reserved CAN IDs
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include "diag.h"
+#include "fdcan.h"
+
+
+/* Responses are padded up to a valid CAN FD payload size */
+#define PADDING_BYTE 0xFF
+
+
+/* Node configuration */
+static uint32_t diag_request_id = 0;
+static uint32_t diag_response_id = 0;
+static DiagReadHandler diag_handler = NULL;
+
+/* Conversion from Data Length Code to real size in bytes */
+static const uint8_t DLCtoBytes[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+
+
+/* Static function prototypes */
+static void send_negative(uint8_t sid, uint8_t nrc);
+static void send_padded(uint8_t *response, size_t size);
+
+
+void diag_setup(uint32_t request_id, uint32_t response_id, DiagReadHandler handler) {
+	diag_request_id = request_id;
+	diag_response_id = response_id;
+	diag_handler = handler;
+}
+
+uint8_t diag_is_request(const FDCAN_RxHeaderTypeDef *RxHeader) {
+	return diag_handler != NULL
+		&& RxHeader->IdType == FDCAN_STANDARD_ID
+		&& RxHeader->Identifier == diag_request_id;
+}
+
+void diag_process(const FDCAN_RxHeaderTypeDef *RxHeader, const uint8_t *data) {
+	uint8_t response[DIAG_HEADER_SIZE + DIAG_MAX_DATA_SIZE];
+	uint8_t size = DLCtoBytes[RxHeader->DataLength & 0xF];
+
+	if (size < 1) {
+		return;
+	}
+
+	if (data[0] != DIAG_SID_READ_DATA_BY_ID) {
+		send_negative(data[0], DIAG_NRC_SERVICE_NOT_SUPPORTED);
+		return;
+	}
+
+	if (size < DIAG_HEADER_SIZE) {
+		send_negative(data[0], DIAG_NRC_INCORRECT_LENGTH);
+		return;
+	}
+
+	uint16_t did = (data[1] << 8) | data[2];
+	size_t data_size = diag_handler(did, &response[DIAG_HEADER_SIZE]);
+
+	if (data_size == 0) {
+		send_negative(data[0], DIAG_NRC_REQUEST_OUT_OF_RANGE);
+		return;
+	}
+
+	response[0] = DIAG_SID_READ_DATA_BY_ID + DIAG_POSITIVE_RESPONSE;
+	response[1] = data[1];
+	response[2] = data[2];
+	send_padded(response, DIAG_HEADER_SIZE + data_size);
+}
+
+uint8_t *diag_put_u32(uint8_t *data, uint32_t value) {
+	data[0] = (uint8_t)(value >> 24);
+	data[1] = (uint8_t)(value >> 16);
+	data[2] = (uint8_t)(value >> 8);
+	data[3] = (uint8_t)value;
+	return data + 4;
+}
+
+uint8_t *diag_put_hist(uint8_t *data, const Histogram *hist) {
+	data = diag_put_u32(data, hist->count);
+	data = diag_put_u32(data, hist->count ? hist->min : 0);
+	data = diag_put_u32(data, hist_percentile(hist, 500));
+	data = diag_put_u32(data, hist_percentile(hist, 990));
+	return diag_put_u32(data, hist->max);
+}
+
+/**
+ * @brief Send a negative response
+ *
+ * @param sid Service identifier of the request
+ * @param nrc Negative response code
+ */
+static void send_negative(uint8_t sid, uint8_t nrc) {
+	uint8_t response[8] = {DIAG_NEGATIVE_RESPONSE, sid, nrc};
+	send_padded(response, 3);
+}
+
+/**
+ * @brief Pad the response up to a valid payload size and send it
+ *
+ * The requests are not authenticated, so a burst of them must not stop the
+ * node: the response is dropped when the TX FIFO is full (the poller asks
+ * again).
+ *
+ * @param response Response buffer (at least the padded size)
+ * @param size Size of the response
+ */
+static void send_padded(uint8_t *response, size_t size) {
+	uint8_t dlc = 0;
+
+	if (!fdcan_free_to_send()) {
+		return;
+	}
+
+	while (DLCtoBytes[dlc] < size) {
+		dlc++;
+	}
+
+	for (size_t i = size; i < DLCtoBytes[dlc]; i++) {
+		response[i] = PADDING_BYTE;
+	}
+
+	fdcan_send(diag_response_id, response, DLCtoBytes[dlc]);
+}
@@ -10,16 +10,98 @@
  */
 
 
+#include <string.h>
 #include "fdcan.h"
+#include "diag.h"
+#include "isotp.h"
+#include "rekey.h"
+#include "ccmram.h"
+#include "ram.h"
+
+
+/* Hardware TX FIFO depth */
+#define TX_FIFO_DEPTH 3
+
+/* Frames staged in RAM ahead of the TX FIFO (double buffer) */
+#define TX_STAGE_DEPTH 2
+
+/* Bits of a frame with a standard ID sent at the nominal bit rate (SOF to BRS, CRC delimiter to IFS) */
+#define NOMINAL_FRAME_BITS 30
+
+/* Bits of the data phase besides the payload (ESI, DLC and stuff count) */
+#define DATA_PHASE_BITS 9
+
+
+/* Transmission counters */
+static uint32_t tx_count = 0;
+static uint32_t tx_high_water = 0;
+static uint32_t tx_replaced = 0;
+static uint32_t tx_dropped = 0;
+
+/* Identifier of the last message added to each TX buffer */
+static uint32_t buffer_ids[TX_FIFO_DEPTH];
+
+/* Frames built by the CPU while the TX FIFO is full, moved to it by the TX complete interrupt */
+typedef struct {
+	FDCAN_TxHeaderTypeDef header;
+	uint8_t data[64];
+} StagedFrame;
+
+static StagedFrame stage[TX_STAGE_DEPTH] RAM_RINGS;
+static volatile uint32_t stage_head = 0;
+static volatile uint32_t stage_count = 0;
+static uint8_t pipeline_enabled = 0;
+
+/* Timestamp counter state */
+static volatile uint32_t timestamp_wraps = 0;
+static uint32_t timestamp_tick_ns = 0;
+
+/* Bit rate switch of the sent messages */
+static uint8_t brs_enabled = 0;
+
+/* Valid CAN FD payload sizes */
+static const uint8_t DLCtoBytes[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
 
 
 /* Static functions prototypes */
+static void send_frame(uint32_t id, uint8_t *data, size_t size, uint32_t event, uint8_t marker, uint8_t staged);
+static uint32_t compute_tick_ns();
 static void build_header(FDCAN_TxHeaderTypeDef *TxHeader, uint32_t id, size_t size);
+static HAL_StatusTypeDef queue_frame(FDCAN_TxHeaderTypeDef *TxHeader, uint8_t *data);
+static HAL_StatusTypeDef stage_frame(FDCAN_TxHeaderTypeDef *TxHeader, uint8_t *data);
+static void drain_stage();
 
 
 void fdcan_setup() {
 	HAL_StatusTypeDef ret;
 
+	/* The data phase is sampled before the transceiver loop delay allows, so compensate it */
+	uint32_t sample_point = hfdcan1.Init.DataPrescaler * (1 + hfdcan1.Init.DataTimeSeg1);
+	if (HAL_FDCAN_ConfigTxDelayCompensation(&hfdcan1, sample_point, 0) != HAL_OK
+			|| HAL_FDCAN_EnableTxDelayCompensation(&hfdcan1) != HAL_OK)
+	{
+		printf("FDCAN delay compensation setup failed\r\n");
+		Error_Handler();
+	}
+
+	/* Hardware timestamps of the TX events */
+	if (HAL_FDCAN_ConfigTimestampCounter(&hfdcan1, FDCAN_TIMESTAMP_PRESCALER) != HAL_OK
+			|| HAL_FDCAN_EnableTimestampCounter(&hfdcan1, FDCAN_TIMESTAMP_INTERNAL) != HAL_OK
+			|| HAL_FDCAN_ActivateNotification(&hfdcan1, FDCAN_IT_TIMESTAMP_WRAPAROUND, 0) != HAL_OK)
+	{
+		printf("FDCAN timestamp setup failed\r\n");
+		Error_Handler();
+	}
+	timestamp_tick_ns = compute_tick_ns();
+
+	/* The TX complete interrupt moves the staged frames to the TX FIFO */
+	if (HAL_FDCAN_ActivateNotification(&hfdcan1, FDCAN_IT_TX_COMPLETE,
+			FDCAN_TX_BUFFER0 | FDCAN_TX_BUFFER1 | FDCAN_TX_BUFFER2) != HAL_OK)
+	{
+		printf("FDCAN notification setup failed\r\n");
+		Error_Handler();
+	}
+
 	ret = HAL_FDCAN_Start(&hfdcan1);
     if (ret != HAL_OK) {
 		Error_Handler();
@@ -28,17 +110,232 @@ void fdcan_setup() {
     HAL_GPIO_WritePin(CAN_MODE_GPIO_Port, CAN_MODE_Pin, GPIO_PIN_RESET);
 }
 
-void fdcan_send(uint32_t id, uint8_t *data, size_t size) {
+CCMRAM_CODE void fdcan_send(uint32_t id, uint8_t *data, size_t size) {
+	send_frame(id, data, size, FDCAN_NO_TX_EVENTS, 0, 0);
+}
+
+void fdcan_send_with_event(uint32_t id, uint8_t *data, size_t size, uint8_t marker) {
+	send_frame(id, data, size, FDCAN_STORE_TX_EVENTS, marker, 0);
+}
+
+uint8_t fdcan_tx_event(uint8_t *marker, uint32_t *timestamp) {
+	FDCAN_TxEventFifoTypeDef TxEvent;
+
+	if ((hfdcan1.Instance->TXEFS & FDCAN_TXEFS_EFFL) == 0
+			|| HAL_FDCAN_GetTxEvent(&hfdcan1, &TxEvent) != HAL_OK) {
+		return 0;
+	}
+	*marker = (uint8_t)TxEvent.MessageMarker;
+	*timestamp = fdcan_timestamp_extend(TxEvent.TxTimestamp);
+	return 1;
+}
+
+void fdcan_timestamp_wrap_callback(FDCAN_HandleTypeDef *hfdcan) {
+	timestamp_wraps++;
+}
+
+uint32_t fdcan_timestamp_extend(uint32_t timestamp) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	uint32_t wraps = timestamp_wraps;
+	uint32_t now = HAL_FDCAN_GetTimestampCounter(&hfdcan1);
+
+	/* Wrap-around already happened but its interrupt is still pending */
+	if (__HAL_FDCAN_GET_FLAG(&hfdcan1, FDCAN_FLAG_TIMESTAMP_WRAPAROUND)) {
+		wraps++;
+		now = HAL_FDCAN_GetTimestampCounter(&hfdcan1);
+	}
+
+	__set_PRIMASK(primask);
+
+	/* Event stamped before the last wrap-around */
+	if (timestamp > now) {
+		wraps--;
+	}
+
+	return (wraps << 16) | (timestamp & 0xFFFF);
+}
+
+uint32_t fdcan_timestamp_now() {
+	return fdcan_timestamp_extend(HAL_FDCAN_GetTimestampCounter(&hfdcan1));
+}
+
+uint32_t fdcan_timestamp_to_usec(uint32_t ticks) {
+	return (uint32_t)(((uint64_t)ticks * timestamp_tick_ns) / 1000);
+}
+
+CCMRAM_CODE void fdcan_send_latest(uint32_t id, uint8_t *data, size_t size) {
+	/* A staged frame is replaced in place */
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	for (uint32_t i = 0; i < stage_count; i++) {
+		StagedFrame *frame = &stage[(stage_head + i) % TX_STAGE_DEPTH];
+		if (frame->header.Identifier == id && size <= sizeof(frame->data)) {
+			size_t frame_size = fdcan_frame_size(size);
+			build_header(&frame->header, id, frame_size);
+			memcpy(frame->data, data, size);
+			memset(&frame->data[size], 0xFF, frame_size - size);
+			tx_replaced++;
+			__set_PRIMASK(primask);
+			return;
+		}
+	}
+	__set_PRIMASK(primask);
+
+	uint32_t cancelled = 0;
+	for (uint32_t i = 0; i < TX_FIFO_DEPTH; i++) {
+		uint32_t buffer = 1U << i;
+		if (buffer_ids[i] != id || !HAL_FDCAN_IsTxBufferMessagePending(&hfdcan1, buffer)) {
+			continue;
+		}
+
+		/* A frame already on the bus is not cancelled: wait for either outcome (one frame time at most) */
+		HAL_FDCAN_AbortTxRequest(&hfdcan1, buffer);
+		while (HAL_FDCAN_IsTxBufferMessagePending(&hfdcan1, buffer));
+		if ((hfdcan1.Instance->TXBTO & buffer) == 0) {
+			cancelled++;
+		}
+	}
+
+	/* In FIFO mode, a cancelled buffer behind the head frees no slot until the frames ahead of it leave */
+	if (HAL_FDCAN_GetTxFifoFreeLevel(&hfdcan1)) {
+		tx_replaced += cancelled;
+	}
+
+	/* Staged while the TX FIFO is full. With the stage full of other identifiers too, the value
+	 * is dropped (and counted) rather than waited for: the next one of the identifier goes out */
+	primask = __get_PRIMASK();
+	__disable_irq();
+	drain_stage();
+	uint8_t full = stage_count == TX_STAGE_DEPTH && !HAL_FDCAN_GetTxFifoFreeLevel(&hfdcan1);
+	__set_PRIMASK(primask);
+	if (full) {
+		tx_dropped++;
+		return;
+	}
+	send_frame(id, data, size, FDCAN_NO_TX_EVENTS, 0, 1);
+}
+
+void fdcan_set_pipeline(uint8_t enabled) {
+	/* Frames still staged are sent before switching */
+	while (stage_count > 0) {
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		drain_stage();
+		__set_PRIMASK(primask);
+	}
+	pipeline_enabled = enabled;
+}
+
+CCMRAM_CODE void fdcan_tx_complete_callback(FDCAN_HandleTypeDef *hfdcan, uint32_t BufferIndexes) {
+	(void)hfdcan;
+	(void)BufferIndexes;
+	drain_stage();
+}
+
+void fdcan_filter_setup() {
+    FDCAN_FilterTypeDef sFilterConfig;
+
+	/* Only diagnostic requests to Alice, segmented transfer flow control, key acknowledgements and nonces are received */
+	sFilterConfig.IdType = FDCAN_STANDARD_ID;
+	sFilterConfig.FilterIndex = 0;
+	sFilterConfig.FilterType = FDCAN_FILTER_DUAL;
+	sFilterConfig.FilterConfig = FDCAN_FILTER_TO_RXFIFO0;
+	sFilterConfig.FilterID1 = DIAG_ALICE_REQUEST_ID;
+	sFilterConfig.FilterID2 = ISOTP_FC_ID;
+
+	if (HAL_FDCAN_ConfigFilter(&hfdcan1, &sFilterConfig) != HAL_OK)
+	{
+		printf("FDCAN filter setup failed\r\n");
+		Error_Handler();
+	}
+
+	sFilterConfig.FilterIndex = 1;
+	sFilterConfig.FilterID1 = ID_KEY_ACK;
+	sFilterConfig.FilterID2 = ID_KEY_NONCE;
+
+	if (HAL_FDCAN_ConfigFilter(&hfdcan1, &sFilterConfig) != HAL_OK
+			|| HAL_FDCAN_ConfigGlobalFilter(&hfdcan1, FDCAN_REJECT, FDCAN_REJECT,
+					FDCAN_REJECT_REMOTE, FDCAN_REJECT_REMOTE) != HAL_OK)
+	{
+		printf("FDCAN filter setup failed\r\n");
+		Error_Handler();
+	}
+}
+
+uint32_t fdcan_available() {
+    return HAL_FDCAN_GetRxFifoFillLevel(&hfdcan1, FDCAN_RX_FIFO0);
+}
+
+CCMRAM_CODE void fdcan_read(FDCAN_RxHeaderTypeDef *RxHeader, uint8_t *RxData) {
+    if (HAL_FDCAN_GetRxMessage(&hfdcan1, FDCAN_RX_FIFO0, RxHeader, RxData)
+            != HAL_OK)
+    {
+		printf("FDCAN read failed\r\n");
+        Error_Handler();
+    }
+}
+
+/**
+ * @brief Pad, build the header and send (or stage) a message
+ * 
+ * @param id Identifier of the message
+ * @param data Payload
+ * @param size Size of the payload
+ * @param event FDCAN_STORE_TX_EVENTS to store the TX event, FDCAN_NO_TX_EVENTS otherwise
+ * @param marker Marker of the TX event
+ * @param staged 1 to stage the frame while the TX FIFO is full, even without the pipeline
+ */
+CCMRAM_CODE static void send_frame(uint32_t id, uint8_t *data, size_t size, uint32_t event, uint8_t marker, uint8_t staged) {
 	HAL_StatusTypeDef ret;
 	FDCAN_TxHeaderTypeDef TxHeader;
 
-    build_header(&TxHeader, id, size);
-	ret = HAL_FDCAN_AddMessageToTxFifoQ(&hfdcan1, &TxHeader, data);
+	/* Sizes between two valid payload sizes are padded (build_header only maps valid sizes) */
+	uint8_t padded[64];
+	size_t frame_size = fdcan_frame_size(size);
+	if (size > frame_size) {
+		printf("FDCAN payload too large: %u\r\n", (unsigned int)size);
+		Error_Handler();
+	}
+	if (frame_size != size) {
+		memcpy(padded, data, size);
+		memset(&padded[size], 0xFF, frame_size - size);
+		data = padded;
+	}
+
+    build_header(&TxHeader, id, frame_size);
+	TxHeader.TxEventFifoControl = event;
+	TxHeader.MessageMarker = marker;
+	/* Frames still staged go first, whatever the mode */
+	if (pipeline_enabled || staged || stage_count > 0) {
+		ret = stage_frame(&TxHeader, data);
+	}
+	else {
+		ret = queue_frame(&TxHeader, data);
+	}
+	TRACE(TRACE_TX_COMMIT, id);
 	
 	if (ret != HAL_OK) {
 		printf("FDCAN send error: %d\r\n", (int)ret);
         Error_Handler();
     }
+
+	tx_count++;
+}
+
+/**
+ * @brief Compute the duration of a timestamp tick from the nominal bit timing
+ * 
+ * @return uint32_t Tick duration in nanoseconds
+ */
+static uint32_t compute_tick_ns() {
+	uint32_t divider = hfdcan1.Init.ClockDivider ? 2 * hfdcan1.Init.ClockDivider : 1;
+	uint32_t kernel_clock = HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_FDCAN) / divider;
+	uint32_t bit_quanta = 1 + hfdcan1.Init.NominalTimeSeg1 + hfdcan1.Init.NominalTimeSeg2;
+	uint64_t bit_ns = (uint64_t)bit_quanta * hfdcan1.Init.NominalPrescaler * 1000000000U / kernel_clock;
+
+	return (uint32_t)(bit_ns * FDCAN_TIMESTAMP_BITS_PER_TICK);
 }
 
 /**
@@ -48,12 +345,12 @@ void fdcan_send(uint32_t id, uint8_t *data, size_t size) {
  * @param id Identifier of the message
  * @param size Size of the payload
  */
-static void build_header(FDCAN_TxHeaderTypeDef *TxHeader, uint32_t id, size_t size) {
+CCMRAM_CODE static void build_header(FDCAN_TxHeaderTypeDef *TxHeader, uint32_t id, size_t size) {
 	TxHeader->Identifier = id;
 	TxHeader->IdType = FDCAN_STANDARD_ID;
 	TxHeader->TxFrameType = FDCAN_FRAME_FD_NO_BRS;
 	TxHeader->ErrorStateIndicator = FDCAN_ESI_ACTIVE;
-	TxHeader->BitRateSwitch = FDCAN_BRS_OFF;
+	TxHeader->BitRateSwitch = brs_enabled ? FDCAN_BRS_ON : FDCAN_BRS_OFF;
 	TxHeader->FDFormat = FDCAN_FD_CAN;
 	TxHeader->TxEventFifoControl = FDCAN_NO_TX_EVENTS;
 	TxHeader->MessageMarker = 0;
@@ -114,5 +411,133 @@ static void build_header(FDCAN_TxHeaderTypeDef *TxHeader, uint32_t id, size_t si
 }
 
 uint8_t fdcan_free_to_send() {
+	if ((pipeline_enabled || stage_count > 0) && stage_count < TX_STAGE_DEPTH) {
+		return 1;
+	}
 	return HAL_FDCAN_GetTxFifoFreeLevel(&hfdcan1);
-}
\ No newline at end of file
+}
+
+uint32_t fdcan_tx_count() {
+	return tx_count;
+}
+
+uint32_t fdcan_tx_high_water() {
+	return tx_high_water;
+}
+
+uint32_t fdcan_tx_replaced() {
+	return tx_replaced;
+}
+
+uint32_t fdcan_tx_dropped() {
+	return tx_dropped;
+}
+
+void fdcan_set_brs(uint8_t enabled) {
+	brs_enabled = enabled;
+}
+
+size_t fdcan_frame_size(size_t size) {
+	for (uint32_t i = 0; i < sizeof(DLCtoBytes); i++) {
+		if (DLCtoBytes[i] >= size) {
+			return DLCtoBytes[i];
+		}
+	}
+	return DLCtoBytes[sizeof(DLCtoBytes) - 1];
+}
+
+uint32_t fdcan_frame_time_ns(size_t size) {
+	uint32_t crc_bits = size > 16 ? 21 : 17;
+
+	/* Fixed stuff bits: one every 4 bits of the stuff count and CRC */
+	uint32_t data_bits = DATA_PHASE_BITS + 8 * size + crc_bits + (4 + crc_bits + 3) / 4;
+	uint32_t nominal_tq = hfdcan1.Init.NominalPrescaler
+			* (1 + hfdcan1.Init.NominalTimeSeg1 + hfdcan1.Init.NominalTimeSeg2);
+	uint32_t data_tq = nominal_tq;
+	if (brs_enabled) {
+		data_tq = hfdcan1.Init.DataPrescaler * (1 + hfdcan1.Init.DataTimeSeg1 + hfdcan1.Init.DataTimeSeg2);
+	}
+
+	uint64_t clocks = (uint64_t)NOMINAL_FRAME_BITS * nominal_tq + (uint64_t)data_bits * data_tq;
+	return (uint32_t)(clocks * 1000000000ULL / HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_FDCAN));
+}
+
+/**
+ * @brief Add a frame to the TX FIFO and record its buffer
+ * 
+ * @param TxHeader Header of the frame
+ * @param data Payload of the frame
+ * @return HAL_StatusTypeDef HAL_OK if added
+ */
+CCMRAM_CODE static HAL_StatusTypeDef queue_frame(FDCAN_TxHeaderTypeDef *TxHeader, uint8_t *data) {
+	HAL_StatusTypeDef ret = HAL_FDCAN_AddMessageToTxFifoQ(&hfdcan1, TxHeader, data);
+	if (ret != HAL_OK) {
+		return ret;
+	}
+
+	/* Remember which identifier each buffer holds, so a stale frame can be found */
+	uint32_t buffer = HAL_FDCAN_GetLatestTxFifoQRequestBuffer(&hfdcan1);
+	for (uint32_t i = 0; i < TX_FIFO_DEPTH; i++) {
+		if (buffer == (1U << i)) {
+			buffer_ids[i] = TxHeader->Identifier;
+		}
+	}
+
+	uint32_t pending = TX_FIFO_DEPTH - HAL_FDCAN_GetTxFifoFreeLevel(&hfdcan1);
+	if (pending > tx_high_water) {
+		tx_high_water = pending;
+	}
+	return HAL_OK;
+}
+
+/**
+ * @brief Add a frame to the TX FIFO, or stage it while the TX FIFO is full
+ * 
+ * The staged frames keep their order: a new frame is only added directly when
+ * nothing is staged.
+ * 
+ * @param TxHeader Header of the frame
+ * @param data Payload of the frame
+ * @return HAL_StatusTypeDef HAL_OK if added or staged, HAL_ERROR if both are full
+ */
+CCMRAM_CODE static HAL_StatusTypeDef stage_frame(FDCAN_TxHeaderTypeDef *TxHeader, uint8_t *data) {
+	HAL_StatusTypeDef ret = HAL_OK;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	/* Cancelled frames free buffers without a TX complete interrupt */
+	drain_stage();
+
+	if (stage_count == 0 && HAL_FDCAN_GetTxFifoFreeLevel(&hfdcan1)) {
+		ret = queue_frame(TxHeader, data);
+	}
+	else if (stage_count < TX_STAGE_DEPTH) {
+		StagedFrame *frame = &stage[(stage_head + stage_count) % TX_STAGE_DEPTH];
+		frame->header = *TxHeader;
+		memcpy(frame->data, data, DLCtoBytes[TxHeader->DataLength]);
+		stage_count++;
+	}
+	else {
+		ret = HAL_ERROR;
+	}
+
+	__set_PRIMASK(primask);
+	return ret;
+}
+
+/**
+ * @brief Move the staged frames to the TX FIFO while it has room
+ * 
+ * Called from the TX complete interrupt, or with the interrupts disabled.
+ * 
+ */
+CCMRAM_CODE static void drain_stage() {
+	while (stage_count > 0 && HAL_FDCAN_GetTxFifoFreeLevel(&hfdcan1)) {
+		StagedFrame *frame = &stage[stage_head];
+		if (queue_frame(&frame->header, frame->data) != HAL_OK) {
+			break;
+		}
+		stage_head = (stage_head + 1) % TX_STAGE_DEPTH;
+		stage_count--;
+	}
+}
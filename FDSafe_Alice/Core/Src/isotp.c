@@ -0,0 +1,243 @@
+/**
+ * @file isotp.c
+ * @author Luan
+ * @brief Segmented transmission (ISO-TP-like) of messages encrypted on the fly
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include <string.h>
+#include "isotp.h"
+#include "fdcan.h"
+#include "uart.h"
+#include "ram.h"
+
+
+/* Cipher block size (every append but the last one is a multiple of it) */
+#define BLOCK_SIZE 16
+
+/* Encrypted stream bytes ready to be sent (up to a frame plus one append) */
+#define PENDING_SIZE 128
+
+
+/* Transfer state */
+typedef enum {
+	ISOTP_IDLE = 0,
+	ISOTP_FIRST,			/* First frame waiting for room in the TX FIFO */
+	ISOTP_WAIT_FC,
+	ISOTP_SENDING,
+} IsotpState;
+
+static struct {
+	IsotpState state;
+	IsotpSource source;
+	uint32_t length;		/* Plaintext size */
+	uint32_t encrypted;		/* Plaintext bytes already encrypted */
+	uint32_t sent;			/* Stream (ciphertext and tag) bytes already sent */
+	uint8_t tag_added;
+	uint8_t sn;				/* Sequence number of the next consecutive frame */
+	uint8_t block_size;		/* Frames granted per flow control (0: all) */
+	uint8_t block_count;
+	uint32_t st_min;		/* Minimum separation time between consecutive frames (ms) */
+	uint32_t next_frame;
+	uint32_t timer;
+	uint32_t start;
+} tx;
+
+/* Encrypted stream not sent yet */
+static uint8_t pending[PENDING_SIZE] RAM_RINGS;
+static size_t pending_size;
+
+
+/* Static function prototypes */
+static void produce(size_t size);
+static void send_first();
+static void send_segment(uint8_t *frame, size_t header_size);
+static void finish(const char *result);
+
+
+uint8_t isotp_send(uint32_t length, IsotpSource source) {
+	if (tx.state != ISOTP_IDLE || length == 0 || length > ISOTP_MAX_MESSAGE_SIZE) {
+		return 0;
+	}
+
+	tx.source = source;
+	tx.length = length;
+	tx.encrypted = 0;
+	tx.sent = 0;
+	tx.tag_added = 0;
+	tx.sn = 1;
+	tx.start = HAL_GetTick();
+	pending_size = 0;
+
+	/* Sent by isotp_poll() if the TX FIFO is full */
+	tx.state = ISOTP_FIRST;
+	if (fdcan_free_to_send()) {
+		send_first();
+	}
+	return 1;
+}
+
+void isotp_poll() {
+	uint8_t frame[ISOTP_FRAME_SIZE];
+
+	if (tx.state == ISOTP_FIRST) {
+		if (fdcan_free_to_send()) {
+			send_first();
+		}
+		return;
+	}
+
+	if (tx.state == ISOTP_WAIT_FC) {
+		if (HAL_GetTick() - tx.timer >= ISOTP_TIMEOUT) {
+			finish("timed out");
+		}
+		return;
+	}
+
+	if (tx.state != ISOTP_SENDING || !fdcan_free_to_send() || HAL_GetTick() < tx.next_frame) {
+		return;
+	}
+
+	/* Last frame of the granted block: wait for the next flow control */
+	if (tx.block_size && ++tx.block_count == tx.block_size) {
+		tx.state = ISOTP_WAIT_FC;
+		tx.timer = HAL_GetTick();
+	}
+
+	frame[0] = ISOTP_PCI_CONSECUTIVE | tx.sn;
+	send_segment(frame, ISOTP_CF_HEADER_SIZE);
+	tx.sn = (tx.sn + 1) & 0x0F;
+	tx.next_frame = HAL_GetTick() + tx.st_min;
+
+	if (tx.sent == tx.length + AUTH_TAG_SIZE) {
+		finish("sent");
+	}
+}
+
+uint8_t isotp_is_flow_control(const FDCAN_RxHeaderTypeDef *RxHeader) {
+	return RxHeader->IdType == FDCAN_STANDARD_ID
+		&& RxHeader->Identifier == ISOTP_FC_ID;
+}
+
+void isotp_flow_control(const uint8_t *data) {
+	if (tx.state != ISOTP_WAIT_FC || (data[0] & 0xF0) != ISOTP_PCI_FLOW_CONTROL) {
+		return;
+	}
+
+	switch (data[0] & 0x0F) {
+		case ISOTP_FLOW_CTS:
+			tx.block_size = data[1];
+			tx.block_count = 0;
+			/* 0xF1-0xF9 are sub-millisecond times, rounded up */
+			tx.st_min = data[2] <= 0x7F ? data[2] : 1;
+			tx.next_frame = HAL_GetTick();
+			tx.state = ISOTP_SENDING;
+			break;
+		case ISOTP_FLOW_WAIT:
+			tx.timer = HAL_GetTick();
+			break;
+		default:
+			finish("rejected");
+			break;
+	}
+}
+
+/**
+ * @brief Encrypt plaintext until a given amount of the stream is pending (or the stream is over)
+ *
+ * The plaintext is requested in multiples of the cipher block, only the last
+ * append may be shorter. The tag is added to the stream after the last append.
+ *
+ * @param size Amount of stream bytes needed
+ */
+static void produce(size_t size) {
+	uint8_t plaintext[PENDING_SIZE / 2];
+
+	while (pending_size < size && !tx.tag_added) {
+		uint32_t remaining = tx.length - tx.encrypted;
+
+		if (remaining == 0) {
+			stream_encrypt_finish(&pending[pending_size]);
+			pending_size += AUTH_TAG_SIZE;
+			tx.tag_added = 1;
+			break;
+		}
+
+		size_t chunk = (size - pending_size + BLOCK_SIZE - 1) & ~(BLOCK_SIZE - 1);
+		if (chunk > sizeof(plaintext)) {
+			chunk = sizeof(plaintext);
+		}
+		if (chunk > remaining) {
+			chunk = remaining;
+		}
+
+		tx.source(tx.encrypted, plaintext, chunk);
+		stream_encrypt_append(plaintext, chunk, &pending[pending_size]);
+		pending_size += chunk;
+		tx.encrypted += chunk;
+	}
+}
+
+/**
+ * @brief Send the first frame (length and IV) and wait for the flow control
+ *
+ */
+static void send_first() {
+	uint8_t frame[ISOTP_FRAME_SIZE];
+
+	frame[0] = ISOTP_PCI_FIRST;
+	frame[1] = (uint8_t)(tx.length >> 24);
+	frame[2] = (uint8_t)(tx.length >> 16);
+	frame[3] = (uint8_t)(tx.length >> 8);
+	frame[4] = (uint8_t)tx.length;
+	stream_encrypt_start(ISOTP_DATA_ID, tx.length, &frame[5]);
+
+	/* Set before sending, the flow control may be processed right away */
+	tx.state = ISOTP_WAIT_FC;
+	tx.timer = HAL_GetTick();
+	send_segment(frame, ISOTP_FF_HEADER_SIZE);
+
+	if (tx.sent == tx.length + AUTH_TAG_SIZE) {
+		finish("sent");
+	}
+}
+
+/**
+ * @brief Fill a frame with the next stream bytes and send it
+ *
+ * @param frame Frame with its header already written
+ * @param header_size Size of the header
+ */
+static void send_segment(uint8_t *frame, size_t header_size) {
+	size_t size = ISOTP_FRAME_SIZE - header_size;
+	uint32_t left = tx.length + AUTH_TAG_SIZE - tx.sent;
+	if (size > left) {
+		size = left;
+	}
+
+	produce(size);
+	memcpy(&frame[header_size], pending, size);
+	pending_size -= size;
+	memmove(pending, &pending[size], pending_size);
+	tx.sent += size;
+
+	fdcan_send(ISOTP_DATA_ID, frame, header_size + size);
+}
+
+/**
+ * @brief End the transfer and report it
+ *
+ * @param result Outcome of the transfer
+ */
+static void finish(const char *result) {
+	tx.state = ISOTP_IDLE;
+	printf("ISO-TP %s: %u/%u bytes in %u ms\r\n", result,
+		(unsigned int)(tx.sent > tx.length ? tx.length : tx.sent),
+		(unsigned int)tx.length,
+		(unsigned int)(HAL_GetTick() - tx.start));
+}
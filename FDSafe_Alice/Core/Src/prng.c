@@ -0,0 +1,66 @@
+/**
+ * @file prng.c
+ * @author Luan
+ * @brief Fast pseudo-random number generator (xoshiro128**) for the simulations
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include "prng.h"
+#include "main.h"
+#include "uart.h"
+
+
+/* Generator state (must not be all zeros) */
+static uint32_t state[4];
+
+
+/* Static function prototypes */
+static inline uint32_t rotl(uint32_t x, uint32_t k);
+
+
+void prng_setup() {
+	do {
+		for (uint32_t i = 0; i < 4; i++) {
+			if (HAL_RNG_GenerateRandomNumber(&hrng, &state[i]) != HAL_OK) {
+				printf("Random number generation error\r\n");
+				Error_Handler();
+			}
+		}
+	} while ((state[0] | state[1] | state[2] | state[3]) == 0);
+}
+
+uint32_t prng_next() {
+	uint32_t result = rotl(state[1] * 5, 7) * 9;
+	uint32_t t = state[1] << 9;
+
+	state[2] ^= state[0];
+	state[3] ^= state[1];
+	state[1] ^= state[2];
+	state[0] ^= state[3];
+	state[2] ^= t;
+	state[3] = rotl(state[3], 11);
+
+	return result;
+}
+
+void prng_fill(uint32_t *values, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		values[i] = prng_next();
+	}
+}
+
+/**
+ * @brief Rotate left
+ *
+ * @param x Value
+ * @param k Amount of bits (1 to 31)
+ * @return uint32_t Rotated value
+ */
+static inline uint32_t rotl(uint32_t x, uint32_t k) {
+	return (x << k) | (x >> (32 - k));
+}
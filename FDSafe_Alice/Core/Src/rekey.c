@@ -0,0 +1,184 @@
+/**
+ * @file rekey.c
+ * @author Luan
+ * @brief Distribution of new keys over the bus, switched without losing messages
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include <string.h>
+#include "rekey.h"
+#include "fdcan.h"
+#include "uart.h"
+
+
+typedef enum {
+	REKEY_IDLE,
+	REKEY_WAIT_NONCE,		/* Nonce requested from the receiver */
+	REKEY_SENDING			/* Key update sent until acknowledged */
+} RekeyState;
+
+/* Distribution state */
+static struct {
+	RekeyState state;
+	uint8_t epoch;
+	uint8_t attempts;		/* Nonce requests or key updates sent */
+	uint8_t retried;		/* The key update went unacknowledged, a new nonce was requested */
+	uint32_t start;
+	uint32_t next_send;
+	uint32_t last_restart;	/* Last distribution started on an unsolicited nonce */
+	uint32_t cycles;		/* Cycles to draw, precompute and wrap the key */
+} rekey;
+
+/* Last nonce of the receiver, valid until a key update is bound to it */
+static struct {
+	uint8_t valid;
+	uint8_t value[KEY_NONCE_SIZE];
+} nonce;
+
+/* Wrapped key, sent until acknowledged */
+static uint8_t update[KEY_WRAP_SIZE];
+
+
+static void prepare() {
+	uint8_t new_key[KEY_SIZE];
+	uint32_t word;
+
+	uint32_t start_cycles = DWT->CYCCNT;
+	for (uint8_t i = 0; i < KEY_SIZE; i += sizeof(word)) {
+		if (HAL_RNG_GenerateRandomNumber(&hrng, &word) != HAL_OK)
+		{
+			printf("Random number generation error\r\n");
+			Error_Handler();
+		}
+		memcpy(&new_key[i], &word, sizeof(word));
+	}
+
+	/* The epoch follows Alice's active one, whatever the nonce frame says. After an
+	 * unacknowledged update the next epoch is tried, the receiver may hold that one */
+	rekey.epoch = rekey.retried ? rekey.epoch + 1 : crypto_key_epoch() + 1;
+	if (rekey.epoch == crypto_key_epoch()) {
+		rekey.epoch++;
+	}
+	crypto_install_key(rekey.epoch, new_key);
+	crypto_wrap_key(rekey.epoch, nonce.value, new_key, update);
+	memset(new_key, 0, sizeof(new_key));
+	rekey.cycles = DWT->CYCCNT - start_cycles;
+
+	/* A nonce binds a single key */
+	nonce.valid = 0;
+	rekey.state = REKEY_SENDING;
+	rekey.attempts = 0;
+	rekey.next_send = HAL_GetTick();
+}
+
+uint8_t rekey_start() {
+	if (rekey.state != REKEY_IDLE) {
+		return 0;
+	}
+
+	rekey.start = HAL_GetTick();
+	rekey.retried = 0;
+	if (nonce.valid) {
+		prepare();
+	} else {
+		rekey.state = REKEY_WAIT_NONCE;
+		rekey.attempts = 0;
+		rekey.next_send = rekey.start;
+	}
+	return 1;
+}
+
+void rekey_poll() {
+	uint8_t request = 0;
+
+	if (rekey.state == REKEY_IDLE || HAL_GetTick() < rekey.next_send || !fdcan_free_to_send()) {
+		return;
+	}
+
+	if (rekey.attempts == REKEY_MAX_ATTEMPTS) {
+		/* The receiver may have lost the nonce (reset) or hold the epoch: ask for a new nonce, once */
+		if (rekey.state == REKEY_SENDING && !rekey.retried) {
+			rekey.retried = 1;
+			rekey.state = REKEY_WAIT_NONCE;
+			rekey.attempts = 0;
+			return;
+		}
+		if (rekey.state == REKEY_WAIT_NONCE) {
+			printf("No key nonce received, still using epoch %u\r\n", (unsigned int)crypto_key_epoch());
+		} else {
+			printf("Key epoch %u not acknowledged, still using epoch %u\r\n",
+				(unsigned int)rekey.epoch, (unsigned int)crypto_key_epoch());
+		}
+		rekey.state = REKEY_IDLE;
+		return;
+	}
+
+	if (rekey.state == REKEY_WAIT_NONCE) {
+		fdcan_send(ID_KEY_REQUEST, &request, sizeof(request));
+	} else {
+		fdcan_send(ID_KEY_UPDATE, update, sizeof(update));
+	}
+	rekey.attempts++;
+	rekey.next_send = HAL_GetTick() + REKEY_RETRY_INTERVAL;
+}
+
+uint8_t rekey_is_ack(const FDCAN_RxHeaderTypeDef *RxHeader) {
+	return RxHeader->IdType == FDCAN_STANDARD_ID
+		&& RxHeader->Identifier == ID_KEY_ACK;
+}
+
+void rekey_ack(const uint8_t *data) {
+	uint8_t next_nonce[KEY_NONCE_SIZE];
+
+	if (rekey.state != REKEY_SENDING || data[0] != rekey.epoch) {
+		return;
+	}
+
+	if (crypto_check_key_proof(rekey.epoch, &data[KEY_ACK_PROOF_OFFSET], next_nonce) != AUTH_OK) {
+		printf("Invalid key acknowledgement\r\n");
+		return;
+	}
+
+	crypto_activate_key(rekey.epoch);
+	rekey.state = REKEY_IDLE;
+
+	/* The proof carries the nonce of the next update, no request needed */
+	nonce.valid = 1;
+	memcpy(nonce.value, next_nonce, KEY_NONCE_SIZE);
+
+	printf("Key epoch %u active after %u ms (%u updates sent, %u cycles to prepare)\r\n",
+		(unsigned int)rekey.epoch,
+		(unsigned int)(HAL_GetTick() - rekey.start),
+		(unsigned int)rekey.attempts,
+		(unsigned int)rekey.cycles);
+}
+
+uint8_t rekey_is_nonce(const FDCAN_RxHeaderTypeDef *RxHeader) {
+	return RxHeader->IdType == FDCAN_STANDARD_ID
+		&& RxHeader->Identifier == ID_KEY_NONCE;
+}
+
+void rekey_nonce(const uint8_t *data) {
+	uint32_t now = HAL_GetTick();
+
+	/* Answer to a request: the key update is bound to it */
+	if (rekey.state == REKEY_WAIT_NONCE) {
+		nonce.valid = 1;
+		memcpy(nonce.value, &data[KEY_NONCE_OFFSET], KEY_NONCE_SIZE);
+		prepare();
+		return;
+	}
+
+	/* Unsolicited (the receiver restarted, or a forgery): only a reason to request a
+	 * nonce, at a limited rate. A distribution in progress is left to its retries */
+	if (rekey.state == REKEY_IDLE && now - rekey.last_restart >= REKEY_RESTART_INTERVAL) {
+		rekey.last_restart = now;
+		nonce.valid = 0;
+		rekey_start();
+	}
+}
@@ -0,0 +1,140 @@
+/**
+ * @file sim.c
+ * @author Luan
+ * @brief Table-driven signal simulator
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include "sim.h"
+#include "cordic.h"
+#include "prng.h"
+#include "ram.h"
+
+
+/* Signal table (struct of arrays, so the due scan only touches next_updt) */
+static struct {
+	uint32_t count;
+	uint32_t next_updt[SIM_MAX_SIGNALS];
+	uint32_t updt_interval[SIM_MAX_SIGNALS];
+	uint8_t kind[SIM_MAX_SIGNALS];
+	int32_t value[SIM_MAX_SIGNALS];
+	int32_t min_value[SIM_MAX_SIGNALS];
+	int32_t max_value[SIM_MAX_SIGNALS];
+	int32_t variation[SIM_MAX_SIGNALS];
+	uint32_t phase[SIM_MAX_SIGNALS];
+	uint32_t phase_step[SIM_MAX_SIGNALS];
+} table RAM_TABLES;
+
+/* Scratch buffers of a single pass */
+static uint8_t due[SIM_MAX_SIGNALS] RAM_TABLES;
+static uint32_t phases[SIM_MAX_SIGNALS] RAM_TABLES;
+static int32_t sines[SIM_MAX_SIGNALS] RAM_TABLES;
+static uint32_t randoms[SIM_MAX_SIGNALS] RAM_TABLES;
+
+
+void sim_setup() {
+	table.count = 0;
+	prng_setup();
+}
+
+int32_t sim_add(const SimSignal *signal) {
+	if (table.count >= SIM_MAX_SIGNALS) {
+		return -1;
+	}
+
+	uint32_t i = table.count++;
+	table.kind[i] = signal->kind;
+	table.min_value[i] = signal->min_value;
+	table.max_value[i] = signal->max_value;
+	table.variation[i] = signal->variation;
+	table.phase[i] = 0;
+	table.phase_step[i] = signal->phase_step;
+	table.updt_interval[i] = signal->updt_interval;
+	table.next_updt[i] = 0;
+
+	/* Cumulative signals start at a random point of their range */
+	if (signal->kind == SIM_CUMULATIVE) {
+		uint32_t range = (uint32_t)(signal->max_value - signal->min_value) + 1;
+		table.value[i] = signal->min_value + (int32_t)prng_range(prng_next(), range);
+	}
+	else {
+		table.value[i] = signal->min_value;
+	}
+
+	return i;
+}
+
+void sim_truncate(uint32_t count) {
+	if (count < table.count) {
+		table.count = count;
+	}
+}
+
+uint32_t sim_count() {
+	return table.count;
+}
+
+/**
+ * 1. Collect the due signals and the phases of the oscillating ones
+ * 2. Calculate the sines in one CORDIC batch and draw one random number per signal
+ * 3. Oscillating: sine over the range plus jitter in [-variation, +variation], then advance the phase
+ * 4. Cumulative: add a random increment in [0, |variation|] (subtract if variation is negative)
+ * 5. Clamp the value within the range and schedule the next update
+ */
+uint32_t sim_update(uint32_t now) {
+	uint32_t due_count = 0;
+	uint32_t osc_count = 0;
+
+	for (uint32_t i = 0; i < table.count; i++) {
+		if (now >= table.next_updt[i]) {
+			due[due_count++] = i;
+			if (table.kind[i] == SIM_OSCILLATING) {
+				phases[osc_count++] = table.phase[i];
+			}
+		}
+	}
+
+	if (due_count == 0) {
+		return 0;
+	}
+
+	cordic_sin_batch(phases, sines, osc_count);
+	prng_fill(randoms, due_count);
+
+	uint32_t osc = 0;
+	for (uint32_t j = 0; j < due_count; j++) {
+		uint32_t i = due[j];
+		int32_t variation = table.variation[i];
+		int32_t value;
+
+		if (table.kind[i] == SIM_OSCILLATING) {
+			/* (1 + sine) / 2 as a 0.32 fraction of the range */
+			uint32_t half_wave = (uint32_t)sines[osc++] + 0x80000000U;
+			uint32_t range = (uint32_t)(table.max_value[i] - table.min_value[i]);
+			value = table.min_value[i] + (int32_t)(((uint64_t)range * half_wave) >> 32);
+			value += (int32_t)prng_range(randoms[j], 2 * variation + 1) - variation;
+			table.phase[i] += table.phase_step[i];
+		}
+		else {
+			int32_t incdec = (int32_t)prng_range(randoms[j], (variation < 0 ? -variation : variation) + 1);
+			value = table.value[i] + (variation < 0 ? -incdec : incdec);
+		}
+
+		if (value > table.max_value[i]) value = table.max_value[i];
+		if (value < table.min_value[i]) value = table.min_value[i];
+
+		table.value[i] = value;
+		table.next_updt[i] = table.updt_interval[i] + now;
+	}
+
+	return due_count;
+}
+
+int32_t sim_value(uint32_t index) {
+	return table.value[index];
+}
@@ -0,0 +1,82 @@
+/**
+ * @file timesync.c
+ * @author Luan
+ * @brief Bus time synchronisation, master side (sync and follow-up frames)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include "timesync.h"
+#include "fdcan.h"
+
+
+/* Synchronisation state */
+static uint32_t sync_interval = 0;
+static uint32_t next_sync = 0;
+static uint8_t sequence = 0;
+static uint8_t pending = 0;		/* Sync frame sent, follow-up not sent yet */
+
+
+/* Static function prototypes */
+static void build_frame(uint8_t *frame, uint32_t time);
+
+
+void timesync_set_interval(uint32_t interval) {
+	sync_interval = interval;
+	next_sync = HAL_GetTick();
+}
+
+void timesync_poll() {
+	uint8_t frame[TIMESYNC_FRAME_SIZE];
+	uint8_t marker;
+	uint32_t timestamp;
+
+	/* Follow-up with the precise time of the sync frame (older events are dropped) */
+	while (pending && fdcan_free_to_send() && fdcan_tx_event(&marker, &timestamp)) {
+		if (marker == sequence) {
+			build_frame(frame, timestamp);
+			fdcan_send(TIMESYNC_FOLLOW_UP_ID, frame, sizeof(frame));
+			sequence++;
+			pending = 0;
+		}
+	}
+
+	if (sync_interval == 0 || HAL_GetTick() < next_sync || !fdcan_free_to_send()) {
+		return;
+	}
+
+	/* The previous follow-up never came: that sequence is skipped */
+	if (pending) {
+		sequence++;
+	}
+
+	build_frame(frame, timesync_now());
+	fdcan_send_with_event(TIMESYNC_SYNC_ID, frame, sizeof(frame), sequence);
+	pending = 1;
+	next_sync = sync_interval + HAL_GetTick();
+}
+
+uint32_t timesync_now() {
+	return fdcan_timestamp_now();
+}
+
+/**
+ * @brief Fill a sync or follow-up frame
+ *
+ * @param frame Buffer of TIMESYNC_FRAME_SIZE bytes
+ * @param time Master time in timestamp ticks
+ */
+static void build_frame(uint8_t *frame, uint32_t time) {
+	frame[0] = sequence;
+	frame[1] = 0;
+	frame[2] = 0;
+	frame[3] = 0;
+	frame[4] = (uint8_t)(time & 0xFF);
+	frame[5] = (uint8_t)(time >> 8 & 0xFF);
+	frame[6] = (uint8_t)(time >> 16 & 0xFF);
+	frame[7] = (uint8_t)(time >> 24 & 0xFF);
+}
@@ -0,0 +1,95 @@
+/**
+ * @file trace.c
+ * @author Luan
+ * @brief Hot-path trace points with DWT cycle timestamps
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include "trace.h"
+#include "uart.h"
+#include "ram.h"
+
+
+#if TRACE_ENABLED
+
+/* Ring of trace records */
+static TraceRecord trace_ring[TRACE_RING_SIZE] RAM_RINGS;
+static volatile uint32_t trace_head = 0;
+static volatile uint32_t trace_count = 0;
+static volatile uint8_t trace_paused = 0;
+
+/* Dump in progress: records left to print and index of the next one */
+static uint32_t dump_left = 0;
+static uint32_t dump_index = 0;
+
+
+void trace_record(TraceEvent event, uint16_t arg) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	if (!trace_paused) {
+		TraceRecord *record = &trace_ring[trace_head];
+		record->cycles = DWT->CYCCNT;
+		record->event = (uint16_t)event;
+		record->arg = arg;
+
+		trace_head = (trace_head + 1) & (TRACE_RING_SIZE - 1);
+		if (trace_count < TRACE_RING_SIZE) {
+			trace_count++;
+		}
+	}
+
+	__set_PRIMASK(primask);
+}
+
+void trace_dump() {
+	if (trace_paused) {
+		return;
+	}
+	trace_paused = 1;
+
+	dump_left = trace_count;
+	dump_index = (trace_head - dump_left) & (TRACE_RING_SIZE - 1);
+	printf("TRACE BEGIN %u %u\r\n", (unsigned int)dump_left, (unsigned int)SystemCoreClock);
+}
+
+void trace_poll() {
+	if (!trace_paused) {
+		if (trace_count == TRACE_RING_SIZE) {
+			trace_dump();
+		}
+		return;
+	}
+
+	for (uint32_t i = 0; i < TRACE_DUMP_BATCH && dump_left > 0; i++) {
+		TraceRecord *record = &trace_ring[dump_index];
+		printf("T,%u,%u,%u\r\n", (unsigned int)record->cycles, (unsigned int)record->event, (unsigned int)record->arg);
+		dump_index = (dump_index + 1) & (TRACE_RING_SIZE - 1);
+		dump_left--;
+	}
+
+	if (dump_left == 0) {
+		printf("TRACE END\r\n");
+		trace_head = 0;
+		trace_count = 0;
+		trace_paused = 0;
+	}
+}
+
+#else
+
+void trace_record(TraceEvent event, uint16_t arg) {
+}
+
+void trace_dump() {
+}
+
+void trace_poll() {
+}
+
+#endif
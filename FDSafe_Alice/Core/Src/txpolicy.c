@@ -0,0 +1,91 @@
+/**
+ * @file txpolicy.c
+ * @author Luan
+ * @brief Transmission policies (periodic, on change, on change with heartbeat)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include "txpolicy.h"
+#include "main.h"
+#include "uart.h"
+
+
+/* Counters per policy since the last reset */
+static struct {
+	uint32_t sent[TX_POLICIES];
+	uint32_t heartbeats[TX_POLICIES];
+	uint32_t suppressed[TX_POLICIES];
+	uint32_t start;
+} counters;
+
+static const char *policy_names[TX_POLICIES] = {"periodic", "on_change", "on_change_heartbeat"};
+
+
+uint8_t txpolicy_check(const TxPolicyConfig *config, TxPolicyState *state, uint32_t value, uint32_t now) {
+	uint32_t elapsed = now - state->last_time;
+	uint32_t change = value > state->last_value ? value - state->last_value : state->last_value - value;
+	uint8_t send;
+	uint8_t heartbeat = 0;
+
+	if (!state->sent) {
+		send = 1;
+	}
+	else if (config->policy == TX_PERIODIC) {
+		send = elapsed >= config->interval;
+	}
+	else {
+		send = elapsed >= config->interval && change > config->deadband;
+		if (!send && config->policy == TX_ON_CHANGE_HEARTBEAT && elapsed >= config->heartbeat) {
+			send = 1;
+			heartbeat = 1;
+		}
+	}
+
+	/* A frame is suppressed each interval an on change message is not sent (what the periodic policy would have sent) */
+	if (send) {
+		counters.sent[config->policy]++;
+		counters.heartbeats[config->policy] += heartbeat;
+		state->sent = 1;
+		state->last_value = value;
+		state->last_time = now;
+		state->last_check = now;
+	}
+	else if (config->policy != TX_PERIODIC && now - state->last_check >= config->interval) {
+		counters.suppressed[config->policy]++;
+		state->last_check = now;
+	}
+
+	return send;
+}
+
+void txpolicy_print() {
+	uint32_t elapsed = HAL_GetTick() - counters.start;
+	if (elapsed == 0) {
+		elapsed = 1;
+	}
+
+	for (uint32_t i = 0; i < TX_POLICIES; i++) {
+		uint32_t rate = (uint32_t)((uint64_t)counters.sent[i] * 10000 / elapsed);
+		printf("%s: sent %u (%u.%u/s), heartbeats %u, suppressed %u\r\n",
+			policy_names[i],
+			(unsigned int)counters.sent[i],
+			(unsigned int)(rate / 10),
+			(unsigned int)(rate % 10),
+			(unsigned int)counters.heartbeats[i],
+			(unsigned int)counters.suppressed[i]);
+	}
+}
+
+void txpolicy_reset() {
+	for (uint32_t i = 0; i < TX_POLICIES; i++) {
+		counters.sent[i] = 0;
+		counters.heartbeats[i] = 0;
+		counters.suppressed[i] = 0;
+	}
+	counters.start = HAL_GetTick();
+}
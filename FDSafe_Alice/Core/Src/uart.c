@@ -11,8 +11,57 @@
 
 
 #include "uart.h"
+#include <string.h>
+
+
+/* Line reception state */
+static uint8_t rx_byte;
+static char rx_line[UART_LINE_SIZE];
+static volatile uint32_t rx_length = 0;
+static volatile uint8_t rx_line_ready = 0;
 
 PUTCHAR_PROTOTYPE {
     HAL_UART_Transmit(&huart1, (uint8_t*) &ch, 1, 0xFFFF);
 	return ch;
-}
\ No newline at end of file
+}
+
+void uart_setup() {
+	setvbuf(stdout, NULL, _IONBF, 0);
+}
+
+void uart_rx_start() {
+	if (HAL_UART_Receive_IT(&huart1, &rx_byte, 1) != HAL_OK) {
+		Error_Handler();
+	}
+}
+
+void uart_rx_callback(UART_HandleTypeDef *huart) {
+	if (!rx_line_ready) {
+		if (rx_byte == '\r' || rx_byte == '\n') {
+			if (rx_length > 0) {
+				rx_line[rx_length] = '\0';
+				rx_line_ready = 1;
+			}
+		}
+		else if (rx_length < UART_LINE_SIZE - 1) {
+			rx_line[rx_length++] = (char)rx_byte;
+		}
+	}
+
+	HAL_UART_Receive_IT(huart, &rx_byte, 1);
+}
+
+void uart_error_callback(UART_HandleTypeDef *huart) {
+	HAL_UART_Receive_IT(huart, &rx_byte, 1);
+}
+
+uint8_t uart_read_line(char *line) {
+	if (!rx_line_ready) {
+		return 0;
+	}
+
+	memcpy(line, rx_line, rx_length + 1);
+	rx_length = 0;
+	rx_line_ready = 0;
+	return 1;
+}
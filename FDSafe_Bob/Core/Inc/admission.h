@@ -0,0 +1,110 @@
+/**
+ * @file admission.h
+ * @author Luan
+ * @brief Pre-authentication admission: structural checks and verification budgets
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_ADMISSION_H
+#define FDSAFE_ADMISSION_H
+
+
+#include "main.h"
+
+
+/* Admission results */
+#define ADMIT_OK 0
+#define ADMIT_MALFORMED 1
+#define ADMIT_UNEXPECTED_ID 2
+#define ADMIT_OVER_BUDGET 3
+
+/* Expected identifiers, each one owns a bucket */
+#define ADMISSION_MAX_IDS 16
+
+/* Failed verifications allowed in a burst, per identifier and in total */
+#define ADMISSION_ID_BURST 10
+#define ADMISSION_TOTAL_BURST 20
+
+/* Minimum interval between two authentication failure reports */
+#define ADMISSION_REPORT_INTERVAL 1000
+
+
+/**
+ * @brief Set the identifiers expected to carry authenticated messages
+ *
+ * Each one owns a verification budget, whatever else is heard on the bus.
+ *
+ * @param ids Identifiers (kept, not copied, at most ADMISSION_MAX_IDS)
+ * @param count Amount of identifiers
+ */
+void admission_setup(const uint32_t *ids, uint32_t count);
+
+/**
+ * @brief Set the verification budgets
+ *
+ * Only failed verifications spend the budget, so valid traffic alone never
+ * empties it. The forged and genuine frames of an identifier cannot be told
+ * apart before the verification, though: while a flood keeps the bucket of
+ * an identifier empty, its genuine frames are dropped too. The budget
+ * protects the CPU and the other identifiers, not the flooded one.
+ *
+ * @param per_id Failed verifications per second allowed per identifier
+ * @param total Failed verifications per second allowed in total
+ */
+void admission_set_rates(uint32_t per_id, uint32_t total);
+
+/**
+ * @brief Structural checks of an authenticated frame, before anything else
+ *
+ * The frame must be an expected identifier and carry at least one byte besides its authentication overhead.
+ *
+ * @param id Identifier
+ * @param frame_size Payload size given by the DLC
+ * @param overhead Bytes besides the data: tag and IV, or sequence and tag fragment
+ * @return uint8_t ADMIT_OK, ADMIT_MALFORMED or ADMIT_UNEXPECTED_ID
+ */
+uint8_t admission_check(uint32_t id, size_t frame_size, size_t overhead);
+
+/**
+ * @brief Check the verification budget of an identifier, right before the decryption
+ *
+ * Applies to every frame of the identifier, genuine or not.
+ *
+ * @param id Identifier
+ * @return uint8_t ADMIT_OK, ADMIT_OVER_BUDGET or ADMIT_UNEXPECTED_ID
+ */
+uint8_t admission_budget(uint32_t id);
+
+/**
+ * @brief Account the outcome of a verification (a failure spends the budget)
+ *
+ * @param id Identifier
+ * @param auth AUTH_OK if the tag was valid
+ */
+void admission_result(uint32_t id, uint8_t auth);
+
+/**
+ * @brief Report the authentication failures, at most once per ADMISSION_REPORT_INTERVAL
+ *
+ */
+void admission_poll();
+
+/**
+ * @brief Print the dropped frames per reason
+ *
+ */
+void admission_print();
+
+/**
+ * @brief Clear the drop counters
+ *
+ */
+void admission_reset();
+
+
+#endif
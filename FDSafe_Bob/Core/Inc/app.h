@@ -16,11 +16,28 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include "stm32g4xx_hal.h"
 #include "uart.h"
 #include "fdcan.h"
 #include "cmox_crypto.h"
 #include "crypto.h"
+#include "trace.h"
+#include "histogram.h"
+#include "idstats.h"
+#include "diag.h"
+#include "command.h"
+#include "container.h"
+#include "isotp.h"
+#include "replay.h"
+#include "admission.h"
+#include "rekey.h"
+#include "clock.h"
+#include "timesync.h"
+
+
+#define MILLISECONDS *1
+#define SECONDS MILLISECONDS*1000
 
 
 /**
@@ -0,0 +1,36 @@
+/**
+ * @file ccmram.h
+ * @author Luan
+ * @brief Placement of hot code and data in CCM SRAM
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_CCMRAM_H
+#define FDSAFE_CCMRAM_H
+
+
+/* Hot code and data in CCM SRAM (0: code in flash and data in SRAM, for comparison) */
+#define CCMRAM_PLACEMENT 1
+
+
+/*
+ * CCM SRAM (10 KB at 0x10000000) is on the instruction and data buses of the
+ * core without flash wait states. Code is copied from flash at boot, data is
+ * zeroed at boot (no initial values). Calls between flash and CCM SRAM go
+ * through linker veneers (the regions are too far apart for a direct branch).
+ */
+#if CCMRAM_PLACEMENT
+#define CCMRAM_CODE __attribute__((section(".ccmram_text")))
+#define CCMRAM_DATA __attribute__((section(".ccmram_bss")))
+#else
+#define CCMRAM_CODE
+#define CCMRAM_DATA
+#endif
+
+
+#endif
@@ -0,0 +1,78 @@
+/**
+ * @file container.h
+ * @author Luan
+ * @brief Container PDU carrying several signals under a single authentication tag
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_CONTAINER_H
+#define FDSAFE_CONTAINER_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* Container plaintext size (64-byte message with the tag and IV) */
+#define CONTAINER_SIZE 36
+
+/* Container header: amount of entries (1) */
+#define CONTAINER_HEADER_SIZE 1
+
+/* Entry header: message ID (2, big-endian), offset (1) and length (1) in the original message */
+#define CONTAINER_ENTRY_HEADER_SIZE 4
+
+/* Largest original message an entry can be placed in */
+#define CONTAINER_MAX_MESSAGE_SIZE 64
+
+
+/* Container being built */
+typedef struct {
+	uint8_t data[CONTAINER_SIZE];
+	size_t size;
+	uint8_t count;
+} Container;
+
+/* Signal entry (bytes of a message placed at their original position) */
+typedef struct {
+	uint16_t id;
+	uint8_t offset;
+	uint8_t length;
+	const uint8_t *data;
+} ContainerEntry;
+
+
+/**
+ * @brief Clear a container (unused bytes are 0xFF)
+ *
+ * @param container Container
+ */
+void container_init(Container *container);
+
+/**
+ * @brief Append an entry to a container
+ *
+ * @param container Container
+ * @param entry Entry to be appended
+ * @return uint8_t 1 if appended, 0 if it does not fit
+ */
+uint8_t container_add(Container *container, const ContainerEntry *entry);
+
+/**
+ * @brief Parse the entry at a given position of a received container
+ *
+ * @param pdu Container payload
+ * @param size Container payload size
+ * @param pos Position of the entry (CONTAINER_HEADER_SIZE for the first one)
+ * @param entry Parsed entry (data points into the payload)
+ * @return size_t Position of the next entry, 0 if the entry is malformed
+ */
+size_t container_next(const uint8_t *pdu, size_t size, size_t pos, ContainerEntry *entry);
+
+
+#endif
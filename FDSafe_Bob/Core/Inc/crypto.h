@@ -20,9 +20,51 @@
 #define AUTH_TAG_SIZE 16
 #define IV_SIZE 12
 
+/* Initialization vector: key epoch, session (random per boot of the sender) and message sequence (big-endian) */
+#define IV_EPOCH_SIZE 1
+#define IV_SESSION_SIZE 3
+#define IV_SEQUENCE_SIZE 8
+
+/* Key slots: the active key and the one being distributed */
+#define KEY_SIZE 32
+#define KEY_SLOTS 2
+
+/* Key wrap (RFC 3394): wrapped key is epoch + padding (8), receiver nonce (8) and key,
+ * proof of possession is the receiver's next nonce and a zero block (8) wrapped with the new key */
+#define KEY_NONCE_SIZE 8
+#define KEY_WRAP_OVERHEAD 8
+#define KEY_WRAP_NONCE_OFFSET 8
+#define KEY_WRAP_HEADER_SIZE (KEY_WRAP_NONCE_OFFSET + KEY_NONCE_SIZE)
+#define KEY_WRAP_SIZE (KEY_WRAP_HEADER_SIZE + KEY_SIZE + KEY_WRAP_OVERHEAD)
+#define KEY_PROOF_SIZE (KEY_NONCE_SIZE + 8 + KEY_WRAP_OVERHEAD)
+
+/* Header additional data: identifier (4, big-endian), frame size (1) and padding, one GHASH block */
+#define HEADER_AAD_SIZE 16
+#define HEADER_CACHE_SIZE 16
+
+/* Windowed MAC: full tag every window, running tag fragment on every frame */
+#define MAC_TAG_SIZE 16
+#define MAC_FRAGMENT_SIZE 4
+
 #define AUTH_OK 0
 #define AUTH_ERROR 1
 
+/* Implementations of the crypto library (same output, different speed and size) */
+typedef enum {
+  CRYPTO_ENGINE_FAST = 0,     /* Fast AES, fast GHASH */
+  CRYPTO_ENGINE_SMALL,        /* Small AES, small GHASH */
+  CRYPTO_ENGINE_BALANCED,     /* Fast AES, small GHASH */
+  CRYPTO_ENGINES
+} CryptoEngine;
+
+/* Header authentication (the IV is always authenticated, it is the GCM nonce) */
+typedef enum {
+  HEADER_AAD_OFF = 0,
+  HEADER_AAD_CACHED,          /* Absorbed once per identifier, the GHASH state is restored per frame */
+  HEADER_AAD_APPEND,          /* Absorbed on every frame (reference for the cycle counts) */
+  HEADER_AAD_MODES
+} HeaderAad;
+
 
 /**
  * @brief Setup the crypto library interface
@@ -30,14 +72,148 @@
  */
 void crypto_setup();
 
+/**
+ * @brief Select the implementation used by the next decryptions
+ * 
+ * @param engine Crypto engine
+ */
+void crypto_set_engine(CryptoEngine engine);
+
+/**
+ * @brief Select how the frame header is bound to the tag
+ * 
+ * The identifier and the frame size are authenticated as additional data, so
+ * a valid frame cannot be moved to another identifier or resized. Both sides
+ * must agree on whether it is off, the cached and appended modes give the
+ * same tags.
+ * 
+ * @param mode Header authentication mode
+ */
+void crypto_set_header_aad(HeaderAad mode);
+
+/**
+ * @brief Unwrap a key distributed by the sender and check its integrity
+ * 
+ * @param wrapped Wrapped key (KEY_WRAP_SIZE bytes)
+ * @param epoch Variable to store the epoch of the key
+ * @param nonce Buffer to store the receiver nonce the key is bound to (KEY_NONCE_SIZE bytes)
+ * @param new_key Buffer to store the key (KEY_SIZE bytes)
+ * @return uint8_t AUTH_OK if the key was wrapped with the key-encryption key
+ */
+uint8_t crypto_unwrap_key(const uint8_t *wrapped, uint8_t *epoch, uint8_t *nonce, uint8_t *new_key);
+
+/**
+ * @brief Store a new key in the spare slot of a sender
+ * 
+ * Messages under the active key keep being verified with it. The first
+ * authenticated message under the new key makes it the active one.
+ * 
+ * @param id Identifier of the sender
+ * @param epoch Epoch of the new key
+ * @param new_key Key (KEY_SIZE bytes)
+ */
+void crypto_install_key(uint32_t id, uint8_t epoch, const uint8_t *new_key);
+
+/**
+ * @brief Prove the possession of an installed key (the next nonce and a zero block wrapped with it)
+ * 
+ * @param id Identifier of the sender of the key
+ * @param epoch Epoch of the key
+ * @param next_nonce Nonce the next key update must carry (KEY_NONCE_SIZE bytes)
+ * @param proof Buffer to store the proof (KEY_PROOF_SIZE bytes)
+ */
+void crypto_key_proof(uint32_t id, uint8_t epoch, const uint8_t *next_nonce, uint8_t *proof);
+
 /**
  * @brief Decrypt a message
  * 
+ * The key is looked up by identifier and epoch in the key table. The first
+ * authenticated message under a new key of a sender makes it the active one.
+ * Failures are not printed here: they are reported by the caller, rate-limited.
+ * 
+ * @param id Identifier of the message
  * @param ciphertext Ciphertext to be decrypted
  * @param plaintext Buffer to store the plaintext
  * @param exp_plain_size Expected size of the plaintext
  */
-uint8_t decrypt(uint8_t *ciphertext, uint8_t *plaintext, size_t exp_plain_size);
+uint8_t decrypt(uint32_t id, uint8_t *ciphertext, uint8_t *plaintext, size_t exp_plain_size);
+
+/**
+ * @brief Verify a message and decrypt only a field of it
+ * 
+ * GCM is counter mode: the tag is verified over the ciphertext alone, which
+ * is absorbed as additional data and the tag corrected for the different
+ * length block, then only the keystream blocks covering the field are
+ * generated. The other bytes of the plaintext buffer are left untouched.
+ * 
+ * @param id Identifier of the message
+ * @param ciphertext Ciphertext, tag and IV
+ * @param plaintext Buffer to store the field (at its position in the message)
+ * @param exp_plain_size Expected size of the plaintext
+ * @param first Position of the first byte of the field
+ * @param size Size of the field
+ * @return uint8_t AUTH_OK if the message is authentic
+ */
+uint8_t decrypt_field(uint32_t id, const uint8_t *ciphertext, uint8_t *plaintext, size_t exp_plain_size, size_t first, size_t size);
+
+/**
+ * @brief Start a MAC window under the key derived from a key slot of a sender
+ * 
+ * @param id Identifier of the sender
+ * @param epoch Epoch of the key
+ * @return uint8_t AUTH_OK, AUTH_ERROR if the key is unknown (no window is open)
+ */
+uint8_t mac_window_start(uint32_t id, uint8_t epoch);
+
+/**
+ * @brief Append a frame to the MAC window and check its running tag fragment
+ * 
+ * @param data Authenticated data of the frame
+ * @param size Size of the data
+ * @param fragment Received fragment (MAC_FRAGMENT_SIZE bytes)
+ * @return uint8_t AUTH_OK if the fragment matches the window so far
+ */
+uint8_t mac_window_append(const uint8_t *data, size_t size, const uint8_t *fragment);
+
+/**
+ * @brief Close the MAC window and verify its tag
+ * 
+ * @param tag Received tag (MAC_TAG_SIZE bytes)
+ * @return uint8_t AUTH_OK if the tag covers every appended frame
+ */
+uint8_t mac_window_finish(const uint8_t *tag);
+
+/**
+ * @brief Start decrypting a message appended in parts
+ * 
+ * The identifier and the message length are authenticated as additional
+ * data, unless the header authentication is off.
+ * 
+ * @param id Identifier of the message
+ * @param length Plaintext length of the message
+ * @param iv Initialization vector of the message (IV_SIZE bytes)
+ */
+void stream_decrypt_start(uint32_t id, uint32_t length, const uint8_t *iv);
+
+/**
+ * @brief Decrypt the next part of the message
+ * 
+ * Every part but the last one must be a multiple of 16 bytes. The plaintext
+ * is not authenticated until stream_decrypt_finish() succeeds.
+ * 
+ * @param ciphertext Ciphertext of the part
+ * @param size Size of the part
+ * @param plaintext Buffer to store the plaintext (size bytes)
+ */
+void stream_decrypt_append(const uint8_t *ciphertext, size_t size, uint8_t *plaintext);
+
+/**
+ * @brief Finish the message and verify its tag
+ * 
+ * @param tag Received tag (AUTH_TAG_SIZE bytes)
+ * @return uint8_t AUTH_OK if the tag covers every appended part
+ */
+uint8_t stream_decrypt_finish(const uint8_t *tag);
 
 
 #endif
\ No newline at end of file
@@ -17,6 +17,11 @@
 #include "main.h"
 
 
+/* Timestamp counter unit: 16 nominal bit times (wraps every 2^20 bit times) */
+#define FDCAN_TIMESTAMP_PRESCALER FDCAN_TIMESTAMP_PRESC_16
+#define FDCAN_TIMESTAMP_BITS_PER_TICK 16
+
+
 /**
  * @brief Start FDCAN and enable the FDCAN transceiver
  * 
@@ -43,6 +48,38 @@ void fdcan_activate_rx_notification();
  */
 void fdcan_rx_callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs);
 
+/**
+ * @brief FDCAN timestamp counter wrap-around callback
+ * 
+ * @param hfdcan FDCAN handler
+ */
+void fdcan_timestamp_wrap_callback(FDCAN_HandleTypeDef *hfdcan);
+
+/**
+ * @brief Extend a 16-bit hardware timestamp with the wrap-around count
+ * 
+ * The frame must be read less than one wrap-around period after reception.
+ * 
+ * @param timestamp Timestamp of a received message (RxTimestamp)
+ * @return uint32_t Extended timestamp in ticks
+ */
+uint32_t fdcan_timestamp_extend(uint32_t timestamp);
+
+/**
+ * @brief Get the current value of the timestamp counter, extended
+ * 
+ * @return uint32_t Extended timestamp in ticks
+ */
+uint32_t fdcan_timestamp_now();
+
+/**
+ * @brief Convert timestamp ticks to microseconds
+ * 
+ * @param ticks Amount of ticks
+ * @return uint32_t Time in microseconds
+ */
+uint32_t fdcan_timestamp_to_usec(uint32_t ticks);
+
 /**
  * @brief Check if there is any messages available on FIFO0
  * 
@@ -50,6 +87,13 @@ void fdcan_rx_callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs);
  */
 uint32_t fdcan_available();
 
+/**
+ * @brief Get the highest RX FIFO0 fill level seen by fdcan_available()
+ * 
+ * @return uint32_t RX FIFO high-water mark
+ */
+uint32_t fdcan_rx_high_water();
+
 /**
  * @brief Read a message from FIFO0
  * 
@@ -58,4 +102,29 @@ uint32_t fdcan_available();
  */
 void fdcan_read(FDCAN_RxHeaderTypeDef *RxHeader, uint8_t *RxData);
 
+/**
+ * @brief Build and send the message
+ * 
+ * @param id Identifier of the message
+ * @param data Payload
+ * @param size Size of the payload
+ */
+void fdcan_send(uint32_t id, uint8_t *data, size_t size);
+
+/**
+ * @brief Check it is possible to send a new message
+ * 
+ * @return uint32_t Amount of free TX FIFO elements
+ */
+uint32_t fdcan_free_to_send();
+
+/**
+ * @brief Get the smallest valid CAN FD payload size able to hold a payload
+ * 
+ * @param size Size of the payload
+ * @return size_t Valid payload size (64 at most)
+ */
+size_t fdcan_frame_size(size_t size);
+
+
 #endif
\ No newline at end of file
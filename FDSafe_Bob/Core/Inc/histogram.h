@@ -0,0 +1,79 @@
+/**
+ * @file histogram.h
+ * @author Luan
+ * @brief Log-bucketed (HDR-style) histograms for cycle measurements
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_HISTOGRAM_H
+#define FDSAFE_HISTOGRAM_H
+
+
+#include <stdint.h>
+
+
+/* Sub-buckets per power of two (2^3 = 8, ~12.5% resolution) */
+#define HIST_SUB_BITS 3
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+
+/* Values from 2^24 on are counted in the last bucket (max stays exact) */
+#define HIST_MAX_BITS 24
+#define HIST_BUCKETS ((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB_COUNT)
+
+
+/* Histogram struct */
+typedef struct {
+	const char *name;
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint32_t buckets[HIST_BUCKETS];
+} Histogram;
+
+
+/**
+ * @brief Initialize an empty histogram
+ *
+ * @param hist Histogram
+ * @param name Name used in the summary
+ */
+void hist_init(Histogram *hist, const char *name);
+
+/**
+ * @brief Clear all the recorded values
+ *
+ * @param hist Histogram
+ */
+void hist_reset(Histogram *hist);
+
+/**
+ * @brief Record a value in O(1)
+ *
+ * @param hist Histogram
+ * @param value Value to be recorded
+ */
+void hist_record(Histogram *hist, uint32_t value);
+
+/**
+ * @brief Get the value at a given percentile
+ *
+ * @param hist Histogram
+ * @param permille Percentile in thousandths (e.g. 990 for p99)
+ * @return uint32_t Highest value equivalent to the percentile bucket
+ */
+uint32_t hist_percentile(const Histogram *hist, uint32_t permille);
+
+/**
+ * @brief Print the summary (count, min, p50, p99, max) through UART
+ *
+ * @param hist Histogram
+ */
+void hist_print(const Histogram *hist);
+
+
+#endif
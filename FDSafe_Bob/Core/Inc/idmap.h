@@ -0,0 +1,76 @@
+/**
+ * @file idmap.h
+ * @author Luan
+ * @brief Direct-indexed map from 11-bit identifiers to table slots
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_IDMAP_H
+#define FDSAFE_IDMAP_H
+
+
+#include "main.h"
+
+
+/* Amount of standard (11-bit) identifiers */
+#define IDMAP_ID_COUNT 2048
+
+/* Amount of identifiers that can own a slot */
+#define IDMAP_MAX_SLOTS 32
+
+/* Returned when the identifier has no slot */
+#define IDMAP_NO_SLOT 0xFF
+
+
+/**
+ * @brief Get the slot of an identifier in O(1)
+ *
+ * @param id Identifier
+ * @return uint8_t Slot index or IDMAP_NO_SLOT if the identifier is unknown
+ */
+uint8_t idmap_lookup(uint32_t id);
+
+/**
+ * @brief Get the slot of an identifier, assigning a new one on first sight
+ *
+ * Slots are assigned in order of arrival and never released, so the
+ * identifiers that must always have one are reserved first.
+ *
+ * @param id Identifier
+ * @return uint8_t Slot index or IDMAP_NO_SLOT if every slot is taken
+ */
+uint8_t idmap_assign(uint32_t id);
+
+/**
+ * @brief Assign slots to configured identifiers, before any frame is heard
+ *
+ * The slots stay theirs whatever else appears on the bus; only the slots
+ * left over go to other identifiers in order of arrival.
+ *
+ * @param ids Identifiers
+ * @param count Amount of identifiers (the map must have room for all of them)
+ */
+void idmap_reserve(const uint32_t *ids, uint32_t count);
+
+/**
+ * @brief Get the amount of assigned slots
+ *
+ * @return uint8_t Amount of slots in use
+ */
+uint8_t idmap_count();
+
+/**
+ * @brief Get the identifier that owns a slot
+ *
+ * @param slot Slot index
+ * @return uint32_t Identifier
+ */
+uint32_t idmap_id(uint8_t slot);
+
+
+#endif
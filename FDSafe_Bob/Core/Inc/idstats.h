@@ -0,0 +1,72 @@
+/**
+ * @file idstats.h
+ * @author Luan
+ * @brief Per-identifier bus statistics
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_IDSTATS_H
+#define FDSAFE_IDSTATS_H
+
+
+#include "main.h"
+#include "idmap.h"
+
+
+/* EWMA weight of a new sample (1/2^4 = 1/16) */
+#define IDSTATS_EWMA_SHIFT 4
+
+
+/* Statistics of one identifier (periods in timestamp ticks) */
+typedef struct {
+	uint32_t count;
+	uint32_t auth_ok;
+	uint32_t auth_fail;
+	uint32_t dlc_mismatch;
+	uint32_t last_timestamp;
+	uint32_t min_period;
+	uint32_t max_period;
+	uint32_t ewma_period;   /* Scaled by 2^IDSTATS_EWMA_SHIFT */
+	uint32_t ewma_jitter;   /* Mean absolute deviation, scaled by 2^IDSTATS_EWMA_SHIFT */
+	uint32_t dlc;           /* Reference DLC (first one seen) */
+} IdStats;
+
+
+/**
+ * @brief Account a received frame
+ *
+ * Identifiers beyond the table capacity are only counted as overflow.
+ *
+ * @param RxHeader Header of the received message
+ */
+void idstats_update(const FDCAN_RxHeaderTypeDef *RxHeader);
+
+/**
+ * @brief Account the authentication result of a received frame
+ *
+ * @param id Identifier
+ * @param auth_ok 1 if authentication succeeded, 0 otherwise
+ */
+void idstats_auth(uint32_t id, uint8_t auth_ok);
+
+/**
+ * @brief Get the statistics of an identifier
+ *
+ * @param id Identifier
+ * @return const IdStats* Statistics or NULL if the identifier was never seen
+ */
+const IdStats *idstats_get(uint32_t id);
+
+/**
+ * @brief Print the table through UART (periods in microseconds)
+ *
+ */
+void idstats_print();
+
+
+#endif
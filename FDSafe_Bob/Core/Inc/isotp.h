@@ -0,0 +1,108 @@
+/**
+ * @file isotp.h
+ * @author Luan
+ * @brief Segmented reception (ISO-TP-like) of messages decrypted on the fly
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_ISOTP_H
+#define FDSAFE_ISOTP_H
+
+
+#include "main.h"
+#include "crypto.h"
+
+
+/* Reserved identifiers (segments from Alice / flow control from Bob) */
+#define ISOTP_DATA_ID 0x600
+#define ISOTP_FC_ID 0x601
+
+/* Protocol control information (high nibble of the first byte) */
+#define ISOTP_PCI_FIRST 0x10
+#define ISOTP_PCI_CONSECUTIVE 0x20
+#define ISOTP_PCI_FLOW_CONTROL 0x30
+
+/* Flow status (low nibble of a flow control frame) */
+#define ISOTP_FLOW_CTS 0
+#define ISOTP_FLOW_WAIT 1
+#define ISOTP_FLOW_OVERFLOW 2
+
+/* Frame layout: first frame PCI + length (4) + IV, consecutive frame PCI */
+#define ISOTP_FRAME_SIZE 64
+#define ISOTP_FF_HEADER_SIZE (1 + 4 + IV_SIZE)
+#define ISOTP_CF_HEADER_SIZE 1
+
+/* Largest plaintext accepted */
+#define ISOTP_MAX_MESSAGE_SIZE 8192
+
+/* Time without a consecutive frame before the reception is aborted */
+#define ISOTP_TIMEOUT 1000
+
+/* Consecutive frames granted per flow control and separation time asked for (ms) */
+#define ISOTP_BLOCK_SIZE 8
+#define ISOTP_ST_MIN 0
+
+
+/**
+ * @brief Application handler that takes a slice of the plaintext
+ *
+ * The slices are not authenticated yet: nothing must be acted upon before
+ * the done handler reports AUTH_OK.
+ *
+ * @param offset Position of the slice in the message
+ * @param data Plaintext slice
+ * @param size Size of the slice
+ */
+typedef void (*IsotpSink)(uint32_t offset, const uint8_t *data, size_t size);
+
+/**
+ * @brief Application handler called when a reception ends
+ *
+ * @param length Plaintext size announced by the sender
+ * @param received Plaintext bytes received
+ * @param auth AUTH_OK if the whole message was received and its tag is valid
+ */
+typedef void (*IsotpDone)(uint32_t length, uint32_t received, uint8_t auth);
+
+
+/**
+ * @brief Setup the application handlers
+ *
+ * @param sink Plaintext handler
+ * @param done End of reception handler
+ */
+void isotp_setup(IsotpSink sink, IsotpDone done);
+
+/**
+ * @brief Check if a received message is a segment for this node
+ *
+ * @param RxHeader Header of the received message
+ * @return uint8_t 1 if it is a segment, 0 otherwise
+ */
+uint8_t isotp_is_frame(const FDCAN_RxHeaderTypeDef *RxHeader);
+
+/**
+ * @brief Process a segment
+ *
+ * The ciphertext is decrypted block by block as it arrives and passed to the
+ * sink, so the message is never held whole. Flow control frames are sent
+ * after the first frame and after every ISOTP_BLOCK_SIZE consecutive frames.
+ *
+ * @param RxHeader Header of the received message
+ * @param data Payload of the received message
+ */
+void isotp_process(const FDCAN_RxHeaderTypeDef *RxHeader, const uint8_t *data);
+
+/**
+ * @brief Abort the reception if the sender went silent
+ *
+ */
+void isotp_poll();
+
+
+#endif
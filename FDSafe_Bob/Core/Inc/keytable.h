@@ -0,0 +1,150 @@
+/**
+ * @file keytable.h
+ * @author Luan
+ * @brief Key table: keys per sender and identifier range, expanded contexts cached in an LRU
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_KEYTABLE_H
+#define FDSAFE_KEYTABLE_H
+
+
+#include "main.h"
+#include "crypto.h"
+#include "cmox_crypto.h"
+
+
+/* Standard identifiers (direct-indexed map) */
+#define KEYTABLE_ID_COUNT 2048
+
+/* Senders with their own keys (71 bytes each in SRAM), and cache memory for the expanded
+ * contexts in fast contexts (2356 bytes each in CCM SRAM, the small ones take 564 bytes,
+ * so 8 of them fit): beyond the contexts kept at once, a sender switch costs a key expansion */
+#define KEYTABLE_SENDERS 16
+#define KEYTABLE_CACHE_SIZE 2
+
+/* Sender index of an identifier without a key */
+#define KEYTABLE_NO_SENDER 0xFF
+
+/* Benchmark: synthetic senders own 8 identifiers each from 0x400, verifications per run, frame plaintext size */
+#define KEYTABLE_BENCH_FIRST_ID 0x400
+#define KEYTABLE_BENCH_IDS 8
+#define KEYTABLE_BENCH_ROUNDS 512
+#define KEYTABLE_BENCH_DATA_SIZE 20
+
+
+/* GCM handle of any engine (the handles hold no pointers to themselves, so they can be copied) */
+typedef union {
+	cmox_cipher_handle_t super;
+	cmox_gcmFast_handle_t fast;
+	cmox_gcmSmall_handle_t small;
+} GcmHandle;
+
+
+/**
+ * @brief Remove every sender and identifier mapping
+ *
+ */
+void keytable_setup();
+
+/**
+ * @brief Add a sender with its initial key (epoch 0)
+ *
+ * @param key Key (KEY_SIZE bytes)
+ * @return uint8_t Sender index, KEYTABLE_NO_SENDER if the table is full
+ */
+uint8_t keytable_add_sender(const uint8_t *key);
+
+/**
+ * @brief Assign a range of identifiers to a sender (replaces previous assignments)
+ *
+ * @param sender Sender index
+ * @param first_id First identifier of the range
+ * @param last_id Last identifier of the range (included)
+ */
+void keytable_map(uint8_t sender, uint32_t first_id, uint32_t last_id);
+
+/**
+ * @brief Select the engine of the expanded contexts (empties the cache)
+ *
+ * The cache memory holds KEYTABLE_CACHE_SIZE contexts of the fast engine, or
+ * as many of the small ones (key schedule and 4-bit GHASH table) as fit.
+ *
+ * @param engine Crypto engine
+ */
+void keytable_set_engine(CryptoEngine engine);
+
+/**
+ * @brief Get a keyed context for a message, ready to take its IV
+ *
+ * The sender is found through the identifier map and the key through the
+ * epoch, both in constant time. The context is copied from the cache; on a
+ * miss the key is expanded first, replacing the least recently used context.
+ *
+ * @param id Identifier of the message
+ * @param epoch Key epoch of the message
+ * @param copy Handle to store the context
+ * @return cmox_cipher_handle_t* Cipher handle of the copy, NULL if the key is unknown
+ */
+cmox_cipher_handle_t *keytable_context(uint32_t id, uint8_t epoch, GcmHandle *copy);
+
+/**
+ * @brief Store a new key in the spare slot of the sender of an identifier and expand it
+ *
+ * @param id Identifier of the sender
+ * @param epoch Epoch of the new key
+ * @param key Key (KEY_SIZE bytes)
+ */
+void keytable_install(uint32_t id, uint8_t epoch, const uint8_t *key);
+
+/**
+ * @brief Make a key the active one of its sender, the previous key is retired
+ *
+ * @param id Identifier of the sender
+ * @param epoch Epoch of the key (no effect if already active or unknown)
+ */
+void keytable_promote(uint32_t id, uint8_t epoch);
+
+/**
+ * @brief Get the epoch of the active key of the sender of an identifier
+ *
+ * @param id Identifier of the sender
+ * @return uint8_t Epoch
+ */
+uint8_t keytable_epoch(uint32_t id);
+
+/**
+ * @brief Get a raw key
+ *
+ * @param id Identifier of the sender
+ * @param epoch Epoch of the key
+ * @return const uint8_t* Key (KEY_SIZE bytes), NULL if unknown
+ */
+const uint8_t *keytable_key(uint32_t id, uint8_t epoch);
+
+/**
+ * @brief Print the amount of senders and the context cache hits and misses
+ *
+ */
+void keytable_print();
+
+/**
+ * @brief Print the cycles per verification as the senders and identifiers in use grow
+ *
+ * Synthetic senders are added up to KEYTABLE_SENDERS, each owning
+ * KEYTABLE_BENCH_IDS identifiers from KEYTABLE_BENCH_FIRST_ID. Every run
+ * verifies forged frames round-robin over the identifiers of the first n
+ * senders (a failed verification costs as much as a valid one). The
+ * synthetic senders are removed afterwards and the identifiers given back
+ * to their previous senders.
+ *
+ */
+void keytable_benchmark();
+
+
+#endif
@@ -67,6 +67,7 @@ void Error_Handler(void);
 /* USER CODE BEGIN Private defines */
 
 extern FDCAN_HandleTypeDef hfdcan1;
+extern RNG_HandleTypeDef hrng;
 extern UART_HandleTypeDef huart1;
 
 /* USER CODE END Private defines */
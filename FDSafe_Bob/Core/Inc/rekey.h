@@ -0,0 +1,89 @@
+/**
+ * @file rekey.h
+ * @author Luan
+ * @brief Reception of new keys distributed over the bus
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_REKEY_H
+#define FDSAFE_REKEY_H
+
+
+#include "main.h"
+#include "crypto.h"
+
+
+/* Reserved identifiers (wrapped key from Alice / acknowledgement from Bob / nonce from Bob / nonce request from Alice) */
+#define ID_KEY_UPDATE 0x050
+#define ID_KEY_ACK 0x051
+#define ID_KEY_NONCE 0x052
+#define ID_KEY_REQUEST 0x053
+
+/* Acknowledgement: epoch, padding (7) and proof of possession of the new key */
+#define KEY_ACK_PROOF_OFFSET 8
+#define KEY_ACK_SIZE (KEY_ACK_PROOF_OFFSET + KEY_PROOF_SIZE)
+
+/* Nonce: active epoch of the receiver, padding (7) and the nonce the next key update must carry */
+#define KEY_NONCE_OFFSET 8
+#define KEY_NONCE_FRAME_SIZE (KEY_NONCE_OFFSET + KEY_NONCE_SIZE)
+
+/* Interval between two nonce announcements after a reset */
+#define REKEY_ANNOUNCE_INTERVAL 1000
+
+
+/**
+ * @brief Draw the first nonce and announce it, the sender then distributes a new key
+ *
+ * The keys are not persisted: after a reset the receiver is back to epoch 0
+ * and the sender may be on a later one.
+ */
+void rekey_setup();
+
+/**
+ * @brief Check if a received message is a key update
+ *
+ * @param RxHeader Header of the received message
+ * @return uint8_t 1 if it is a key update, 0 otherwise
+ */
+uint8_t rekey_is_update(const FDCAN_RxHeaderTypeDef *RxHeader);
+
+/**
+ * @brief Install a new key in the spare slot and acknowledge it
+ *
+ * Only an update bound to the current nonce and for an epoch other than the
+ * active one is installed, then a new nonce is drawn and sent in the
+ * acknowledgement. A repeated update (acknowledgement lost) is acknowledged
+ * again without being installed.
+ *
+ * @param data Payload of the received message
+ * @param size Size of the payload
+ */
+void rekey_update(const uint8_t *data, size_t size);
+
+/**
+ * @brief Check if a received message is a nonce request
+ *
+ * @param RxHeader Header of the received message
+ * @return uint8_t 1 if it is a nonce request, 0 otherwise
+ */
+uint8_t rekey_is_request(const FDCAN_RxHeaderTypeDef *RxHeader);
+
+/**
+ * @brief Answer a nonce request with the active epoch and the current nonce
+ *
+ */
+void rekey_request();
+
+/**
+ * @brief Report the switchover once the first message under the new key is authenticated, announce the nonce after a reset
+ *
+ */
+void rekey_poll();
+
+
+#endif
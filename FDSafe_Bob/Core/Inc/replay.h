@@ -0,0 +1,88 @@
+/**
+ * @file replay.h
+ * @author Luan
+ * @brief Replay protection: per-identifier sliding window over the IV sequence
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_REPLAY_H
+#define FDSAFE_REPLAY_H
+
+
+#include "main.h"
+
+
+/* Sequences accepted behind the highest one seen (bits of the window) */
+#define REPLAY_WINDOW_SIZE 64
+
+/* Protected identifiers, each one owns a window */
+#define REPLAY_MAX_IDS 16
+
+/* Check results */
+#define REPLAY_FRESH 0
+#define REPLAY_DUPLICATE 1
+#define REPLAY_STALE 2
+#define REPLAY_UNTRACKED 3
+
+
+/**
+ * @brief Set the identifiers protected against replays, each one with its own window
+ *
+ * The windows are reserved for these identifiers, whatever else is heard on
+ * the bus. They start empty.
+ *
+ * @param ids Identifiers (kept, not copied, at most REPLAY_MAX_IDS)
+ * @param count Amount of identifiers
+ */
+void replay_setup(const uint32_t *ids, uint32_t count);
+
+/**
+ * @brief Check the freshness of a message in bounded time, before its tag is verified
+ *
+ * The window is found among at most REPLAY_MAX_IDS identifiers, the check
+ * itself is O(1).
+ *
+ * A message is fresh if its sequence is ahead of the window, or inside the
+ * window and not seen yet (out-of-order frames are accepted). The session is
+ * ignored: the sender's sequence goes on across its resets (persistent
+ * counter), so it orders messages of every session. The window restarts
+ * with the first authenticated message under a new key epoch (the sequence
+ * restarts at 0 when the sender's store is blank): a message of another
+ * epoch than the window's is left to its tag, since the old key is retired
+ * as soon as the new one is used. Nothing is recorded until replay_accept().
+ *
+ * @param id Identifier (REPLAY_UNTRACKED if not protected)
+ * @param iv Initialization vector of the message
+ * @return uint8_t REPLAY_FRESH, or the reason the message is rejected
+ */
+uint8_t replay_check(uint32_t id, const uint8_t *iv);
+
+/**
+ * @brief Record an authenticated message in the window of its identifier
+ *
+ * A message under another key epoch than the window's restarts the window.
+ *
+ * @param id Identifier
+ * @param iv Initialization vector of the message
+ */
+void replay_accept(uint32_t id, const uint8_t *iv);
+
+/**
+ * @brief Print the rejected messages per reason
+ *
+ */
+void replay_print();
+
+/**
+ * @brief Clear the rejection counters (the windows are kept)
+ *
+ */
+void replay_reset();
+
+
+#endif
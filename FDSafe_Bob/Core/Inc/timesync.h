@@ -0,0 +1,87 @@
+/**
+ * @file timesync.h
+ * @author Luan
+ * @brief Bus time synchronisation, receiver side (offset and drift to the master)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_TIMESYNC_H
+#define FDSAFE_TIMESYNC_H
+
+
+#include "main.h"
+
+
+/* Reserved identifiers (high priority, sent by the master) */
+#define TIMESYNC_SYNC_ID 0x010
+#define TIMESYNC_FOLLOW_UP_ID 0x011
+
+/* Frames: sequence (1), padding (3) and master time in timestamp ticks (4, little-endian) */
+#define TIMESYNC_FRAME_SIZE 8
+
+/* Weight of a new drift sample (1 / 2^shift) */
+#define TIMESYNC_DRIFT_SHIFT 3
+
+/* Pairs further off the model are discarded (ticks, 1 ms at 8 us per tick): a sync frame read more
+ * than one wrap-around after its reception (65536 ticks) is extended with the wrong wrap count, and
+ * the frames are not authenticated. Largest drift between two pairs (the HSI16 of each node is
+ * within 1 % over temperature, so the clocks may differ by 2 %), consecutive discarded pairs
+ * before the model restarts (the master time itself may have jumped) */
+#define TIMESYNC_MAX_RESIDUAL 125
+#define TIMESYNC_MAX_DRIFT_PPM 20000
+#define TIMESYNC_MAX_DISCARDS 4
+
+
+/**
+ * @brief Check if a received message is a sync or follow-up frame
+ *
+ * @param RxHeader Header of the received message
+ * @return uint8_t 1 if it is a time synchronisation frame, 0 otherwise
+ */
+uint8_t timesync_is_frame(const FDCAN_RxHeaderTypeDef *RxHeader);
+
+/**
+ * @brief Process a sync or follow-up frame
+ *
+ * The RX timestamp of the sync frame is paired with the master time of the
+ * follow-up of the same sequence: both stamp the start of the sync frame on
+ * the bus. Each pair corrects the offset to the master, and the drift (rate
+ * of the local counter against the master one) is filtered over the pairs.
+ * A pair further than TIMESYNC_MAX_RESIDUAL from the prediction is
+ * discarded, and the model restarts after TIMESYNC_MAX_DISCARDS in a row.
+ *
+ * @param RxHeader Header of the received message
+ * @param data Payload of the received message
+ */
+void timesync_process(const FDCAN_RxHeaderTypeDef *RxHeader, const uint8_t *data);
+
+/**
+ * @brief Check if the offset and drift are known (two synchronisations at least)
+ *
+ * @return uint8_t 1 if synchronised, 0 otherwise
+ */
+uint8_t timesync_locked();
+
+/**
+ * @brief Convert a local extended timestamp to master time
+ *
+ * Before the first synchronisation, the local time is returned as is.
+ *
+ * @param local Extended timestamp in ticks (fdcan_timestamp_extend)
+ * @return uint32_t Master time in timestamp ticks
+ */
+uint32_t timesync_to_global(uint32_t local);
+
+/**
+ * @brief Print the offset, drift and accuracy (residual of the last synchronisation) and the discarded pairs
+ *
+ */
+void timesync_print();
+
+
+#endif
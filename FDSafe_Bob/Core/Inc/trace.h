@@ -0,0 +1,85 @@
+/**
+ * @file trace.h
+ * @author Luan
+ * @brief Hot-path trace points with DWT cycle timestamps
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_TRACE_H
+#define FDSAFE_TRACE_H
+
+
+#include "main.h"
+
+
+/* Set to 0 to remove every trace point from the build */
+#define TRACE_ENABLED 1
+
+/* Amount of records kept in RAM (must be a power of two) */
+#define TRACE_RING_SIZE 128
+
+/* Records printed per trace_poll() call while dumping */
+#define TRACE_DUMP_BATCH 1
+
+
+/* Trace point identifiers */
+typedef enum {
+	TRACE_RX_ISR = 0,
+	TRACE_RX_DEQUEUE,
+	TRACE_DECRYPT_START,
+	TRACE_DECRYPT_END,
+	TRACE_DECODE,
+	TRACE_OUTPUT,
+	TRACE_ENCRYPT_START,
+	TRACE_ENCRYPT_END,
+	TRACE_TX_COMMIT,
+} TraceEvent;
+
+/* Fixed-size trace record (8 bytes) */
+typedef struct {
+	uint32_t cycles;
+	uint16_t event;
+	uint16_t arg;
+} TraceRecord;
+
+
+#if TRACE_ENABLED
+#define TRACE(event, arg) trace_record((event), (uint16_t)(arg))
+#else
+#define TRACE(event, arg) ((void)0)
+#endif
+
+
+/**
+ * @brief Store a trace record stamped with the current cycle counter
+ *
+ * Safe to be called from interrupt context.
+ *
+ * @param event Trace point identifier
+ * @param arg Event argument (message identifier, result, etc.)
+ */
+void trace_record(TraceEvent event, uint16_t arg);
+
+/**
+ * @brief Start dumping the stored records through UART, oldest first
+ *
+ * Recording is paused until the dump is over. The records are printed by
+ * trace_poll(), so the dump does not hold the main loop.
+ */
+void trace_dump();
+
+/**
+ * @brief Start a dump once the ring is filled and print the next TRACE_DUMP_BATCH records
+ *
+ * Called from the main loop. Once every record is printed, the ring is
+ * cleared and the recording restarts.
+ */
+void trace_poll();
+
+
+#endif
@@ -19,5 +19,45 @@
 
 #define PUTCHAR_PROTOTYPE int __io_putchar(int ch)
 
+/* Longest command line received (including the terminator) */
+#define UART_LINE_SIZE 64
+
+
+/**
+ * @brief Make stdout unbuffered, so stdio never allocates a buffer (called before the first printf)
+ *
+ */
+void uart_setup();
+
+/**
+ * @brief Start the interrupt-driven line reception
+ * 
+ */
+void uart_rx_start();
+
+/**
+ * @brief UART reception callback, stores one byte and rearms the reception
+ * 
+ * @param huart UART handler
+ */
+void uart_rx_callback(UART_HandleTypeDef *huart);
+
+/**
+ * @brief UART error callback, rearms the reception
+ * 
+ * @param huart UART handler
+ */
+void uart_error_callback(UART_HandleTypeDef *huart);
+
+/**
+ * @brief Get the last complete line, if any (non-blocking)
+ * 
+ * Bytes received while a line is pending are dropped.
+ * 
+ * @param line Buffer of UART_LINE_SIZE bytes to store the line (null-terminated)
+ * @return uint8_t 1 if a line was copied, 0 otherwise
+ */
+uint8_t uart_read_line(char *line);
+
 
 #endif
\ No newline at end of file
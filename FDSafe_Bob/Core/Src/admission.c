@@ -0,0 +1,181 @@
+/**
+ * @file admission.c
+ * @author Luan
+ * @brief Pre-authentication admission: structural checks and verification budgets
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include <string.h>
+#include "admission.h"
+#include "crypto.h"
+#include "uart.h"
+
+
+/* Tokens are kept in thousandths, so a rate per second refills per millisecond */
+#define TOKEN 1000
+
+/* Token bucket */
+typedef struct {
+	uint32_t tokens;
+	uint32_t last_refill;
+} Bucket;
+
+/* Expected identifiers, the bucket of an identifier is at its index */
+static const uint32_t *expected_ids = NULL;
+static uint32_t expected_count = 0;
+
+static Bucket id_buckets[ADMISSION_MAX_IDS];
+static Bucket total_bucket;
+static uint32_t id_rate = 0;
+static uint32_t total_rate = 0;
+
+/* Dropped frames per reason */
+static uint32_t dropped[ADMIT_OVER_BUDGET + 1];
+
+/* Failures not reported yet */
+static uint32_t failures = 0;
+static uint32_t last_failed_id = 0;
+static uint32_t last_report = 0;
+
+
+/* Static function prototypes */
+static Bucket *find_bucket(uint32_t id);
+static void refill(Bucket *bucket, uint32_t rate, uint32_t burst, uint32_t now);
+
+
+void admission_setup(const uint32_t *ids, uint32_t count) {
+	if (count > ADMISSION_MAX_IDS) {
+		printf("Too many expected identifiers\r\n");
+		Error_Handler();
+	}
+
+	expected_ids = ids;
+	expected_count = count;
+}
+
+void admission_set_rates(uint32_t per_id, uint32_t total) {
+	uint32_t now = HAL_GetTick();
+
+	id_rate = per_id;
+	total_rate = total;
+
+	/* Start with full buckets */
+	for (uint32_t i = 0; i < ADMISSION_MAX_IDS; i++) {
+		id_buckets[i].tokens = ADMISSION_ID_BURST * TOKEN;
+		id_buckets[i].last_refill = now;
+	}
+	total_bucket.tokens = ADMISSION_TOTAL_BURST * TOKEN;
+	total_bucket.last_refill = now;
+}
+
+uint8_t admission_check(uint32_t id, size_t frame_size, size_t overhead) {
+	uint8_t result = ADMIT_OK;
+
+	if (find_bucket(id) == NULL) {
+		result = ADMIT_UNEXPECTED_ID;
+	}
+	else if (frame_size <= overhead) {
+		result = ADMIT_MALFORMED;
+	}
+
+	if (result != ADMIT_OK) {
+		dropped[result]++;
+	}
+	return result;
+}
+
+uint8_t admission_budget(uint32_t id) {
+	uint32_t now = HAL_GetTick();
+	Bucket *bucket = find_bucket(id);
+
+	if (bucket == NULL) {
+		dropped[ADMIT_UNEXPECTED_ID]++;
+		return ADMIT_UNEXPECTED_ID;
+	}
+
+	refill(bucket, id_rate, ADMISSION_ID_BURST, now);
+	refill(&total_bucket, total_rate, ADMISSION_TOTAL_BURST, now);
+
+	/* A failure must be affordable before the verification is attempted */
+	if (bucket->tokens < TOKEN || total_bucket.tokens < TOKEN) {
+		dropped[ADMIT_OVER_BUDGET]++;
+		return ADMIT_OVER_BUDGET;
+	}
+	return ADMIT_OK;
+}
+
+void admission_result(uint32_t id, uint8_t auth) {
+	Bucket *bucket = find_bucket(id);
+
+	if (auth == AUTH_OK) {
+		return;
+	}
+
+	if (bucket != NULL) {
+		bucket->tokens -= TOKEN;
+	}
+	total_bucket.tokens -= TOKEN;
+	failures++;
+	last_failed_id = id;
+}
+
+void admission_poll() {
+	uint32_t now = HAL_GetTick();
+
+	if (failures == 0 || now - last_report < ADMISSION_REPORT_INTERVAL) {
+		return;
+	}
+
+	printf("Invalid messages: %u in %u ms (last ID 0x%X)\r\n",
+		(unsigned int)failures,
+		(unsigned int)(now - last_report),
+		(unsigned int)last_failed_id);
+	failures = 0;
+	last_report = now;
+}
+
+void admission_print() {
+	printf("admission: malformed %u, unexpected %u, over budget %u\r\n",
+		(unsigned int)dropped[ADMIT_MALFORMED],
+		(unsigned int)dropped[ADMIT_UNEXPECTED_ID],
+		(unsigned int)dropped[ADMIT_OVER_BUDGET]);
+}
+
+void admission_reset() {
+	memset(dropped, 0, sizeof(dropped));
+}
+
+/**
+ * @brief Get the bucket of an identifier
+ *
+ * @param id Identifier
+ * @return Bucket* Bucket, NULL if the identifier is not expected
+ */
+static Bucket *find_bucket(uint32_t id) {
+	for (uint32_t i = 0; i < expected_count; i++) {
+		if (expected_ids[i] == id) {
+			return &id_buckets[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Add the tokens earned since the last refill, up to the burst
+ *
+ * @param bucket Token bucket
+ * @param rate Tokens per second
+ * @param burst Bucket capacity in tokens
+ * @param now Current tick
+ */
+static void refill(Bucket *bucket, uint32_t rate, uint32_t burst, uint32_t now) {
+	uint64_t tokens = bucket->tokens + (uint64_t)(now - bucket->last_refill) * rate;
+
+	bucket->tokens = tokens > burst * TOKEN ? burst * TOKEN : (uint32_t)tokens;
+	bucket->last_refill = now;
+}
@@ -12,20 +12,27 @@
 
 #include <app.h>
 #include "main.h"
+#include "keytable.h"
+#include "ram.h"
 
 
-/* Control */
+/* Default operating modes (changed at run time through the UART command channel) */
 #define BOB_DEBUG 0
 #define ENCRYPTION_ENABLED 1
 #define INTERNAL_LOG 0
+#define REPLAY_PROTECTION 1
+#define SELECTIVE_DECRYPTION 1
+#define CLOCK_PROFILE CLOCK_PROFILE_160MHZ
+
+/* Failed verifications per second tolerated per identifier and in total (hard cap on wasted decryptions) */
+#define VERIFY_ID_RATE 20
+#define VERIFY_TOTAL_RATE 100
 
 
 /* Message parameters */
-#if ENCRYPTION_ENABLED
-#define DATA_SIZE 20
-#else
-#define DATA_SIZE 64
-#endif
+#define ENCRYPTED_DATA_SIZE 20
+#define PLAIN_DATA_SIZE 64
+#define MAX_FRAME_SIZE 64
 
 #define ID_ENGINE_CONTROLLER 0x6F
 #define ID_TACHOGRAPH 0x14D
@@ -33,10 +40,65 @@
 #define ID_FUEL 0x3E7
 #define ID_DISTANCE 0x7B5
 #define ID_STATISTICS 0x1F
+#define ID_BENCH_END 0x1E
+#define ID_CONTAINER 0x3A0
+#define ID_MAC_WINDOW 0x70
+
+/* Windowed MAC frames: payload (8), sequence (4) and running tag fragment (4) */
+#define WINDOW_PAYLOAD_SIZE 8
+#define WINDOW_FRAME_SIZE (WINDOW_PAYLOAD_SIZE + 4 + MAC_FRAGMENT_SIZE)
+
+/* Window tag frames: first sequence (4), frame count (1), padding (3) and tag */
+#define WINDOW_TAG_FRAME_SIZE (8 + MAC_TAG_SIZE)
+
+/* Content of the segmented test message sent by Alice */
+#define SEGMENT_PATTERN(i) ((uint8_t)((i) * 31 + 7))
 
+/* Interval between histogram summaries and bus statistics */
+#define STATS_REPORT_INTERVAL 10 SECONDS
 
-/* Variables struct */
+/* Decryptions per path and identifier in the selective decryption benchmark */
+#define FIELD_BENCH_ROUNDS 100
+
+
+/* Runtime configuration struct */
 typedef struct {
+    uint32_t debug;
+    uint32_t encryption;
+    uint32_t internal_log;
+    uint32_t crypto_engine;
+    uint32_t header_aad;
+    uint32_t replay_protection;
+    uint32_t selective;
+    uint32_t verify_id_rate;
+    uint32_t verify_total_rate;
+    uint32_t clock;
+} Config;
+
+static Config config = {
+    .debug = BOB_DEBUG,
+    .encryption = ENCRYPTION_ENABLED,
+    .internal_log = INTERNAL_LOG,
+    .crypto_engine = CRYPTO_ENGINE_FAST,
+    .header_aad = HEADER_AAD_CACHED,
+    .replay_protection = REPLAY_PROTECTION,
+    .selective = SELECTIVE_DECRYPTION,
+    .verify_id_rate = VERIFY_ID_RATE,
+    .verify_total_rate = VERIFY_TOTAL_RATE,
+    .clock = CLOCK_PROFILE,
+};
+
+/* Bytes of a message read by its decoder */
+typedef struct {
+    uint32_t id;
+    uint8_t first;
+    uint8_t size;
+} FieldLayout;
+
+/* Variables struct (time of the last frame and one-way latency of the last stamped one, in microseconds of bus time) */
+typedef struct {
+    uint32_t time_us;
+    uint32_t latency_us;
     uint32_t counter;
 	float eng_speed;
     float eng_temperature;
@@ -45,37 +107,159 @@ typedef struct {
     float fuel_level;
 } Dashboard;
 
-#if INTERNAL_LOG
-#define LOG_ROWS 1000
-uint32_t internal_log[LOG_ROWS][2];
+/* Benchmark messages logged: bus time, counter and one-way latency */
+#define LOG_ROWS 128
+uint32_t internal_log[LOG_ROWS][3] RAM_LOGS;
 uint32_t l = 0;
-#endif
+
+/* Throughput benchmark counters of the current run */
+static uint32_t bench_received = 0;
+static uint32_t bench_auth_fail = 0;
+
+/* Bytes of the segmented message being received that differ from the test pattern */
+static uint32_t segment_mismatches = 0;
+
+/* Window of the engine speed stream being verified */
+static struct {
+    uint8_t open;
+    uint8_t epoch;          /* Key epoch of the open window and of the sequences below */
+    uint8_t verified;       /* A window of the epoch was verified */
+    uint32_t first_seq;
+    uint32_t count;
+    uint32_t next_seq;      /* Sequence after the last frame accepted, anything below is a replay */
+    uint32_t verified_seq;  /* Last sequence of the last verified window */
+    uint32_t ok;
+    uint32_t failed;
+    uint32_t incomplete;
+    uint32_t replayed;
+} window;
+
+/* Cycle histograms */
+static Histogram hist_decrypt RAM_LOGS;
+static Histogram hist_auth_fail RAM_LOGS;
+static Histogram hist_rx RAM_LOGS;
+static Histogram hist_delivery RAM_LOGS;
+static Histogram hist_oneway RAM_LOGS;
+static Histogram hist_mac_frame RAM_LOGS;
+static Histogram hist_mac_window RAM_LOGS;
 
 
 /* Static function prototypes */
 static void clear_data(uint8_t *data, size_t size, uint8_t value);
-#if BOB_DEBUG
 static void print_raw_data(uint32_t id, uint8_t *data, size_t size);
-#else
-#if !INTERNAL_LOG
 static void print_formated_data(Dashboard *dashboard);
-#endif
-#endif
-static uint32_t get_usec_time();
 static uint32_t get_clock_cycles();
+static void print_histograms();
+static void print_statistics();
+static void reset_histograms();
+static void apply_crypto_engine(uint32_t engine);
+static void apply_header_aad(uint32_t mode);
+static void apply_verify_rates(uint32_t rate);
+static void apply_clock(uint32_t profile);
+static void clock_workload();
+static void clock_bench();
+static void print_bench_report(uint8_t *data);
+static int32_t find_field_layout(uint32_t id);
+static void field_benchmark();
+static void segment_sink(uint32_t offset, const uint8_t *data, size_t size);
+static void segment_done(uint32_t length, uint32_t received, uint8_t auth);
+static void parse_message(Dashboard *dashboard, uint32_t id, uint8_t *data);
+static void parse_container(Dashboard *dashboard, uint8_t *data, size_t size);
+static uint32_t window_seq(const uint8_t *frame);
+static uint8_t window_fresh(uint32_t id, const uint8_t *frame);
+static uint8_t verify_window_frame(uint32_t id, uint8_t *frame, uint8_t *data);
+static void verify_window_tag(uint8_t *frame, size_t size);
+static size_t read_did(uint16_t did, uint8_t *data);
 
 
-#if BOB_DEBUG
 /* Data Length Code map */
 const uint8_t DLCtoBytes[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
-#endif
+
+/* Identifiers carrying encrypted messages (the others are dropped before decryption), each one owns a replay window and a verification budget */
+static const uint32_t encrypted_ids[] = {
+    ID_ENGINE_CONTROLLER,
+    ID_TACHOGRAPH,
+    ID_ENGINE_TEMPERATURE,
+    ID_FUEL,
+    ID_DISTANCE,
+    ID_STATISTICS,
+    ID_CONTAINER,
+};
+
+/* Other identifiers whose authentication is counted, their statistics slots are reserved too */
+static const uint32_t authenticated_ids[] = {
+    ID_MAC_WINDOW,
+};
+
+/* Fields read by parse_message(), the only bytes decrypted when selective decryption is enabled */
+static const FieldLayout field_layouts[] = {
+    {ID_ENGINE_CONTROLLER, 4, 2},
+    {ID_TACHOGRAPH, 6, 2},
+    {ID_ENGINE_TEMPERATURE, 7, 1},
+    {ID_FUEL, 1, 1},
+    {ID_DISTANCE, 0, 4},
+    {ID_STATISTICS, 0, 8},
+};
+
+#define FIELD_LAYOUTS (sizeof(field_layouts) / sizeof(field_layouts[0]))
+
+/* Last authenticated frame of each layout, replayed by the selective decryption benchmark */
+static uint8_t field_frames[FIELD_LAYOUTS][MAX_FRAME_SIZE] RAM_BUFFERS;
+static uint8_t field_frame_sizes[FIELD_LAYOUTS];
+
+/* Parameters changed through the UART command channel */
+static const CommandParam params[] = {
+    {"debug", &config.debug, 0, 1, NULL},
+    {"encryption", &config.encryption, 0, 1, NULL},
+    {"internal_log", &config.internal_log, 0, 1, NULL},
+    {"engine", &config.crypto_engine, 0, CRYPTO_ENGINES - 1, apply_crypto_engine},
+    {"header_aad", &config.header_aad, 0, HEADER_AAD_MODES - 1, apply_header_aad},
+    {"replay_protection", &config.replay_protection, 0, 1, NULL},
+    {"selective", &config.selective, 0, 1, NULL},
+    {"verify_id_rate", &config.verify_id_rate, 1, 10000, apply_verify_rates},
+    {"verify_total_rate", &config.verify_total_rate, 1, 10000, apply_verify_rates},
+    {"clock", &config.clock, 0, CLOCK_PROFILES - 1, apply_clock},
+};
+
+/* Actions triggered through the UART command channel */
+static const CommandAction actions[] = {
+    {"stats", print_statistics},
+    {"reset", reset_histograms},
+    {"trace", trace_dump},
+    {"keybench", keytable_benchmark},
+    {"fieldbench", field_benchmark},
+    {"clockbench", clock_bench},
+};
 
 
 void fdsafe_setup() {
 
+    uart_setup();
+    clock_setup();
+    clock_set_profile(config.clock);
 	fdcan_activate_rx_notification();
 	fdcan_setup();
     crypto_setup();
+    crypto_set_engine(config.crypto_engine);
+    crypto_set_header_aad(config.header_aad);
+    rekey_setup();
+
+    hist_init(&hist_decrypt, "decrypt");
+    hist_init(&hist_auth_fail, "auth_fail");
+    hist_init(&hist_rx, "rx_total");
+    hist_init(&hist_delivery, "delivery_us");
+    hist_init(&hist_oneway, "oneway_us");
+    hist_init(&hist_mac_frame, "mac_frame");
+    hist_init(&hist_mac_window, "mac_window");
+
+    diag_setup(DIAG_BOB_REQUEST_ID, DIAG_BOB_RESPONSE_ID, read_did);
+    isotp_setup(segment_sink, segment_done);
+    idmap_reserve(encrypted_ids, sizeof(encrypted_ids) / sizeof(encrypted_ids[0]));
+    idmap_reserve(authenticated_ids, sizeof(authenticated_ids) / sizeof(authenticated_ids[0]));
+    admission_setup(encrypted_ids, sizeof(encrypted_ids) / sizeof(encrypted_ids[0]));
+    replay_setup(encrypted_ids, sizeof(encrypted_ids) / sizeof(encrypted_ids[0]));
+    admission_set_rates(config.verify_id_rate, config.verify_total_rate);
+    command_setup(params, sizeof(params) / sizeof(params[0]), actions, sizeof(actions) / sizeof(actions[0]));
     
     // enable core debug timers
     SET_BIT(CoreDebug->DEMCR, CoreDebug_DEMCR_TRCENA_Msk);
@@ -86,13 +270,15 @@ void fdsafe_setup() {
 
 void fdsafe_main() {
 
-    /* Buffers to store the received message header and data */
+    /* Buffers to store the received message header and data (the frame buffers in the buffers arena) */
 	FDCAN_RxHeaderTypeDef RxHeader;
-	uint8_t RxData[DATA_SIZE];
+	static uint8_t RxData[PLAIN_DATA_SIZE] RAM_BUFFERS;
+	static uint8_t cipher_rx_buffer[MAX_FRAME_SIZE] RAM_BUFFERS;
 
-#if !BOB_DEBUG
     /* Set of variables */
     Dashboard dashboard = {
+        .time_us = 0,
+        .latency_us = 0,
         .counter = 0,
         .eng_speed = 0.0,
         .eng_temperature = 0.0,
@@ -100,121 +286,191 @@ void fdsafe_main() {
         .vehicle_distance = 0.0,
         .fuel_level = 0.0,
     };
-#endif
 
-#if ENCRYPTION_ENABLED
-	uint8_t cipher_rx_buffer[DATA_SIZE + AUTH_TAG_SIZE + IV_SIZE];
-    uint8_t auth_return;
-#endif
+    uint32_t next_report = STATS_REPORT_INTERVAL;
 
     /**
      * @brief Infinite loop to read new messages when available and parse them
      * 
      * When a new message is available:
      * 1. Clear received data buffer
-     * 2. Read the message
-     * 3. Decrypt (if applicable)
-     * 4. If authentication is valid, parse the message according to the ID and store in the dashboard
+     * 2. Read the message and account it in the per-ID statistics (time synchronisation frames, diagnostic requests, key updates, segments and benchmark end markers are handled here)
+     * 3. Decrypt (if applicable) once the frame passes the admission checks (structure, identifier, freshness, budget), the plaintext size is given by the DLC. Frames of a MAC window are verified instead
+     * 4. If authentication is valid, parse the message (or each signal of a container) according to the ID and store in the dashboard
      * 5. If authentication is valid, present the data (print)
+     * 6. Record the cycles spent on the message, its delivery latency and its one-way latency (benchmark messages) in the histograms
+     * 7. Dump the trace records when the trace ring is full, a few per iteration while the RX FIFO is empty
+     * 8. Print the histogram summaries and per-ID statistics at a fixed interval
+     * 9. Execute pending UART commands
      */
     while (1)
     {
         if (fdcan_available())
         {
+            uint32_t rx_start = get_clock_cycles();
             clear_data(RxData, sizeof(RxData), 0xFF);
 
-#if ENCRYPTION_ENABLED
-            fdcan_read(&RxHeader, cipher_rx_buffer);
-            uint32_t start_time = get_clock_cycles();
-	        auth_return = decrypt(cipher_rx_buffer, RxData, sizeof(RxData));
-            uint32_t end_time = get_clock_cycles();
-#else
-            fdcan_read(&RxHeader, RxData);
-#endif
-
-#if !BOB_DEBUG
-#if ENCRYPTION_ENABLED
-            if(auth_return == AUTH_OK)
-            {
-#endif
-                switch (RxHeader.Identifier)
-                {
-                    case ID_ENGINE_CONTROLLER:
-                        dashboard.eng_speed = ((RxData[5] << 8) | RxData[4]) / 8;
-                        break;
-
-                    case ID_ENGINE_TEMPERATURE:
-                        dashboard.eng_temperature = RxData[7] - 40;
-                        break;
-
-                    case ID_TACHOGRAPH:
-                        dashboard.vehicle_speed = ((RxData[7] << 8) | RxData[6]) / 256;
-                        break;
-
-                    case ID_DISTANCE:
-                        dashboard.vehicle_distance = (
-                            (RxData[3] << 24)
-                            | (RxData[2] << 16)
-                            | (RxData[1] << 8)
-                            | RxData[0]
-                            ) * 5;
-                        break;
-
-                    case ID_FUEL:
-                        dashboard.fuel_level = RxData[1] * 0.4;
-                        break;
-
-                    case ID_STATISTICS:
-                        dashboard.counter = (
-                            (RxData[3] << 24)
-                            | (RxData[2] << 16)
-                            | (RxData[1] << 8)
-                            | RxData[0]
-                            );
-#if INTERNAL_LOG
-                        if (l < LOG_ROWS) {
-                            internal_log[l][0] = get_usec_time();
-                            internal_log[l][1] = dashboard.counter;
-                            l++;
-                        }
-                        else if (l == LOG_ROWS) {
-                            for (uint32_t i = 0; i < LOG_ROWS; i++) {
-                                printf("%u, %u\r\n", (unsigned int)internal_log[i][0], (unsigned int)internal_log[i][1]);
-                            }
-                            l = 9999;
+            uint8_t *rx_buffer = config.encryption ? cipher_rx_buffer : RxData;
+            fdcan_read(&RxHeader, rx_buffer);
+            idstats_update(&RxHeader);
+            uint32_t received = fdcan_timestamp_extend(RxHeader.RxTimestamp);
+
+            /* Time synchronisation frames correct the bus time, they are not encrypted */
+            if (timesync_is_frame(&RxHeader)) {
+                timesync_process(&RxHeader, rx_buffer);
+                continue;
+            }
+
+            /* Diagnostic requests are answered and not parsed as data */
+            if (diag_is_request(&RxHeader)) {
+                diag_process(&RxHeader, rx_buffer);
+                continue;
+            }
+
+            /* New keys are installed and acknowledged, nonce requests answered, not parsed as data */
+            if (rekey_is_update(&RxHeader)) {
+                rekey_update(rx_buffer, DLCtoBytes[RxHeader.DataLength]);
+                continue;
+            }
+            if (rekey_is_request(&RxHeader)) {
+                rekey_request();
+                continue;
+            }
+
+            /* Segments are decrypted by the segmented reception itself */
+            if (isotp_is_frame(&RxHeader)) {
+                isotp_process(&RxHeader, rx_buffer);
+                continue;
+            }
+
+            /* Benchmark end markers are not encrypted */
+            if (RxHeader.Identifier == ID_BENCH_END) {
+                print_bench_report(rx_buffer);
+                continue;
+            }
+
+            uint8_t auth_return = AUTH_OK;
+            size_t data_size = DLCtoBytes[RxHeader.DataLength];
+
+            /* Windowed MAC frames are authenticated, not encrypted */
+            if (RxHeader.Identifier == ID_MAC_WINDOW) {
+                verify_window_tag(rx_buffer, data_size);
+                continue;
+            }
+
+            if (RxHeader.Identifier == ID_ENGINE_CONTROLLER && data_size == WINDOW_FRAME_SIZE) {
+                /* Same admission as the encrypted frames, the sequence is the freshness */
+                if (admission_check(RxHeader.Identifier, data_size, WINDOW_FRAME_SIZE - WINDOW_PAYLOAD_SIZE) != ADMIT_OK
+                        || (config.replay_protection && !window_fresh(RxHeader.Identifier, rx_buffer))
+                        || admission_budget(RxHeader.Identifier) != ADMIT_OK) {
+                    auth_return = AUTH_ERROR;
+                }
+                else {
+                    auth_return = verify_window_frame(RxHeader.Identifier, rx_buffer, RxData);
+                    admission_result(RxHeader.Identifier, auth_return);
+                }
+                idstats_auth(RxHeader.Identifier, auth_return == AUTH_OK);
+                data_size = WINDOW_PAYLOAD_SIZE;
+            }
+            else if (config.encryption) {
+                size_t frame_size = data_size;
+                data_size = data_size > AUTH_TAG_SIZE + IV_SIZE ? data_size - AUTH_TAG_SIZE - IV_SIZE : 0;
+                const uint8_t *iv = &cipher_rx_buffer[data_size + AUTH_TAG_SIZE];
+
+                /* Cheap checks first (structure, identifier, freshness, budget), the decryption last */
+                if (admission_check(RxHeader.Identifier, frame_size, AUTH_TAG_SIZE + IV_SIZE) != ADMIT_OK
+                        || (config.replay_protection && replay_check(RxHeader.Identifier, iv) != REPLAY_FRESH)
+                        || admission_budget(RxHeader.Identifier) != ADMIT_OK) {
+                    auth_return = AUTH_ERROR;
+                    idstats_auth(RxHeader.Identifier, 0);
+                }
+                else {
+                    /* Only the bytes the decoder reads, unless the whole payload is printed or demultiplexed */
+                    int32_t layout = find_field_layout(RxHeader.Identifier);
+                    uint8_t selective = config.selective && !config.debug && layout >= 0
+                        && field_layouts[layout].first + field_layouts[layout].size <= data_size;
+
+                    uint32_t start_time = get_clock_cycles();
+                    auth_return = selective
+                        ? decrypt_field(RxHeader.Identifier, cipher_rx_buffer, RxData, data_size,
+                            field_layouts[layout].first, field_layouts[layout].size)
+                        : decrypt(RxHeader.Identifier, cipher_rx_buffer, RxData, data_size);
+                    uint32_t end_time = get_clock_cycles();
+                    idstats_auth(RxHeader.Identifier, auth_return == AUTH_OK);
+                    admission_result(RxHeader.Identifier, auth_return);
+                    if (auth_return == AUTH_OK) {
+                        hist_record(&hist_decrypt, end_time - start_time);
+                        replay_accept(RxHeader.Identifier, iv);
+                        if (layout >= 0) {
+                            memcpy(field_frames[layout], cipher_rx_buffer, frame_size);
+                            field_frame_sizes[layout] = frame_size;
                         }
-#endif
-#if ENCRYPTION_ENABLED
-                        printf("%u, %u, %u\r\n", (unsigned int)dashboard.counter, (unsigned int)(end_time-start_time), (unsigned int) SystemCoreClock);
-#endif
-                        break;
-                    
-                    default:
-                        break;
+                    } else {
+                        hist_record(&hist_auth_fail, end_time - start_time);
+                    }
+                }
+            }
+
+            if (RxHeader.Identifier == ID_STATISTICS) {
+                if (auth_return == AUTH_OK) {
+                    bench_received++;
+                } else {
+                    bench_auth_fail++;
                 }
-#if ENCRYPTION_ENABLED
             }
-#endif
-#endif
-
-#if !INTERNAL_LOG
-#if BOB_DEBUG
-#if ENCRYPTION_ENABLED
-            print_raw_data(RxHeader.Identifier, RxData, sizeof(RxData));
-#else
-            print_raw_data(RxHeader.Identifier, RxData, DLCtoBytes[RxHeader.DataLength]);
-#endif
-#else
-#if ENCRYPTION_ENABLED
-            if(auth_return == AUTH_OK) {
-                print_formated_data(&dashboard);
+
+            if (!config.debug && auth_return == AUTH_OK)
+            {
+                dashboard.time_us = fdcan_timestamp_to_usec(timesync_to_global(received));
+                if (RxHeader.Identifier == ID_CONTAINER) {
+                    parse_container(&dashboard, RxData, data_size);
+                }
+                else {
+                    parse_message(&dashboard, RxHeader.Identifier, RxData);
+                }
+                TRACE(TRACE_DECODE, RxHeader.Identifier);
             }
-#else
-            print_formated_data(&dashboard);
-#endif
-#endif
-#endif
+
+            /* Time from the end of the frame on the bus to its delivery to the dashboard */
+            if (auth_return == AUTH_OK) {
+                hist_record(&hist_delivery, fdcan_timestamp_to_usec(fdcan_timestamp_now() - received));
+            }
+
+            /* Benchmark messages are only counted, unless debugging */
+            if (!config.internal_log && (config.debug || RxHeader.Identifier != ID_STATISTICS)) {
+                if (config.debug) {
+                    print_raw_data(RxHeader.Identifier, RxData, data_size);
+                }
+                else if (auth_return == AUTH_OK) {
+                    print_formated_data(&dashboard);
+                }
+                TRACE(TRACE_OUTPUT, RxHeader.Identifier);
+            }
+            hist_record(&hist_rx, get_clock_cycles() - rx_start);
+        }
+
+        /* Report a key switchover */
+        rekey_poll();
+
+        /* Rate-limited report of the authentication failures */
+        admission_poll();
+
+        /* Abort a segmented reception if the sender went silent */
+        isotp_poll();
+
+        /* Dump trace records once the ring is filled, a few at a time while no frame is waiting */
+        if (!fdcan_available()) {
+            trace_poll();
+        }
+
+        /* Periodic histogram summaries and bus statistics */
+        if (HAL_GetTick() >= next_report) {
+            print_statistics();
+            next_report = STATS_REPORT_INTERVAL + HAL_GetTick();
         }
+
+        /* UART commands */
+        command_poll();
     }
 }
 
@@ -231,7 +487,6 @@ static void clear_data(uint8_t *data, size_t size, uint8_t value) {
 	}
 }
 
-#if BOB_DEBUG
 /**
  * @brief Print received data
  * 
@@ -247,8 +502,6 @@ static void print_raw_data(uint32_t id, uint8_t *data, size_t size) {
 	printf("\r\n");
 }
 
-#else
-#if !INTERNAL_LOG
 /**
  * @brief Print message identifier and parsed data
  * 
@@ -257,7 +510,7 @@ static void print_raw_data(uint32_t id, uint8_t *data, size_t size) {
 static void print_formated_data(Dashboard *dashboard) {
     printf(
         "%u - %u, %u, %u, %u, %u, %u\r\n",
-        (unsigned int) get_usec_time(),
+        (unsigned int) dashboard->time_us,
         (unsigned int) dashboard->counter,
         (unsigned int) dashboard->eng_speed,
         (unsigned int) dashboard->eng_temperature,
@@ -266,16 +519,537 @@ static void print_formated_data(Dashboard *dashboard) {
         (unsigned int) dashboard->fuel_level
     );
 }
-#endif
-#endif
 
 /**
- * @brief Get the time in microseconds
+ * @brief Print the summary of every cycle histogram
+ * 
+ */
+static void print_histograms() {
+    printf("Cycles @ %u Hz\r\n", (unsigned int) SystemCoreClock);
+    hist_print(&hist_decrypt);
+    hist_print(&hist_auth_fail);
+    hist_print(&hist_rx);
+    hist_print(&hist_delivery);
+    hist_print(&hist_oneway);
+    hist_print(&hist_mac_frame);
+    hist_print(&hist_mac_window);
+    printf(
+        "mac windows: ok=%u failed=%u incomplete=%u replayed=%u\r\n",
+        (unsigned int) window.ok,
+        (unsigned int) window.failed,
+        (unsigned int) window.incomplete,
+        (unsigned int) window.replayed
+    );
+}
+
+/**
+ * @brief Parse a message according to its ID and store the values in the dashboard
+ *
+ * @param dashboard Dashboard
+ * @param id Message identifier
+ * @param data Plaintext payload
+ */
+static void parse_message(Dashboard *dashboard, uint32_t id, uint8_t *data) {
+    uint32_t origin;
+
+    switch (id)
+    {
+        case ID_ENGINE_CONTROLLER:
+            dashboard->eng_speed = ((data[5] << 8) | data[4]) / 8;
+            break;
+
+        case ID_ENGINE_TEMPERATURE:
+            dashboard->eng_temperature = data[7] - 40;
+            break;
+
+        case ID_TACHOGRAPH:
+            dashboard->vehicle_speed = ((data[7] << 8) | data[6]) / 256;
+            break;
+
+        case ID_DISTANCE:
+            dashboard->vehicle_distance = (
+                (data[3] << 24)
+                | (data[2] << 16)
+                | (data[1] << 8)
+                | data[0]
+                ) * 5;
+            break;
+
+        case ID_FUEL:
+            dashboard->fuel_level = data[1] * 0.4;
+            break;
+
+        case ID_STATISTICS:
+            dashboard->counter = (
+                (data[3] << 24)
+                | (data[2] << 16)
+                | (data[1] << 8)
+                | data[0]
+                );
+
+            /* Bus time of the message creation at Alice (absent from payloads under 8 bytes) */
+            origin = (data[7] << 24) | (data[6] << 16) | (data[5] << 8) | data[4];
+            if (origin != 0xFFFFFFFF && timesync_locked()) {
+                dashboard->latency_us = fdcan_timestamp_to_usec(timesync_to_global(fdcan_timestamp_now()) - origin);
+                hist_record(&hist_oneway, dashboard->latency_us);
+            }
+
+            if (config.internal_log) {
+                if (l < LOG_ROWS) {
+                    internal_log[l][0] = dashboard->time_us;
+                    internal_log[l][1] = dashboard->counter;
+                    internal_log[l][2] = dashboard->latency_us;
+                    l++;
+                }
+                else if (l == LOG_ROWS) {
+                    for (uint32_t i = 0; i < LOG_ROWS; i++) {
+                        printf("%u, %u, %u\r\n", (unsigned int)internal_log[i][0], (unsigned int)internal_log[i][1], (unsigned int)internal_log[i][2]);
+                    }
+                    l = 9999;
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Demultiplex a container into the dashboard
+ *
+ * Each signal is placed at its original position of an empty message, which
+ * is parsed as if it were received alone. Parsing stops at a malformed entry.
+ *
+ * @param dashboard Dashboard
+ * @param data Container payload
+ * @param size Container payload size
+ */
+static void parse_container(Dashboard *dashboard, uint8_t *data, size_t size) {
+    uint8_t message[CONTAINER_MAX_MESSAGE_SIZE];
+    ContainerEntry entry;
+    size_t pos = CONTAINER_HEADER_SIZE;
+
+    if (size < CONTAINER_HEADER_SIZE) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < data[0]; i++) {
+        pos = container_next(data, size, pos, &entry);
+        if (pos == 0) {
+            break;
+        }
+
+        clear_data(message, sizeof(message), 0xFF);
+        memcpy(&message[entry.offset], entry.data, entry.length);
+        parse_message(dashboard, entry.id, message);
+    }
+}
+
+/**
+ * @brief Get the sequence of a frame of the MAC window
+ *
+ * @param frame Received frame: payload, sequence and fragment
+ * @return uint32_t Sequence
+ */
+static uint32_t window_seq(const uint8_t *frame) {
+    return ((uint32_t)frame[WINDOW_PAYLOAD_SIZE + 3] << 24)
+        | ((uint32_t)frame[WINDOW_PAYLOAD_SIZE + 2] << 16)
+        | ((uint32_t)frame[WINDOW_PAYLOAD_SIZE + 1] << 8)
+        | frame[WINDOW_PAYLOAD_SIZE];
+}
+
+/**
+ * @brief Check that a frame of the MAC window was not accepted before
+ *
+ * Alice's sequence only grows under a key: a frame below the last one
+ * accepted, or at or below the last verified window, is a replay. Under a new
+ * key of Alice (after her reset, the sequence restarts) every sequence is new.
+ *
+ * @param id Message identifier
+ * @param frame Received frame: payload, sequence and fragment
+ * @return uint8_t 1 if the frame is fresh
+ */
+static uint8_t window_fresh(uint32_t id, const uint8_t *frame) {
+    uint32_t seq = window_seq(frame);
+
+    if (keytable_epoch(id) != window.epoch) {
+        return 1;
+    }
+    if (seq < window.next_seq || (window.verified && seq <= window.verified_seq)) {
+        window.replayed++;
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Verify a frame of the MAC window
+ *
+ * A frame out of sequence closes the open window as incomplete and opens a
+ * new one, under the key derived from the active key of the sender. The
+ * running tag fragment only gives a weak per-frame check, the window tag
+ * confirms (or flags) every frame. The frame is checked fresh beforehand.
+ *
+ * @param id Message identifier
+ * @param frame Received frame: payload, sequence and fragment
+ * @param data Buffer to store the payload (may be the frame buffer)
+ * @return uint8_t AUTH_OK if the fragment matches
+ */
+static uint8_t verify_window_frame(uint32_t id, uint8_t *frame, uint8_t *data) {
+    uint8_t input[2 + WINDOW_FRAME_SIZE - MAC_FRAGMENT_SIZE];
+    uint8_t fragment[MAC_FRAGMENT_SIZE];
+    uint32_t seq = window_seq(frame);
+    uint8_t epoch = keytable_epoch(id);
+
+    uint32_t start_time = get_clock_cycles();
+    if (window.open && (epoch != window.epoch || seq != window.first_seq + window.count)) {
+        window.incomplete++;
+        window.open = 0;
+    }
+
+    /* A new key: the sequences of the previous one no longer apply */
+    if (epoch != window.epoch) {
+        window.epoch = epoch;
+        window.verified = 0;
+        window.next_seq = 0;
+    }
+
+    if (!window.open) {
+        if (mac_window_start(id, epoch) != AUTH_OK) {
+            return AUTH_ERROR;
+        }
+        window.open = 1;
+        window.first_seq = seq;
+        window.count = 0;
+    }
+
+    input[0] = (uint8_t)(id >> 8);
+    input[1] = (uint8_t)(id & 0xFF);
+    memcpy(&input[2], frame, sizeof(input) - 2);
+    memcpy(fragment, &frame[sizeof(input) - 2], MAC_FRAGMENT_SIZE);
+    uint8_t auth_return = mac_window_append(input, sizeof(input), fragment);
+    window.count++;
+    hist_record(&hist_mac_frame, get_clock_cycles() - start_time);
+
+    if (auth_return == AUTH_OK) {
+        window.next_seq = seq + 1;
+    }
+
+    memmove(data, frame, WINDOW_PAYLOAD_SIZE);
+    clear_data(&data[WINDOW_PAYLOAD_SIZE], PLAIN_DATA_SIZE - WINDOW_PAYLOAD_SIZE, 0xFF);
+    return auth_return;
+}
+
+/**
+ * @brief Verify the tag of the open MAC window and flag the whole window on failure
+ *
+ * The tag is verified under the budget of the engine speed stream, a window
+ * at or below the last verified one is rejected.
+ *
+ * @param frame Received frame: first sequence, frame count and tag
+ * @param size Frame size
+ */
+static void verify_window_tag(uint8_t *frame, size_t size) {
+    uint32_t first_seq = ((uint32_t)frame[3] << 24) | ((uint32_t)frame[2] << 16)
+        | ((uint32_t)frame[1] << 8) | frame[0];
+    uint32_t count = frame[4];
+
+    if (size < WINDOW_TAG_FRAME_SIZE || !window.open
+            || first_seq != window.first_seq || count != window.count
+            || (window.verified && first_seq <= window.verified_seq)
+            || admission_budget(ID_ENGINE_CONTROLLER) != ADMIT_OK)
+    {
+        window.incomplete++;
+        window.open = 0;
+        return;
+    }
+
+    uint32_t start_time = get_clock_cycles();
+    uint8_t auth_return = mac_window_finish(&frame[8]);
+    hist_record(&hist_mac_window, get_clock_cycles() - start_time);
+    idstats_auth(ID_MAC_WINDOW, auth_return == AUTH_OK);
+    admission_result(ID_ENGINE_CONTROLLER, auth_return);
+    window.open = 0;
+
+    if (auth_return == AUTH_OK) {
+        window.ok++;
+        window.verified = 1;
+        window.verified_seq = first_seq + count - 1;
+    }
+    else {
+        window.failed++;
+        printf("MAC window %u-%u FAILED\r\n", (unsigned int)first_seq, (unsigned int)(first_seq + count - 1));
+    }
+}
+
+/**
+ * @brief Print the losses of a throughput benchmark run and start counting the next one
+ *
+ * @param data End marker payload: run (4) and sent messages (4), little-endian
+ */
+static void print_bench_report(uint8_t *data) {
+    uint32_t run = (data[3] << 24) | (data[2] << 16) | (data[1] << 8) | data[0];
+    uint32_t sent = (data[7] << 24) | (data[6] << 16) | (data[5] << 8) | data[4];
+
+    printf(
+        "Bench run %u: received %u of %u messages, lost %d, auth_fail %u\r\n",
+        (unsigned int) run,
+        (unsigned int) bench_received,
+        (unsigned int) sent,
+        (int) (sent - bench_received - bench_auth_fail),
+        (unsigned int) bench_auth_fail
+    );
+
+    bench_received = 0;
+    bench_auth_fail = 0;
+}
+
+/**
+ * @brief Check a slice of the segmented test message against the pattern
+ *
+ * @param offset Position of the slice in the message
+ * @param data Plaintext slice (not authenticated yet)
+ * @param size Size of the slice
+ */
+static void segment_sink(uint32_t offset, const uint8_t *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (data[i] != SEGMENT_PATTERN(offset + i)) {
+            segment_mismatches++;
+        }
+    }
+}
+
+/**
+ * @brief Print the outcome of a segmented reception
+ *
+ * @param length Plaintext size announced by Alice
+ * @param received Plaintext bytes received
+ * @param auth AUTH_OK if the whole message was received and its tag is valid
+ */
+static void segment_done(uint32_t length, uint32_t received, uint8_t auth) {
+    printf(
+        "ISO-TP received %u/%u bytes, auth %s, pattern mismatches %u\r\n",
+        (unsigned int) received,
+        (unsigned int) length,
+        auth == AUTH_OK ? "OK" : "FAILED",
+        (unsigned int) segment_mismatches
+    );
+    segment_mismatches = 0;
+}
+
+/**
+ * @brief Get the field layout of a message
+ *
+ * @param id Message identifier
+ * @return int32_t Index in field_layouts, -1 if the whole payload is used
+ */
+static int32_t find_field_layout(uint32_t id) {
+    for (uint32_t i = 0; i < FIELD_LAYOUTS; i++) {
+        if (field_layouts[i].id == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Print the cycles per decryption of the whole payload and of the decoded field only, per identifier
+ *
+ * The last authenticated frame of each identifier is decrypted again both
+ * ways (identifiers not received yet are skipped).
+ *
+ */
+static void field_benchmark() {
+    uint8_t plaintext[MAX_FRAME_SIZE];
+
+    printf("Decryption cycles @ %u Hz, %u runs\r\n", (unsigned int)SystemCoreClock, FIELD_BENCH_ROUNDS);
+    for (uint32_t i = 0; i < FIELD_LAYOUTS; i++) {
+        const FieldLayout *layout = &field_layouts[i];
+        size_t size = field_frame_sizes[i] - AUTH_TAG_SIZE - IV_SIZE;
+        uint8_t auth = AUTH_OK;
+
+        if (field_frame_sizes[i] == 0) {
+            continue;
+        }
+
+        uint32_t start_time = get_clock_cycles();
+        for (uint32_t j = 0; j < FIELD_BENCH_ROUNDS; j++) {
+            auth |= decrypt(layout->id, field_frames[i], plaintext, size);
+        }
+        uint32_t full = (get_clock_cycles() - start_time) / FIELD_BENCH_ROUNDS;
+
+        start_time = get_clock_cycles();
+        for (uint32_t j = 0; j < FIELD_BENCH_ROUNDS; j++) {
+            auth |= decrypt_field(layout->id, field_frames[i], plaintext, size, layout->first, layout->size);
+        }
+        uint32_t field = (get_clock_cycles() - start_time) / FIELD_BENCH_ROUNDS;
+
+        printf("0x%03X: %u bytes %u, bytes %u-%u %u (%d%%)%s\r\n",
+            (unsigned int)layout->id,
+            (unsigned int)size,
+            (unsigned int)full,
+            (unsigned int)layout->first,
+            (unsigned int)(layout->first + layout->size - 1),
+            (unsigned int)field,
+            (int)(((int32_t)field - (int32_t)full) * 100 / (int32_t)full),
+            auth == AUTH_OK ? "" : ", authentication failed");
+    }
+}
+
+/**
+ * @brief Print the histogram summaries and the per-ID statistics
+ *
+ */
+static void print_statistics() {
+    print_histograms();
+    idstats_print();
+    replay_print();
+    admission_print();
+    keytable_print();
+    timesync_print();
+}
+
+/**
+ * @brief Clear every cycle histogram
+ *
+ */
+static void reset_histograms() {
+    hist_reset(&hist_decrypt);
+    hist_reset(&hist_auth_fail);
+    hist_reset(&hist_rx);
+    hist_reset(&hist_delivery);
+    hist_reset(&hist_oneway);
+    hist_reset(&hist_mac_frame);
+    hist_reset(&hist_mac_window);
+    replay_reset();
+    admission_reset();
+}
+
+/**
+ * @brief Select the crypto engine
+ *
+ * @param engine Crypto engine (CryptoEngine)
+ */
+static void apply_crypto_engine(uint32_t engine) {
+    crypto_set_engine((CryptoEngine)engine);
+}
+
+/**
+ * @brief Select the header authentication mode
+ *
+ * @param mode Header authentication mode (HeaderAad)
+ */
+static void apply_header_aad(uint32_t mode) {
+    crypto_set_header_aad((HeaderAad)mode);
+}
+
+/**
+ * @brief Apply both verification budgets (refills the buckets)
+ *
+ * @param rate New value of the changed parameter (already stored in the configuration)
+ */
+static void apply_verify_rates(uint32_t rate) {
+    admission_set_rates(config.verify_id_rate, config.verify_total_rate);
+}
+
+/**
+ * @brief Switch the CPU clock profile
+ *
+ * @param profile Clock profile (ClockProfile)
+ */
+static void apply_clock(uint32_t profile) {
+    clock_set_profile((ClockProfile)profile);
+}
+
+/**
+ * @brief Decrypt one standard message (workload of the clock benchmark)
+ *
+ * The frame is zeroed, so the tag check fails after the same work as for a valid frame.
+ */
+static void clock_workload() {
+    uint8_t frame[ENCRYPTED_DATA_SIZE + AUTH_TAG_SIZE + IV_SIZE] = {0};
+    uint8_t plaintext[ENCRYPTED_DATA_SIZE];
+
+    decrypt(ID_ENGINE_CONTROLLER, frame, plaintext, ENCRYPTED_DATA_SIZE);
+}
+
+/**
+ * @brief Time the decryption of a standard message in every clock profile
+ *
+ */
+static void clock_bench() {
+    clock_benchmark("decrypt", clock_workload);
+}
+
+/**
+ * @brief Fill the data of a diagnostic identifier
  * 
- * @return uint32_t Time in microseconds
+ * @param did Data identifier
+ * @param data Buffer of DIAG_MAX_DATA_SIZE bytes
+ * @return size_t Amount of bytes written, 0 if the DID is not supported
  */
-static uint32_t get_usec_time() {
-    return ((float)get_clock_cycles() / ((float)SystemCoreClock/1000000.0f));
+static size_t read_did(uint16_t did, uint8_t *data) {
+    uint8_t *end = data;
+
+    switch (did)
+    {
+        case DID_CONFIGURATION:
+            end = diag_put_u32(end, SystemCoreClock);
+            *end++ = config.encryption | (config.debug << 1) | (config.internal_log << 2);
+            *end++ = config.encryption ? ENCRYPTED_DATA_SIZE : PLAIN_DATA_SIZE;
+            break;
+
+        case DID_COUNTERS:
+            end = diag_put_u32(end, hist_rx.count);
+            end = diag_put_u32(end, hist_decrypt.count);
+            end = diag_put_u32(end, hist_auth_fail.count);
+            break;
+
+        case DID_HISTOGRAM:
+            end = diag_put_hist(end, &hist_decrypt);
+            break;
+
+        case DID_HISTOGRAM + 1:
+            end = diag_put_hist(end, &hist_auth_fail);
+            break;
+
+        case DID_HISTOGRAM + 2:
+            end = diag_put_hist(end, &hist_rx);
+            break;
+
+        case DID_HISTOGRAM + 3:
+            end = diag_put_hist(end, &hist_mac_frame);
+            break;
+
+        case DID_HISTOGRAM + 4:
+            end = diag_put_hist(end, &hist_mac_window);
+            break;
+
+        case DID_HIGH_WATER:
+            end = diag_put_u32(end, fdcan_rx_high_water());
+            break;
+
+        default:
+            /* Per-ID statistics, one DID per table slot */
+            if (did >= DID_ID_STATS && did < DID_ID_STATS + idmap_count()) {
+                uint32_t id = idmap_id(did - DID_ID_STATS);
+                const IdStats *stats = idstats_get(id);
+                *end++ = (uint8_t)(id >> 8);
+                *end++ = (uint8_t)id;
+                end = diag_put_u32(end, stats->count);
+                end = diag_put_u32(end, stats->auth_ok);
+                end = diag_put_u32(end, stats->auth_fail);
+                end = diag_put_u32(end, stats->dlc_mismatch);
+                end = diag_put_u32(end, stats->count > 1 ? fdcan_timestamp_to_usec(stats->min_period) : 0);
+                end = diag_put_u32(end, fdcan_timestamp_to_usec(stats->max_period));
+                end = diag_put_u32(end, fdcan_timestamp_to_usec(stats->ewma_period >> IDSTATS_EWMA_SHIFT));
+                end = diag_put_u32(end, fdcan_timestamp_to_usec(stats->ewma_jitter >> IDSTATS_EWMA_SHIFT));
+            }
+            break;
+    }
+
+    return end - data;
 }
 
 /**
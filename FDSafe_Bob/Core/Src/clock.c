@@ -0,0 +1,108 @@
+/**
+ * @file clock.c
+ * @author Luan
+ * @brief CPU clock profiles with flash wait states and ART accelerator
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include "clock.h"
+#include "uart.h"
+
+
+/* Settings of a profile */
+typedef struct {
+	uint32_t source;		/* SYSCLK source */
+	uint32_t ahb_divider;
+	uint32_t voltage;		/* Regulator range */
+	uint32_t latency;		/* Flash wait states */
+} ProfileSettings;
+
+static const ProfileSettings settings[CLOCK_PROFILES] = {
+	[CLOCK_PROFILE_16MHZ] = {RCC_SYSCLKSOURCE_HSI, RCC_SYSCLK_DIV1, PWR_REGULATOR_VOLTAGE_SCALE1, FLASH_LATENCY_0},
+	[CLOCK_PROFILE_80MHZ] = {RCC_SYSCLKSOURCE_PLLCLK, RCC_SYSCLK_DIV2, PWR_REGULATOR_VOLTAGE_SCALE1_BOOST, FLASH_LATENCY_2},
+	[CLOCK_PROFILE_160MHZ] = {RCC_SYSCLKSOURCE_PLLCLK, RCC_SYSCLK_DIV1, PWR_REGULATOR_VOLTAGE_SCALE1_BOOST, FLASH_LATENCY_4},
+};
+
+/* Profile set at boot by SystemClock_Config() */
+static ClockProfile current = CLOCK_PROFILE_16MHZ;
+
+
+void clock_setup() {
+	__HAL_FLASH_INSTRUCTION_CACHE_ENABLE();
+	__HAL_FLASH_DATA_CACHE_ENABLE();
+}
+
+uint8_t clock_set_profile(ClockProfile profile) {
+	RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+
+	if (profile >= CLOCK_PROFILES) {
+		return 0;
+	}
+	const ProfileSettings *target = &settings[profile];
+
+	RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK | RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+	RCC_ClkInitStruct.SYSCLKSource = target->source;
+	RCC_ClkInitStruct.AHBCLKDivider = target->ahb_divider;
+	RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV1;
+	RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV1;
+
+	/* Boost mode before going over 150 MHz, normal mode only after coming back to HSI */
+	if (target->voltage == PWR_REGULATOR_VOLTAGE_SCALE1_BOOST) {
+		HAL_PWREx_ControlVoltageScaling(PWR_REGULATOR_VOLTAGE_SCALE1_BOOST);
+	}
+
+	/* Also reprograms SysTick for the new HCLK */
+	if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, target->latency) != HAL_OK) {
+		printf("Clock profile error\r\n");
+		Error_Handler();
+	}
+
+	if (target->voltage == PWR_REGULATOR_VOLTAGE_SCALE1) {
+		HAL_PWREx_ControlVoltageScaling(PWR_REGULATOR_VOLTAGE_SCALE1);
+	}
+
+	if (target->latency == FLASH_LATENCY_0) {
+		__HAL_FLASH_PREFETCH_BUFFER_DISABLE();
+	}
+	else {
+		__HAL_FLASH_PREFETCH_BUFFER_ENABLE();
+	}
+
+	current = profile;
+	return 1;
+}
+
+ClockProfile clock_profile() {
+	return current;
+}
+
+/**
+ * One untimed run first, so the caches hold the workload in every profile
+ */
+void clock_benchmark(const char *name, ClockWorkload work) {
+	ClockProfile restore = current;
+
+	printf("%s per run, %u runs per profile\r\n", name, CLOCK_BENCH_ROUNDS);
+	for (ClockProfile profile = 0; profile < CLOCK_PROFILES; profile++) {
+		clock_set_profile(profile);
+		work();
+
+		uint32_t start_time = DWT->CYCCNT;
+		for (uint32_t i = 0; i < CLOCK_BENCH_ROUNDS; i++) {
+			work();
+		}
+		uint32_t cycles = (DWT->CYCCNT - start_time) / CLOCK_BENCH_ROUNDS;
+
+		printf("%u Hz, %u wait states: %u cycles, %u ns\r\n",
+			(unsigned int)SystemCoreClock,
+			(unsigned int)settings[profile].latency,
+			(unsigned int)cycles,
+			(unsigned int)((uint64_t)cycles * 1000000000U / SystemCoreClock));
+	}
+	clock_set_profile(restore);
+}
@@ -11,25 +11,99 @@
 
 
 #include "crypto.h"
+#include "keytable.h"
 #include "cmox_crypto.h"
 #include "uart.h"
+#include "ccmram.h"
 #include <string.h>
+#include "ram.h"
 
 
-/* Symmetric key */
+/* Cipher block size */
+#define BLOCK_SIZE 16
+
+
+/* Header of a frame absorbed under a key: GHASH state of the handle after the block */
+typedef struct {
+  uint8_t valid;
+  uint8_t epoch;
+  uint8_t frame_size;
+  uint32_t id;
+  uint32_t state;
+  cmox_gcm_poly_t partial_auth;
+} HeaderPrefix;
+
+/* Tag correction of the verification over additional data, per identifier */
+typedef struct {
+  uint8_t valid;
+  uint8_t epoch;
+  uint8_t plain_size;
+  uint8_t header;
+  uint32_t id;
+  uint8_t delta[AUTH_TAG_SIZE];
+} FieldDelta;
+
+
+static void running_tag(uint8_t *tag);
+static void derive_mac_key(const uint8_t *slot_key, uint8_t *mac_key);
+static cmox_cipher_retval_t bind_header(GcmHandle *ctx, uint32_t id, uint8_t epoch, size_t frame_size);
+static cmox_cipher_retval_t bind_stream_header(cmox_cipher_handle_t *ctx, uint32_t id, uint32_t length);
+static uint8_t field_key(uint32_t id, uint8_t epoch);
+static const uint8_t *field_delta(uint32_t id, uint8_t epoch, size_t plain_size);
+CCMRAM_CODE static void gf_mult(const uint8_t *x, const uint8_t *y, uint8_t *z);
+
+
+/* Initial symmetric key (epoch 0) */
 const uint8_t key[] =
 {
   0x22, 0x4E, 0x61, 0x6D, 0xE1, 0x72, 0x69, 0xEB, 0x21, 0x20, 0x4E, 0x61, 0x69, 0x20, 0x68, 0x69,
   0x72, 0x75, 0x76, 0x61, 0x6C, 0x79, 0xEB, 0x20, 0x56, 0x61, 0x6C, 0x69, 0x6D, 0x61, 0x72, 0x22
 };
 
-/* Buffer for the initialization vector */
-uint8_t iv[IV_SIZE];
+/* Key-encryption key, only used to unwrap the keys distributed over the bus */
+static const uint8_t kek[] =
+{
+  0x41, 0x20, 0x45, 0x6C, 0x62, 0x65, 0x72, 0x65, 0x74, 0x68, 0x20, 0x47, 0x69, 0x6C, 0x74, 0x68,
+  0x6F, 0x6E, 0x69, 0x65, 0x6C, 0x2C, 0x20, 0x6F, 0x20, 0x6D, 0x65, 0x6E, 0x65, 0x6C, 0x20, 0x70
+};
+
+/* Default initial value of the key wrap (RFC 3394) */
+static const uint8_t wrap_iv[] = {0xA6, 0xA6, 0xA6, 0xA6, 0xA6, 0xA6, 0xA6, 0xA6};
+
+/* Label of the windowed MAC key, derived from the key slot (not shared with the AEAD) */
+static const uint8_t mac_label[] = "FDSafe MAC window";
 
 /* Crypto lib */
 cmox_cipher_retval_t retval;
 cmox_init_arg_t init_target = {CMOX_INIT_TARGET_AUTO, NULL};
 
+/* Selected engine */
+static CryptoEngine crypto_engine = CRYPTO_ENGINE_FAST;
+
+/* Header authentication, absorbed headers (direct-mapped by identifier) */
+static HeaderAad header_aad = HEADER_AAD_CACHED;
+static HeaderPrefix header_cache[HEADER_CACHE_SIZE] RAM_CRYPTO;
+
+/* Block cipher of the selected fields, keyed with the last key used, and its GHASH key */
+static struct {
+  const uint8_t *key;       /* Key of the handle, NULL if not keyed */
+  uint8_t hash_key[BLOCK_SIZE];
+  cmox_ecb_handle_t ecb;
+} field_cipher;
+static cmox_ecb_handle_t field_ecb;
+static FieldDelta field_cache[HEADER_CACHE_SIZE] RAM_CRYPTO;
+
+/* Context of the message being decrypted */
+static GcmHandle work_ctx CCMRAM_DATA;
+
+/* Windowed MAC context (the handles hold no pointers to themselves, so they can be copied) */
+static cmox_cmac_handle_t cmac_ctx RAM_CRYPTO;
+static cmox_mac_handle_t *mac_ctx;
+
+/* Streaming decryption context (segmented messages), NULL if the key of the message is unknown */
+static GcmHandle gcm_ctx RAM_CRYPTO;
+static cmox_cipher_handle_t *stream_ctx;
+
 
 void crypto_setup() {
   printf("Crypto setup...");
@@ -39,30 +113,475 @@ void crypto_setup() {
 		Error_Handler();
 	}
   printf(" OK\r\n");
+
+  /* Alice is the only sender on the bus: her key covers every identifier */
+  keytable_setup();
+  keytable_map(keytable_add_sender(key), 0, KEYTABLE_ID_COUNT - 1);
+
+  crypto_set_engine(CRYPTO_ENGINE_FAST);
 }
 
-uint8_t decrypt(uint8_t *ciphertext, uint8_t *plaintext, size_t exp_plain_size) {
+void crypto_set_engine(CryptoEngine engine) {
+  /* The contexts are engine specific, they are expanded again on their next use */
+  crypto_engine = engine;
+  keytable_set_engine(engine);
+  memset(header_cache, 0, sizeof(header_cache));
+}
 
-  size_t plain_size;
+void crypto_set_header_aad(HeaderAad mode) {
+  header_aad = mode;
+}
+
+uint8_t crypto_unwrap_key(const uint8_t *wrapped, uint8_t *epoch, uint8_t *nonce, uint8_t *new_key) {
+  uint8_t plaintext[KEY_WRAP_HEADER_SIZE + KEY_SIZE];
+
+  retval = cmox_cipher_decrypt(CMOX_AESFAST_KEYWRAP_DEC_ALGO,
+                              wrapped, KEY_WRAP_SIZE,
+                              kek, sizeof(kek),
+                              wrap_iv, sizeof(wrap_iv),
+                              plaintext, NULL);
+  if (retval == CMOX_CIPHER_AUTH_SUCCESS) {
+    *epoch = plaintext[0];
+    memcpy(nonce, &plaintext[KEY_WRAP_NONCE_OFFSET], KEY_NONCE_SIZE);
+    memcpy(new_key, &plaintext[KEY_WRAP_HEADER_SIZE], KEY_SIZE);
+  }
+  memset(plaintext, 0, sizeof(plaintext));
+
+  return retval == CMOX_CIPHER_AUTH_SUCCESS ? AUTH_OK : AUTH_ERROR;
+}
+
+void crypto_install_key(uint32_t id, uint8_t epoch, const uint8_t *new_key) {
+  keytable_install(id, epoch, new_key);
+
+  /* The epoch wraps around: headers absorbed under an old key of the same epoch are dropped */
+  memset(header_cache, 0, sizeof(header_cache));
+  memset(field_cache, 0, sizeof(field_cache));
+  field_cipher.key = NULL;
+}
+
+void crypto_key_proof(uint32_t id, uint8_t epoch, const uint8_t *next_nonce, uint8_t *proof) {
+  uint8_t plaintext[KEY_PROOF_SIZE - KEY_WRAP_OVERHEAD] = {0};
+  const uint8_t *slot_key = keytable_key(id, epoch);
+
+  memcpy(plaintext, next_nonce, KEY_NONCE_SIZE);
+
+  retval = slot_key == NULL ? CMOX_CIPHER_ERR_BAD_PARAMETER
+    : cmox_cipher_encrypt(CMOX_AESFAST_KEYWRAP_ENC_ALGO,
+                          plaintext, sizeof(plaintext),
+                          slot_key, KEY_SIZE,
+                          wrap_iv, sizeof(wrap_iv),
+                          proof, NULL);
+
+  if (retval != CMOX_CIPHER_SUCCESS)
+  {
+    printf("Key wrap error\r\n");
+    Error_Handler();
+  }
+}
+
+CCMRAM_CODE uint8_t decrypt(uint32_t id, uint8_t *ciphertext, uint8_t *plaintext, size_t exp_plain_size) {
+  uint8_t iv[IV_SIZE];
+
+  TRACE(TRACE_DECRYPT_START, exp_plain_size);
   
-  /* Recover IV from the message */
-  memcpy(&iv, &ciphertext[exp_plain_size + AUTH_TAG_SIZE], IV_SIZE);
+  /* Recover IV from the message, the identifier selects the sender and the epoch its key */
+  memcpy(iv, &ciphertext[exp_plain_size + AUTH_TAG_SIZE], IV_SIZE);
+  cmox_cipher_handle_t *ctx = keytable_context(id, iv[0], &work_ctx);
   
-  /* Decryption */
-  retval = cmox_aead_decrypt(CMOX_AES_GCM_DEC_ALGO,                               /* Use AES GCM algorithm */
-                            ciphertext, exp_plain_size + AUTH_TAG_SIZE,           /* Ciphertext + tag to decrypt and verify */
-                            AUTH_TAG_SIZE,                                        /* Authentication tag size */
-                            key, sizeof(key),                                     /* AES key to use */
-                            iv, IV_SIZE,                                          /* Initialization vector */
-                            NULL, 0,                                              /* Additional authenticated data */
-                            plaintext, &plain_size);                              /* Data buffer to receive generated plaintext */
+  /* Decryption (only the IV is set per message, the key schedule and GHASH table are cached) */
+  retval = CMOX_CIPHER_AUTH_FAIL;
+  if (ctx != NULL) {
+    if (cmox_cipher_setIV(ctx, iv, IV_SIZE) == CMOX_CIPHER_SUCCESS
+        && bind_header(&work_ctx, id, iv[0], exp_plain_size + AUTH_TAG_SIZE + IV_SIZE) == CMOX_CIPHER_SUCCESS
+        && cmox_cipher_append(ctx, ciphertext, exp_plain_size, plaintext, NULL) == CMOX_CIPHER_SUCCESS)
+    {
+      retval = cmox_cipher_verifyTag(ctx, &ciphertext[exp_plain_size], NULL);
+    }
+  }
   
   if (retval != CMOX_CIPHER_AUTH_SUCCESS)
   {
-    printf("Invalid message: %X\r\n", (int)retval);
+    TRACE(TRACE_DECRYPT_END, AUTH_ERROR);
     return AUTH_ERROR;
   }
+
+  /* First authenticated message under the new key: the sender switched, the old key is retired */
+  keytable_promote(id, iv[0]);
   
+  TRACE(TRACE_DECRYPT_END, AUTH_OK);
+  return AUTH_OK;
+
+}
+
+CCMRAM_CODE uint8_t decrypt_field(uint32_t id, const uint8_t *ciphertext, uint8_t *plaintext, size_t exp_plain_size, size_t first, size_t size) {
+  uint8_t iv[IV_SIZE];
+  uint8_t tag[AUTH_TAG_SIZE];
+  uint8_t counter[BLOCK_SIZE];
+  uint8_t keystream[BLOCK_SIZE];
+
+  TRACE(TRACE_DECRYPT_START, exp_plain_size);
+
+  memcpy(iv, &ciphertext[exp_plain_size + AUTH_TAG_SIZE], IV_SIZE);
+  cmox_cipher_handle_t *ctx = keytable_context(id, iv[0], &work_ctx);
+  const uint8_t *delta = ctx == NULL || !field_key(id, iv[0]) ? NULL : field_delta(id, iv[0], exp_plain_size);
+
+  /* Verification only: the ciphertext is absorbed as additional data, GHASH runs without the keystream */
+  retval = CMOX_CIPHER_AUTH_FAIL;
+  if (delta != NULL && size > 0 && first + size <= exp_plain_size) {
+    for (uint8_t i = 0; i < AUTH_TAG_SIZE; i++) {
+      tag[i] = ciphertext[exp_plain_size + i] ^ delta[i];
+    }
+    if (cmox_cipher_setIV(ctx, iv, IV_SIZE) == CMOX_CIPHER_SUCCESS
+        && bind_header(&work_ctx, id, iv[0], exp_plain_size + AUTH_TAG_SIZE + IV_SIZE) == CMOX_CIPHER_SUCCESS
+        && cmox_cipher_appendAD(ctx, ciphertext, exp_plain_size) == CMOX_CIPHER_SUCCESS)
+    {
+      retval = cmox_cipher_verifyTag(ctx, tag, NULL);
+    }
+  }
+
+  if (retval != CMOX_CIPHER_AUTH_SUCCESS)
+  {
+    TRACE(TRACE_DECRYPT_END, AUTH_ERROR);
+    return AUTH_ERROR;
+  }
+
+  /* Keystream of the blocks covering the field only (payload block i uses the counter 2 + i) */
+  memcpy(counter, iv, IV_SIZE);
+  for (size_t block = first / BLOCK_SIZE; block * BLOCK_SIZE < first + size; block++) {
+    uint32_t count = 2 + block;
+    counter[12] = (uint8_t)(count >> 24);
+    counter[13] = (uint8_t)(count >> 16);
+    counter[14] = (uint8_t)(count >> 8);
+    counter[15] = (uint8_t)count;
+
+    field_ecb = field_cipher.ecb;
+    if (cmox_cipher_append(&field_ecb.super, counter, BLOCK_SIZE, keystream, NULL) != CMOX_CIPHER_SUCCESS)
+    {
+      printf("Decryption error\r\n");
+      Error_Handler();
+    }
+
+    for (size_t i = 0; i < BLOCK_SIZE; i++) {
+      size_t pos = block * BLOCK_SIZE + i;
+      if (pos >= first && pos < first + size) {
+        plaintext[pos] = ciphertext[pos] ^ keystream[i];
+      }
+    }
+  }
+
+  keytable_promote(id, iv[0]);
+
+  TRACE(TRACE_DECRYPT_END, AUTH_OK);
   return AUTH_OK;
+}
+
+uint8_t mac_window_start(uint32_t id, uint8_t epoch) {
+  const uint8_t *slot_key = keytable_key(id, epoch);
+  uint8_t mac_key[KEY_SIZE];
+
+  if (slot_key == NULL) {
+    return AUTH_ERROR;
+  }
+  derive_mac_key(slot_key, mac_key);
+
+  mac_ctx = cmox_cmac_construct(&cmac_ctx, CMOX_CMAC_AESFAST);
+  if (mac_ctx == NULL
+      || cmox_mac_init(mac_ctx) != CMOX_MAC_SUCCESS
+      || cmox_mac_setTagLen(mac_ctx, MAC_TAG_SIZE) != CMOX_MAC_SUCCESS
+      || cmox_mac_setKey(mac_ctx, mac_key, sizeof(mac_key)) != CMOX_MAC_SUCCESS)
+  {
+    printf("MAC setup error\r\n");
+    Error_Handler();
+  }
+  memset(mac_key, 0, sizeof(mac_key));
+  return AUTH_OK;
+}
+
+uint8_t mac_window_append(const uint8_t *data, size_t size, const uint8_t *fragment) {
+  uint8_t tag[MAC_TAG_SIZE];
+  uint8_t diff = 0;
+
+  if (cmox_mac_append(mac_ctx, data, size) != CMOX_MAC_SUCCESS)
+  {
+    return AUTH_ERROR;
+  }
+  running_tag(tag);
+
+  /* Compare every byte, whatever the first mismatch */
+  for (uint8_t i = 0; i < MAC_FRAGMENT_SIZE; i++) {
+    diff |= tag[i] ^ fragment[i];
+  }
+  return diff ? AUTH_ERROR : AUTH_OK;
+}
+
+uint8_t mac_window_finish(const uint8_t *tag) {
+  cmox_mac_retval_t mac_retval = cmox_mac_verifyTag(mac_ctx, tag, NULL);
+  cmox_mac_cleanup(mac_ctx);
+  return mac_retval == CMOX_MAC_AUTH_SUCCESS ? AUTH_OK : AUTH_ERROR;
+}
+
+void stream_decrypt_start(uint32_t id, uint32_t length, const uint8_t *iv) {
+  stream_ctx = keytable_context(id, iv[0], &gcm_ctx);
+  if (stream_ctx != NULL
+      && (cmox_cipher_setIV(stream_ctx, iv, IV_SIZE) != CMOX_CIPHER_SUCCESS
+          || bind_stream_header(stream_ctx, id, length) != CMOX_CIPHER_SUCCESS))
+  {
+    printf("Decryption setup error\r\n");
+    Error_Handler();
+  }
+}
+
+void stream_decrypt_append(const uint8_t *ciphertext, size_t size, uint8_t *plaintext) {
+  /* Unknown key: the output is garbage, the message fails at the tag */
+  if (stream_ctx == NULL) {
+    memset(plaintext, 0, size);
+    return;
+  }
+  if (cmox_cipher_append(stream_ctx, ciphertext, size, plaintext, NULL) != CMOX_CIPHER_SUCCESS)
+  {
+    printf("Decryption error\r\n");
+    Error_Handler();
+  }
+}
+
+uint8_t stream_decrypt_finish(const uint8_t *tag) {
+  if (stream_ctx == NULL) {
+    return AUTH_ERROR;
+  }
+  cmox_cipher_retval_t tag_retval = cmox_cipher_verifyTag(stream_ctx, tag, NULL);
+  cmox_cipher_cleanup(stream_ctx);
+  return tag_retval == CMOX_CIPHER_AUTH_SUCCESS ? AUTH_OK : AUTH_ERROR;
+}
+
+/**
+ * @brief Derive the windowed MAC key from a key slot
+ * 
+ * NIST SP 800-108 KDF in counter mode with CMAC as the PRF: block i is the
+ * CMAC of i, the label, a zero byte and the key length in bits. A new key
+ * slot gives a new MAC key, the AEAD key itself is never used by CMAC.
+ * 
+ * @param slot_key Key of the slot (KEY_SIZE bytes)
+ * @param mac_key Buffer to store the MAC key (KEY_SIZE bytes)
+ */
+static void derive_mac_key(const uint8_t *slot_key, uint8_t *mac_key) {
+  /* The label is stored with its terminating zero, the separator */
+  uint8_t input[1 + sizeof(mac_label) + 2];
+  size_t tag_size;
+
+  memcpy(&input[1], mac_label, sizeof(mac_label));
+  input[1 + sizeof(mac_label)] = (uint8_t)((KEY_SIZE * 8) >> 8);
+  input[2 + sizeof(mac_label)] = (uint8_t)((KEY_SIZE * 8) & 0xFF);
+  for (uint8_t i = 0; i < KEY_SIZE / MAC_TAG_SIZE; i++) {
+    input[0] = i + 1;
+    if (cmox_mac_compute(CMOX_CMAC_AESFAST_ALGO, input, sizeof(input), slot_key, KEY_SIZE, NULL, 0,
+                         &mac_key[i * MAC_TAG_SIZE], MAC_TAG_SIZE, &tag_size) != CMOX_MAC_SUCCESS)
+    {
+      printf("MAC key derivation error\r\n");
+      Error_Handler();
+    }
+  }
+}
+
+/**
+ * @brief Get the tag of everything appended so far, without closing the window
+ * 
+ * @param tag Buffer of MAC_TAG_SIZE bytes
+ */
+static void running_tag(uint8_t *tag) {
+  cmox_cmac_handle_t running = cmac_ctx;
+  if (cmox_mac_generateTag(&running.super, tag, NULL) != CMOX_MAC_SUCCESS)
+  {
+    printf("MAC error\r\n");
+    Error_Handler();
+  }
+}
+
+/**
+ * @brief Authenticate the header of a frame (handle with its IV set, before the payload)
+ * 
+ * GHASH over the additional data does not depend on the IV, only on the key:
+ * the state after the header block is kept per identifier and restored into
+ * the handle of the next frame instead of absorbing the block again.
+ * 
+ * @param ctx Handle of the message
+ * @param id Identifier of the message
+ * @param epoch Epoch of the key of the handle
+ * @param frame_size Size of the frame (payload, tag and IV)
+ * @return cmox_cipher_retval_t Cipher return value
+ */
+CCMRAM_CODE static cmox_cipher_retval_t bind_header(GcmHandle *ctx, uint32_t id, uint8_t epoch, size_t frame_size) {
+  cmox_gcm_common_t *common = crypto_engine == CRYPTO_ENGINE_FAST ? &ctx->fast.common : &ctx->small.common;
+  HeaderPrefix *prefix = &header_cache[id % HEADER_CACHE_SIZE];
+  uint8_t aad[HEADER_AAD_SIZE] = {0};
+
+  if (header_aad == HEADER_AAD_OFF) {
+    return CMOX_CIPHER_SUCCESS;
+  }
+
+  if (header_aad == HEADER_AAD_CACHED && prefix->valid && prefix->id == id
+      && prefix->epoch == epoch && prefix->frame_size == frame_size)
+  {
+    memcpy(common->partialAuth, prefix->partial_auth, sizeof(cmox_gcm_poly_t));
+    common->AdLen = HEADER_AAD_SIZE;
+    ctx->super.internalState = prefix->state;
+    return CMOX_CIPHER_SUCCESS;
+  }
+
+  aad[0] = (uint8_t)(id >> 24);
+  aad[1] = (uint8_t)(id >> 16);
+  aad[2] = (uint8_t)(id >> 8);
+  aad[3] = (uint8_t)id;
+  aad[4] = (uint8_t)frame_size;
+  cmox_cipher_retval_t result = cmox_cipher_appendAD(&ctx->super, aad, HEADER_AAD_SIZE);
+
+  if (result == CMOX_CIPHER_SUCCESS && header_aad == HEADER_AAD_CACHED) {
+    prefix->valid = 1;
+    prefix->id = id;
+    prefix->epoch = epoch;
+    prefix->frame_size = (uint8_t)frame_size;
+    prefix->state = ctx->super.internalState;
+    memcpy(prefix->partial_auth, common->partialAuth, sizeof(cmox_gcm_poly_t));
+  }
+  return result;
+}
+
+/**
+ * @brief Absorb the header of a segmented message as additional data
+ * 
+ * Identifier (4, big-endian) and message length (4, big-endian) in one
+ * zero-padded block, absorbed once per message (not cached).
+ * 
+ * @param ctx Cipher handle with the IV set
+ * @param id Identifier of the segments
+ * @param length Plaintext length of the message
+ * @return cmox_cipher_retval_t Cipher return value
+ */
+static cmox_cipher_retval_t bind_stream_header(cmox_cipher_handle_t *ctx, uint32_t id, uint32_t length) {
+  uint8_t aad[HEADER_AAD_SIZE] = {0};
+
+  if (header_aad == HEADER_AAD_OFF) {
+    return CMOX_CIPHER_SUCCESS;
+  }
+
+  aad[0] = (uint8_t)(id >> 24);
+  aad[1] = (uint8_t)(id >> 16);
+  aad[2] = (uint8_t)(id >> 8);
+  aad[3] = (uint8_t)id;
+  aad[4] = (uint8_t)(length >> 24);
+  aad[5] = (uint8_t)(length >> 16);
+  aad[6] = (uint8_t)(length >> 8);
+  aad[7] = (uint8_t)length;
+  return cmox_cipher_appendAD(ctx, aad, HEADER_AAD_SIZE);
+}
+
+/**
+ * @brief Key the block cipher of the selected fields with the key of a message
+ * 
+ * @param id Identifier of the message
+ * @param epoch Key epoch of the message
+ * @return uint8_t 1 if the key is known, 0 otherwise
+ */
+static uint8_t field_key(uint32_t id, uint8_t epoch) {
+  const uint8_t zeros[BLOCK_SIZE] = {0};
+  const uint8_t *key_bytes = keytable_key(id, epoch);
 
+  if (key_bytes == NULL) {
+    return 0;
+  }
+  if (key_bytes == field_cipher.key) {
+    return 1;
+  }
+
+  cmox_cipher_handle_t *ctx = cmox_ecb_construct(&field_cipher.ecb, CMOX_AESFAST_ECB_ENC);
+  if (ctx == NULL
+      || cmox_cipher_init(ctx) != CMOX_CIPHER_SUCCESS
+      || cmox_cipher_setKey(ctx, key_bytes, KEY_SIZE) != CMOX_CIPHER_SUCCESS)
+  {
+    printf("Decryption setup error\r\n");
+    Error_Handler();
+  }
+
+  /* The GHASH key is the encryption of the zero block */
+  field_ecb = field_cipher.ecb;
+  if (cmox_cipher_append(&field_ecb.super, zeros, BLOCK_SIZE, field_cipher.hash_key, NULL) != CMOX_CIPHER_SUCCESS)
+  {
+    printf("Decryption setup error\r\n");
+    Error_Handler();
+  }
+
+  field_cipher.key = key_bytes;
+  return 1;
+}
+
+/**
+ * @brief Get the tag correction of a verification over additional data
+ * 
+ * The GHASH blocks of the header and ciphertext are the same whether the
+ * ciphertext is absorbed as payload or as additional data, only the final
+ * length block differs. Both tags then differ by (L xor L') * H, which only
+ * depends on the key and the sizes, so it is computed once per identifier.
+ * 
+ * @param id Identifier of the message
+ * @param epoch Key epoch of the message (its key must be in the field cipher)
+ * @param plain_size Size of the ciphertext
+ * @return const uint8_t* Correction to apply to the received tag (AUTH_TAG_SIZE bytes)
+ */
+static const uint8_t *field_delta(uint32_t id, uint8_t epoch, size_t plain_size) {
+  FieldDelta *entry = &field_cache[id % HEADER_CACHE_SIZE];
+  uint8_t header = header_aad != HEADER_AAD_OFF;
+  uint8_t lengths[BLOCK_SIZE];
+
+  if (entry->valid && entry->id == id && entry->epoch == epoch
+      && entry->plain_size == plain_size && entry->header == header)
+  {
+    return entry->delta;
+  }
+
+  /* L = len(A) || len(C), L' = len(A || C) || 0, in bits */
+  uint64_t ad_bits = header ? HEADER_AAD_SIZE * 8 : 0;
+  uint64_t payload_bits = plain_size * 8;
+  uint64_t diff = ad_bits ^ (ad_bits + payload_bits);
+  for (uint8_t i = 0; i < 8; i++) {
+    lengths[i] = (uint8_t)(diff >> (56 - 8 * i));
+    lengths[8 + i] = (uint8_t)(payload_bits >> (56 - 8 * i));
+  }
+  gf_mult(lengths, field_cipher.hash_key, entry->delta);
+
+  entry->valid = 1;
+  entry->id = id;
+  entry->epoch = epoch;
+  entry->plain_size = (uint8_t)plain_size;
+  entry->header = header;
+  return entry->delta;
+}
+
+/**
+ * @brief Multiply two elements of GF(2^128) as defined for GHASH (bitwise, only used on cache misses)
+ * 
+ * @param x First factor (16 bytes)
+ * @param y Second factor (16 bytes)
+ * @param z Buffer to store the product (16 bytes)
+ */
+static void gf_mult(const uint8_t *x, const uint8_t *y, uint8_t *z) {
+  uint8_t v[BLOCK_SIZE];
+
+  memcpy(v, y, BLOCK_SIZE);
+  memset(z, 0, BLOCK_SIZE);
+
+  for (uint8_t i = 0; i < 128; i++) {
+    if (x[i / 8] & (0x80 >> (i % 8))) {
+      for (uint8_t j = 0; j < BLOCK_SIZE; j++) {
+        z[j] ^= v[j];
+      }
+    }
+
+    uint8_t carry = v[BLOCK_SIZE - 1] & 1;
+    for (uint8_t j = BLOCK_SIZE - 1; j > 0; j--) {
+      v[j] = (v[j] >> 1) | (v[j - 1] << 7);
+    }
+    v[0] >>= 1;
+    if (carry) {
+      v[0] ^= 0xE1;
+    }
+  }
 }
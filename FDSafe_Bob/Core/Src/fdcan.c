@@ -10,14 +10,43 @@
  */
 
 
+#include <string.h>
 #include "fdcan.h"
 #include "main.h"
 #include "uart.h"
+#include "ccmram.h"
+
+
+/* Timestamp counter state */
+static volatile uint32_t timestamp_wraps = 0;
+static uint32_t timestamp_tick_ns = 0;
+
+/* Highest RX FIFO fill level seen */
+static uint32_t rx_high_water = 0;
+
+
+/* Valid CAN FD payload sizes */
+static const uint8_t DLCtoBytes[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+
+
+/* Static functions prototypes */
+static uint32_t compute_tick_ns();
+static void build_header(FDCAN_TxHeaderTypeDef *TxHeader, uint32_t id, size_t size);
 
 
 void fdcan_setup() {
 	HAL_StatusTypeDef ret;
 
+	/* Hardware timestamps of received messages */
+	if (HAL_FDCAN_ConfigTimestampCounter(&hfdcan1, FDCAN_TIMESTAMP_PRESCALER) != HAL_OK
+			|| HAL_FDCAN_EnableTimestampCounter(&hfdcan1, FDCAN_TIMESTAMP_INTERNAL) != HAL_OK
+			|| HAL_FDCAN_ActivateNotification(&hfdcan1, FDCAN_IT_TIMESTAMP_WRAPAROUND, 0) != HAL_OK)
+	{
+		printf("FDCAN timestamp setup failed\r\n");
+		Error_Handler();
+	}
+	timestamp_tick_ns = compute_tick_ns();
+
 	ret = HAL_FDCAN_Start(&hfdcan1);
     if (ret != HAL_OK) {
 		printf("FDCAN setup failed\r\n");
@@ -53,7 +82,7 @@ void fdcan_activate_rx_notification() {
 	}
 }
 
-void fdcan_rx_callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs) {
+CCMRAM_CODE void fdcan_rx_callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs) {
     
 	if ((RxFifo0ITs & FDCAN_IT_RX_FIFO0_NEW_MESSAGE) != RESET)
 	{
@@ -61,15 +90,184 @@ void fdcan_rx_callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs) {
 	}
 }
 
+void fdcan_timestamp_wrap_callback(FDCAN_HandleTypeDef *hfdcan) {
+	timestamp_wraps++;
+}
+
+uint32_t fdcan_timestamp_extend(uint32_t timestamp) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	uint32_t wraps = timestamp_wraps;
+	uint32_t now = HAL_FDCAN_GetTimestampCounter(&hfdcan1);
+
+	/* Wrap-around already happened but its interrupt is still pending */
+	if (__HAL_FDCAN_GET_FLAG(&hfdcan1, FDCAN_FLAG_TIMESTAMP_WRAPAROUND)) {
+		wraps++;
+		now = HAL_FDCAN_GetTimestampCounter(&hfdcan1);
+	}
+
+	__set_PRIMASK(primask);
+
+	/* Message was stamped before the last wrap-around */
+	if (timestamp > now) {
+		wraps--;
+	}
+
+	return (wraps << 16) | (timestamp & 0xFFFF);
+}
+
+uint32_t fdcan_timestamp_now() {
+	return fdcan_timestamp_extend(HAL_FDCAN_GetTimestampCounter(&hfdcan1));
+}
+
+uint32_t fdcan_timestamp_to_usec(uint32_t ticks) {
+	return (uint32_t)(((uint64_t)ticks * timestamp_tick_ns) / 1000);
+}
+
 uint32_t fdcan_available() {
-    return HAL_FDCAN_GetRxFifoFillLevel(&hfdcan1, FDCAN_RX_FIFO0);
+    uint32_t level = HAL_FDCAN_GetRxFifoFillLevel(&hfdcan1, FDCAN_RX_FIFO0);
+    if (level > rx_high_water) {
+        rx_high_water = level;
+    }
+    return level;
 }
 
-void fdcan_read(FDCAN_RxHeaderTypeDef *RxHeader, uint8_t *RxData) {
+uint32_t fdcan_rx_high_water() {
+    return rx_high_water;
+}
+
+CCMRAM_CODE void fdcan_read(FDCAN_RxHeaderTypeDef *RxHeader, uint8_t *RxData) {
     if (HAL_FDCAN_GetRxMessage(&hfdcan1, FDCAN_RX_FIFO0, RxHeader, RxData)
             != HAL_OK)
     {
 		printf("FDCAN read failed\r\n");
         Error_Handler();
     }
-}
\ No newline at end of file
+    TRACE(TRACE_RX_DEQUEUE, RxHeader->Identifier);
+}
+
+void fdcan_send(uint32_t id, uint8_t *data, size_t size) {
+	HAL_StatusTypeDef ret;
+	FDCAN_TxHeaderTypeDef TxHeader;
+
+	/* Sizes between two valid payload sizes are padded (build_header only maps valid sizes) */
+	uint8_t padded[64];
+	size_t frame_size = fdcan_frame_size(size);
+	if (size > frame_size) {
+		printf("FDCAN payload too large: %u\r\n", (unsigned int)size);
+		Error_Handler();
+	}
+	if (frame_size != size) {
+		memcpy(padded, data, size);
+		memset(&padded[size], 0xFF, frame_size - size);
+		data = padded;
+	}
+
+    build_header(&TxHeader, id, frame_size);
+	ret = HAL_FDCAN_AddMessageToTxFifoQ(&hfdcan1, &TxHeader, data);
+	
+	if (ret != HAL_OK) {
+		printf("FDCAN send error: %d\r\n", (int)ret);
+        Error_Handler();
+    }
+}
+
+/**
+ * @brief Compute the duration of a timestamp tick from the nominal bit timing
+ * 
+ * @return uint32_t Tick duration in nanoseconds
+ */
+static uint32_t compute_tick_ns() {
+	uint32_t divider = hfdcan1.Init.ClockDivider ? 2 * hfdcan1.Init.ClockDivider : 1;
+	uint32_t kernel_clock = HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_FDCAN) / divider;
+	uint32_t bit_quanta = 1 + hfdcan1.Init.NominalTimeSeg1 + hfdcan1.Init.NominalTimeSeg2;
+	uint64_t bit_ns = (uint64_t)bit_quanta * hfdcan1.Init.NominalPrescaler * 1000000000U / kernel_clock;
+
+	return (uint32_t)(bit_ns * FDCAN_TIMESTAMP_BITS_PER_TICK);
+}
+
+/**
+ * @brief Build message header struct
+ * 
+ * @param TxHeader Header struct
+ * @param id Identifier of the message
+ * @param size Size of the payload
+ */
+static void build_header(FDCAN_TxHeaderTypeDef *TxHeader, uint32_t id, size_t size) {
+	TxHeader->Identifier = id;
+	TxHeader->IdType = FDCAN_STANDARD_ID;
+	TxHeader->TxFrameType = FDCAN_FRAME_FD_NO_BRS;
+	TxHeader->ErrorStateIndicator = FDCAN_ESI_ACTIVE;
+	TxHeader->BitRateSwitch = FDCAN_BRS_OFF;
+	TxHeader->FDFormat = FDCAN_FD_CAN;
+	TxHeader->TxEventFifoControl = FDCAN_NO_TX_EVENTS;
+	TxHeader->MessageMarker = 0;
+
+	switch (size)
+	{
+		case 0:
+			TxHeader->DataLength = FDCAN_DLC_BYTES_0;
+			break;
+		case 1:
+			TxHeader->DataLength = FDCAN_DLC_BYTES_1;
+			break;
+		case 2:
+			TxHeader->DataLength = FDCAN_DLC_BYTES_2;
+			break;
+		case 3:
+			TxHeader->DataLength = FDCAN_DLC_BYTES_3;
+			break;
+		case 4:
+			TxHeader->DataLength = FDCAN_DLC_BYTES_4;
+			break;
+		case 5:
+			TxHeader->DataLength = FDCAN_DLC_BYTES_5;
+			break;
+		case 6:
+			TxHeader->DataLength = FDCAN_DLC_BYTES_6;
+			break;
+		case 7:
+			TxHeader->DataLength = FDCAN_DLC_BYTES_7;
+			break;
+		case 8:
+			TxHeader->DataLength = FDCAN_DLC_BYTES_8;
+			break;
+		case 12:
+			TxHeader->DataLength = FDCAN_DLC_BYTES_12;
+			break;
+		case 16:
+			TxHeader->DataLength = FDCAN_DLC_BYTES_16;
+			break;
+		case 20:
+			TxHeader->DataLength = FDCAN_DLC_BYTES_20;
+			break;
+		case 24:
+			TxHeader->DataLength = FDCAN_DLC_BYTES_24;
+			break;
+		case 32:
+			TxHeader->DataLength = FDCAN_DLC_BYTES_32;
+			break;
+		case 48:
+			TxHeader->DataLength = FDCAN_DLC_BYTES_48;
+			break;
+		case 64:
+			TxHeader->DataLength = FDCAN_DLC_BYTES_64;
+			break;
+		default:
+			break;
+	}
+}
+
+uint32_t fdcan_free_to_send() {
+	return HAL_FDCAN_GetTxFifoFreeLevel(&hfdcan1);
+}
+
+size_t fdcan_frame_size(size_t size) {
+	for (uint32_t i = 0; i < sizeof(DLCtoBytes); i++) {
+		if (DLCtoBytes[i] >= size) {
+			return DLCtoBytes[i];
+		}
+	}
+	return DLCtoBytes[sizeof(DLCtoBytes) - 1];
+}
@@ -0,0 +1,117 @@
+/**
+ * @file histogram.c
+ * @author Luan
+ * @brief Log-bucketed (HDR-style) histograms for cycle measurements
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include "histogram.h"
+#include "main.h"
+#include "uart.h"
+
+
+/* Static function prototypes */
+static uint32_t bucket_index(uint32_t value);
+static uint32_t bucket_highest(uint32_t index);
+
+
+void hist_init(Histogram *hist, const char *name) {
+	hist->name = name;
+	hist_reset(hist);
+}
+
+void hist_reset(Histogram *hist) {
+	hist->count = 0;
+	hist->min = UINT32_MAX;
+	hist->max = 0;
+	for (uint32_t i = 0; i < HIST_BUCKETS; i++) {
+		hist->buckets[i] = 0;
+	}
+}
+
+void hist_record(Histogram *hist, uint32_t value) {
+	hist->buckets[bucket_index(value)]++;
+	hist->count++;
+	if (value < hist->min) hist->min = value;
+	if (value > hist->max) hist->max = value;
+}
+
+uint32_t hist_percentile(const Histogram *hist, uint32_t permille) {
+	if (hist->count == 0) {
+		return 0;
+	}
+
+	/* Rank of the requested value, rounded up */
+	uint32_t rank = (uint32_t)(((uint64_t)hist->count * permille + 999) / 1000);
+	if (rank == 0) rank = 1;
+
+	uint32_t cumulative = 0;
+	for (uint32_t i = 0; i < HIST_BUCKETS; i++) {
+		cumulative += hist->buckets[i];
+		if (cumulative >= rank) {
+			uint32_t value = bucket_highest(i);
+			return value > hist->max ? hist->max : value;
+		}
+	}
+
+	return hist->max;
+}
+
+void hist_print(const Histogram *hist) {
+	printf(
+		"%s: count=%u min=%u p50=%u p99=%u max=%u\r\n",
+		hist->name,
+		(unsigned int) hist->count,
+		(unsigned int) (hist->count ? hist->min : 0),
+		(unsigned int) hist_percentile(hist, 500),
+		(unsigned int) hist_percentile(hist, 990),
+		(unsigned int) hist->max
+	);
+}
+
+/**
+ * @brief Map a value to its bucket
+ *
+ * Values below HIST_SUB_COUNT have their own bucket. The others are split by
+ * their most significant bit (power of two) and the HIST_SUB_BITS bits right
+ * after it (sub-bucket).
+ *
+ * @param value Value to be mapped
+ * @return uint32_t Bucket index
+ */
+static uint32_t bucket_index(uint32_t value) {
+	if (value < HIST_SUB_COUNT) {
+		return value;
+	}
+
+	uint32_t msb = 31 - __CLZ(value);
+	if (msb >= HIST_MAX_BITS) {
+		return HIST_BUCKETS - 1;
+	}
+
+	uint32_t sub = (value >> (msb - HIST_SUB_BITS)) & (HIST_SUB_COUNT - 1);
+	return (msb - HIST_SUB_BITS + 1) * HIST_SUB_COUNT + sub;
+}
+
+/**
+ * @brief Get the highest value mapped to a bucket
+ *
+ * @param index Bucket index
+ * @return uint32_t Highest value of the bucket
+ */
+static uint32_t bucket_highest(uint32_t index) {
+	if (index < HIST_SUB_COUNT) {
+		return index;
+	}
+
+	uint32_t msb = index / HIST_SUB_COUNT + HIST_SUB_BITS - 1;
+	uint32_t sub = index % HIST_SUB_COUNT;
+	uint32_t shift = msb - HIST_SUB_BITS;
+
+	return (((HIST_SUB_COUNT + sub + 1) << shift) - 1);
+}
@@ -0,0 +1,219 @@
+/**
+ * @file isotp.c
+ * @author Luan
+ * @brief Segmented reception (ISO-TP-like) of messages decrypted on the fly
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include <string.h>
+#include "isotp.h"
+#include "fdcan.h"
+
+
+/* Cipher block size (every append but the last one is a multiple of it) */
+#define BLOCK_SIZE 16
+
+
+/* Reception state */
+static struct {
+	uint8_t active;
+	uint32_t length;		/* Plaintext size */
+	uint32_t received;		/* Stream (ciphertext and tag) bytes received */
+	uint8_t sn;				/* Sequence number of the next consecutive frame */
+	uint8_t block_count;
+	uint32_t timer;
+} rx;
+
+/* Ciphertext of the block being completed and received tag */
+static uint8_t block[BLOCK_SIZE];
+static size_t block_size;
+static uint8_t tag[AUTH_TAG_SIZE];
+
+/* Application handlers */
+static IsotpSink isotp_sink = NULL;
+static IsotpDone isotp_done = NULL;
+
+/* Conversion from Data Length Code to real size in bytes */
+static const uint8_t DLCtoBytes[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+
+
+/* Static function prototypes */
+static void consume(const uint8_t *data, size_t size);
+static void decrypt_block();
+static void send_flow_control(uint8_t status);
+static void end_reception(uint8_t auth);
+
+
+void isotp_setup(IsotpSink sink, IsotpDone done) {
+	isotp_sink = sink;
+	isotp_done = done;
+}
+
+uint8_t isotp_is_frame(const FDCAN_RxHeaderTypeDef *RxHeader) {
+	return isotp_done != NULL
+		&& RxHeader->IdType == FDCAN_STANDARD_ID
+		&& RxHeader->Identifier == ISOTP_DATA_ID;
+}
+
+void isotp_process(const FDCAN_RxHeaderTypeDef *RxHeader, const uint8_t *data) {
+	size_t size = DLCtoBytes[RxHeader->DataLength & 0xF];
+	uint32_t expected;
+
+	if (size < 1) {
+		return;
+	}
+
+	switch (data[0] & 0xF0) {
+		case ISOTP_PCI_FIRST:
+			if (size < ISOTP_FF_HEADER_SIZE) {
+				return;
+			}
+
+			/* A new first frame replaces an unfinished reception */
+			if (rx.active) {
+				end_reception(AUTH_ERROR);
+			}
+
+			rx.length = ((uint32_t)data[1] << 24) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 8) | data[4];
+			if (rx.length == 0 || rx.length > ISOTP_MAX_MESSAGE_SIZE) {
+				send_flow_control(ISOTP_FLOW_OVERFLOW);
+				return;
+			}
+
+			rx.active = 1;
+			rx.received = 0;
+			rx.sn = 1;
+			rx.block_count = 0;
+			rx.timer = HAL_GetTick();
+			block_size = 0;
+			stream_decrypt_start(ISOTP_DATA_ID, rx.length, &data[5]);
+			consume(&data[ISOTP_FF_HEADER_SIZE], size - ISOTP_FF_HEADER_SIZE);
+			break;
+
+		case ISOTP_PCI_CONSECUTIVE:
+			if (!rx.active) {
+				return;
+			}
+			if ((data[0] & 0x0F) != rx.sn) {
+				end_reception(AUTH_ERROR);
+				return;
+			}
+
+			rx.sn = (rx.sn + 1) & 0x0F;
+			rx.block_count++;
+			rx.timer = HAL_GetTick();
+			consume(&data[ISOTP_CF_HEADER_SIZE], size - ISOTP_CF_HEADER_SIZE);
+			break;
+
+		default:
+			return;
+	}
+
+	expected = rx.length + AUTH_TAG_SIZE;
+	if (rx.received == expected) {
+		end_reception(stream_decrypt_finish(tag));
+	}
+	else if ((data[0] & 0xF0) == ISOTP_PCI_FIRST || rx.block_count == ISOTP_BLOCK_SIZE) {
+		rx.block_count = 0;
+		send_flow_control(ISOTP_FLOW_CTS);
+	}
+}
+
+void isotp_poll() {
+	if (rx.active && HAL_GetTick() - rx.timer >= ISOTP_TIMEOUT) {
+		end_reception(AUTH_ERROR);
+	}
+}
+
+/**
+ * @brief Take the stream bytes of a frame (ciphertext first, then the tag)
+ *
+ * Whole ciphertext blocks are decrypted as soon as they are complete, the
+ * last (partial) block when the ciphertext is over. The padding of the last
+ * frame is ignored.
+ *
+ * @param data Stream bytes
+ * @param size Size of the frame data
+ */
+static void consume(const uint8_t *data, size_t size) {
+	uint32_t left = rx.length + AUTH_TAG_SIZE - rx.received;
+	if (size > left) {
+		size = left;
+	}
+
+	while (size > 0) {
+		if (rx.received < rx.length) {
+			size_t chunk = BLOCK_SIZE - block_size;
+			if (chunk > rx.length - rx.received) {
+				chunk = rx.length - rx.received;
+			}
+			if (chunk > size) {
+				chunk = size;
+			}
+
+			memcpy(&block[block_size], data, chunk);
+			block_size += chunk;
+			rx.received += chunk;
+			if (block_size == BLOCK_SIZE || rx.received == rx.length) {
+				decrypt_block();
+			}
+			data += chunk;
+			size -= chunk;
+		}
+		else {
+			size_t chunk = rx.length + AUTH_TAG_SIZE - rx.received;
+			if (chunk > size) {
+				chunk = size;
+			}
+
+			memcpy(&tag[rx.received - rx.length], data, chunk);
+			rx.received += chunk;
+			data += chunk;
+			size -= chunk;
+		}
+	}
+}
+
+/**
+ * @brief Decrypt the buffered ciphertext block and pass it to the sink
+ *
+ */
+static void decrypt_block() {
+	uint8_t plaintext[BLOCK_SIZE];
+
+	stream_decrypt_append(block, block_size, plaintext);
+	if (isotp_sink != NULL) {
+		isotp_sink(rx.received - block_size, plaintext, block_size);
+	}
+	block_size = 0;
+}
+
+/**
+ * @brief Send a flow control frame
+ *
+ * Dropped if the TX FIFO is full, the sender times out.
+ *
+ * @param status Flow status
+ */
+static void send_flow_control(uint8_t status) {
+	uint8_t frame[3] = {ISOTP_PCI_FLOW_CONTROL | status, ISOTP_BLOCK_SIZE, ISOTP_ST_MIN};
+	if (!fdcan_free_to_send()) {
+		return;
+	}
+	fdcan_send(ISOTP_FC_ID, frame, sizeof(frame));
+}
+
+/**
+ * @brief End the reception and report it
+ *
+ * @param auth AUTH_OK if the whole message was received and authenticated
+ */
+static void end_reception(uint8_t auth) {
+	rx.active = 0;
+	isotp_done(rx.length, rx.received < rx.length ? rx.received : rx.length, auth);
+}
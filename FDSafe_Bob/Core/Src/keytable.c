@@ -0,0 +1,340 @@
+/**
+ * @file keytable.c
+ * @author Luan
+ * @brief Key table: keys per sender and identifier range, expanded contexts cached in an LRU
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include <string.h>
+#include "keytable.h"
+#include "uart.h"
+#include "ccmram.h"
+#include "ram.h"
+
+
+/* Cache index of a key that is not expanded */
+#define NO_CACHE 0xFF
+
+/* Cache memory, and the contexts it holds with the small engine (no 8-bit GHASH table) */
+#define CACHE_POOL_SIZE (KEYTABLE_CACHE_SIZE * sizeof(cmox_gcmFast_handle_t))
+#define CACHE_ENTRIES (CACHE_POOL_SIZE / sizeof(cmox_gcmSmall_handle_t))
+
+
+/* Key of a sender */
+typedef struct {
+	uint8_t valid;
+	uint8_t epoch;
+	uint8_t cache;			/* Cache entry holding its context, NO_CACHE if not expanded */
+	uint8_t key[KEY_SIZE];
+} KeySlot;
+
+/* Sender: active key and the one received but not used yet */
+typedef struct {
+	KeySlot slots[KEY_SLOTS];
+	uint8_t active;
+} Sender;
+
+/* Expanded context (key schedule and GHASH table), keyed and waiting for an IV in the cache memory */
+typedef struct {
+	uint8_t sender;			/* Owner, KEYTABLE_NO_SENDER if free */
+	uint8_t slot;
+	uint32_t last_use;
+} CacheEntry;
+
+static Sender senders[KEYTABLE_SENDERS] RAM_CRYPTO;
+static uint8_t sender_count = 0;
+
+/* Sender of every standard identifier */
+static uint8_t id_map[KEYTABLE_ID_COUNT] RAM_TABLES;
+
+/* Least recently used contexts are replaced first, as many as the engine's context size allows */
+static CacheEntry cache[CACHE_ENTRIES] CCMRAM_DATA;
+static uint32_t cache_pool[CACHE_POOL_SIZE / sizeof(uint32_t)] CCMRAM_DATA;
+static uint8_t cache_entries = KEYTABLE_CACHE_SIZE;
+static size_t context_size = sizeof(cmox_gcmFast_handle_t);
+static uint32_t use_clock = 0;
+static uint32_t hits = 0;
+static uint32_t misses = 0;
+
+static CryptoEngine cache_engine = CRYPTO_ENGINE_FAST;
+
+
+/* Static function prototypes */
+static Sender *find_sender(uint32_t id);
+static KeySlot *find_slot(Sender *sender, uint8_t epoch);
+static GcmHandle *context(uint8_t entry);
+static GcmHandle *expand(Sender *sender, KeySlot *slot);
+static void evict(KeySlot *slot);
+
+
+void keytable_setup() {
+	memset(id_map, KEYTABLE_NO_SENDER, sizeof(id_map));
+	sender_count = 0;
+	for (uint8_t i = 0; i < CACHE_ENTRIES; i++) {
+		cache[i].sender = KEYTABLE_NO_SENDER;
+	}
+}
+
+uint8_t keytable_add_sender(const uint8_t *key) {
+	if (sender_count >= KEYTABLE_SENDERS) {
+		return KEYTABLE_NO_SENDER;
+	}
+
+	Sender *sender = &senders[sender_count];
+	memset(sender, 0, sizeof(Sender));
+	for (uint8_t i = 0; i < KEY_SLOTS; i++) {
+		sender->slots[i].cache = NO_CACHE;
+	}
+	sender->slots[0].valid = 1;
+	memcpy(sender->slots[0].key, key, KEY_SIZE);
+
+	return sender_count++;
+}
+
+void keytable_map(uint8_t sender, uint32_t first_id, uint32_t last_id) {
+	for (uint32_t id = first_id; id <= last_id && id < KEYTABLE_ID_COUNT; id++) {
+		id_map[id] = sender;
+	}
+}
+
+void keytable_set_engine(CryptoEngine engine) {
+	cache_engine = engine;
+	for (uint8_t i = 0; i < CACHE_ENTRIES; i++) {
+		if (cache[i].sender != KEYTABLE_NO_SENDER) {
+			evict(&senders[cache[i].sender].slots[cache[i].slot]);
+		}
+	}
+
+	context_size = engine == CRYPTO_ENGINE_FAST ? sizeof(cmox_gcmFast_handle_t) : sizeof(cmox_gcmSmall_handle_t);
+	cache_entries = CACHE_POOL_SIZE / context_size;
+}
+
+CCMRAM_CODE cmox_cipher_handle_t *keytable_context(uint32_t id, uint8_t epoch, GcmHandle *copy) {
+	Sender *sender = find_sender(id);
+	KeySlot *slot = sender == NULL ? NULL : find_slot(sender, epoch);
+
+	if (slot == NULL) {
+		return NULL;
+	}
+
+	memcpy(copy, expand(sender, slot), context_size);
+	return &copy->super;
+}
+
+void keytable_install(uint32_t id, uint8_t epoch, const uint8_t *key) {
+	Sender *sender = find_sender(id);
+
+	if (sender == NULL) {
+		return;
+	}
+
+	KeySlot *slot = &sender->slots[(sender->active + 1) % KEY_SLOTS];
+	evict(slot);
+	slot->valid = 1;
+	slot->epoch = epoch;
+	memcpy(slot->key, key, KEY_SIZE);
+
+	/* Expanded now, so the switchover does not pay for it */
+	expand(sender, slot);
+}
+
+void keytable_promote(uint32_t id, uint8_t epoch) {
+	Sender *sender = find_sender(id);
+	KeySlot *slot = sender == NULL ? NULL : find_slot(sender, epoch);
+
+	if (slot == NULL || slot == &sender->slots[sender->active]) {
+		return;
+	}
+
+	KeySlot *old = &sender->slots[sender->active];
+	evict(old);
+	old->valid = 0;
+	memset(old->key, 0, KEY_SIZE);
+	sender->active = slot - sender->slots;
+}
+
+uint8_t keytable_epoch(uint32_t id) {
+	Sender *sender = find_sender(id);
+	return sender == NULL ? 0 : sender->slots[sender->active].epoch;
+}
+
+const uint8_t *keytable_key(uint32_t id, uint8_t epoch) {
+	Sender *sender = find_sender(id);
+	KeySlot *slot = sender == NULL ? NULL : find_slot(sender, epoch);
+	return slot == NULL ? NULL : slot->key;
+}
+
+void keytable_print() {
+	printf("key table: %u senders, context cache hits %u, misses %u\r\n",
+		(unsigned int)sender_count, (unsigned int)hits, (unsigned int)misses);
+}
+
+void keytable_benchmark() {
+	uint8_t frame[KEYTABLE_BENCH_DATA_SIZE + AUTH_TAG_SIZE + IV_SIZE] = {0};
+	uint8_t plaintext[KEYTABLE_BENCH_DATA_SIZE];
+	uint8_t key[KEY_SIZE];
+
+	/* Synthetic senders take over identifiers from KEYTABLE_BENCH_FIRST_ID for the run */
+	uint8_t first = sender_count;
+	uint32_t bench_ids = (KEYTABLE_SENDERS - first) * KEYTABLE_BENCH_IDS;
+	uint8_t saved_map[KEYTABLE_SENDERS * KEYTABLE_BENCH_IDS];
+	memcpy(saved_map, &id_map[KEYTABLE_BENCH_FIRST_ID], bench_ids);
+
+	while (sender_count < KEYTABLE_SENDERS) {
+		for (uint8_t i = 0; i < KEY_SIZE; i++) {
+			key[i] = (uint8_t)(sender_count * 37 + i);
+		}
+		uint32_t first_id = KEYTABLE_BENCH_FIRST_ID + (sender_count - first) * KEYTABLE_BENCH_IDS;
+		keytable_map(keytable_add_sender(key), first_id, first_id + KEYTABLE_BENCH_IDS - 1);
+	}
+
+	printf("Verification cycles @ %u Hz, %u frames per run\r\n", (unsigned int)SystemCoreClock, KEYTABLE_BENCH_ROUNDS);
+	for (uint32_t count = 1; count <= (uint32_t)(KEYTABLE_SENDERS - first); count *= 2) {
+		uint32_t ids = count * KEYTABLE_BENCH_IDS;
+		uint32_t run_hits = hits;
+		uint32_t run_misses = misses;
+
+		uint32_t start_time = DWT->CYCCNT;
+		for (uint32_t i = 0; i < KEYTABLE_BENCH_ROUNDS; i++) {
+			decrypt(KEYTABLE_BENCH_FIRST_ID + i % ids, frame, plaintext, KEYTABLE_BENCH_DATA_SIZE);
+		}
+		uint32_t cycles = DWT->CYCCNT - start_time;
+
+		printf("%u senders, %u IDs: %u/verification, cache hits %u, misses %u\r\n",
+			(unsigned int)count,
+			(unsigned int)ids,
+			(unsigned int)(cycles / KEYTABLE_BENCH_ROUNDS),
+			(unsigned int)(hits - run_hits),
+			(unsigned int)(misses - run_misses));
+	}
+
+	/* Remove the synthetic senders (their keys are predictable) and give the identifiers back */
+	for (uint8_t i = first; i < KEYTABLE_SENDERS; i++) {
+		for (uint8_t j = 0; j < KEY_SLOTS; j++) {
+			evict(&senders[i].slots[j]);
+		}
+		memset(&senders[i], 0, sizeof(Sender));
+	}
+	memcpy(&id_map[KEYTABLE_BENCH_FIRST_ID], saved_map, bench_ids);
+	sender_count = first;
+}
+
+/**
+ * @brief Get the sender of an identifier
+ *
+ * @param id Identifier
+ * @return Sender* Sender, NULL if the identifier has no key
+ */
+static Sender *find_sender(uint32_t id) {
+	if (id >= KEYTABLE_ID_COUNT || id_map[id] == KEYTABLE_NO_SENDER) {
+		return NULL;
+	}
+	return &senders[id_map[id]];
+}
+
+/**
+ * @brief Get the key of an epoch
+ *
+ * @param sender Sender
+ * @param epoch Key epoch
+ * @return KeySlot* Key, NULL if unknown
+ */
+static KeySlot *find_slot(Sender *sender, uint8_t epoch) {
+	for (uint8_t i = 0; i < KEY_SLOTS; i++) {
+		if (sender->slots[i].valid && sender->slots[i].epoch == epoch) {
+			return &sender->slots[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Get the context of a cache entry in the cache memory
+ *
+ * @param entry Cache index
+ * @return GcmHandle* Context
+ */
+static GcmHandle *context(uint8_t entry) {
+	return (GcmHandle *)((uint8_t *)cache_pool + entry * context_size);
+}
+
+/**
+ * @brief Get the cached context of a key, expanding it on a miss
+ *
+ * @param sender Sender of the key
+ * @param slot Key
+ * @return GcmHandle* Context
+ */
+static GcmHandle *expand(Sender *sender, KeySlot *slot) {
+	CacheEntry *entry;
+
+	if (slot->cache != NO_CACHE) {
+		hits++;
+		cache[slot->cache].last_use = ++use_clock;
+		return context(slot->cache);
+	}
+	misses++;
+
+	/* Free entry, otherwise the least recently used one */
+	uint8_t victim = 0;
+	for (uint8_t i = 0; i < cache_entries; i++) {
+		if (cache[i].sender == KEYTABLE_NO_SENDER) {
+			victim = i;
+			break;
+		}
+		if (cache[i].last_use < cache[victim].last_use) {
+			victim = i;
+		}
+	}
+	entry = &cache[victim];
+	if (entry->sender != KEYTABLE_NO_SENDER) {
+		evict(&senders[entry->sender].slots[entry->slot]);
+	}
+
+	GcmHandle *handle = context(victim);
+	cmox_cipher_handle_t *ctx;
+	switch (cache_engine)
+	{
+		case CRYPTO_ENGINE_SMALL:
+			ctx = cmox_gcmSmall_construct(&handle->small, CMOX_AESSMALL_GCMSMALL_DEC);
+			break;
+		case CRYPTO_ENGINE_BALANCED:
+			ctx = cmox_gcmSmall_construct(&handle->small, CMOX_AESFAST_GCMSMALL_DEC);
+			break;
+		default:
+			ctx = cmox_gcmFast_construct(&handle->fast, CMOX_AESFAST_GCMFAST_DEC);
+			break;
+	}
+
+	if (ctx == NULL
+			|| cmox_cipher_init(ctx) != CMOX_CIPHER_SUCCESS
+			|| cmox_cipher_setTagLen(ctx, AUTH_TAG_SIZE) != CMOX_CIPHER_SUCCESS
+			|| cmox_cipher_setKey(ctx, slot->key, KEY_SIZE) != CMOX_CIPHER_SUCCESS)
+	{
+		printf("Decryption setup error\r\n");
+		Error_Handler();
+	}
+
+	entry->sender = sender - senders;
+	entry->slot = slot - sender->slots;
+	entry->last_use = ++use_clock;
+	slot->cache = victim;
+	return handle;
+}
+
+/**
+ * @brief Drop the cached context of a key
+ *
+ * @param slot Key
+ */
+static void evict(KeySlot *slot) {
+	if (slot->cache != NO_CACHE) {
+		cache[slot->cache].sender = KEYTABLE_NO_SENDER;
+		slot->cache = NO_CACHE;
+	}
+}
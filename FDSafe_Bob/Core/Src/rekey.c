@@ -0,0 +1,163 @@
+/**
+ * @file rekey.c
+ * @author Luan
+ * @brief Reception of new keys distributed over the bus
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include <string.h>
+#include "rekey.h"
+#include "keytable.h"
+#include "fdcan.h"
+#include "uart.h"
+
+
+/* Key installed and not used by the sender yet */
+static struct {
+	uint8_t pending;
+	uint8_t epoch;
+	uint32_t installed;
+	uint32_t cycles;		/* Cycles to unwrap, precompute and acknowledge the key */
+} rekey;
+
+/* Nonce the next key update must carry, and the one the pending key was bound to */
+static struct {
+	uint8_t announce;		/* Announced until a key update is installed */
+	uint32_t next_announce;
+	uint8_t current[KEY_NONCE_SIZE];
+	uint8_t installed[KEY_NONCE_SIZE];
+} nonce;
+
+
+/* Static functions prototypes */
+static void draw_nonce(uint8_t *value);
+static void send_nonce();
+
+
+void rekey_setup() {
+	draw_nonce(nonce.current);
+	nonce.announce = 1;
+	nonce.next_announce = HAL_GetTick();
+}
+
+uint8_t rekey_is_update(const FDCAN_RxHeaderTypeDef *RxHeader) {
+	return RxHeader->IdType == FDCAN_STANDARD_ID
+		&& RxHeader->Identifier == ID_KEY_UPDATE;
+}
+
+void rekey_update(const uint8_t *data, size_t size) {
+	uint8_t new_key[KEY_SIZE];
+	uint8_t bound[KEY_NONCE_SIZE];
+	uint8_t ack[KEY_ACK_SIZE] = {0};
+	uint8_t epoch;
+
+	if (size < KEY_WRAP_SIZE) {
+		return;
+	}
+
+	uint32_t start_cycles = DWT->CYCCNT;
+	if (crypto_unwrap_key(data, &epoch, bound, new_key) != AUTH_OK) {
+		printf("Invalid key update\r\n");
+		return;
+	}
+
+	/* The key belongs to the sender of the update. A new key must carry the current
+	 * nonce, so an update recorded earlier (even for the same epoch) is rejected */
+	uint8_t fresh = memcmp(bound, nonce.current, KEY_NONCE_SIZE) == 0
+		&& epoch != keytable_epoch(ID_KEY_UPDATE);
+	/* The same update again (acknowledgement lost): acknowledged, not installed again */
+	uint8_t repeated = rekey.pending && epoch == rekey.epoch
+		&& memcmp(bound, nonce.installed, KEY_NONCE_SIZE) == 0;
+
+	if (fresh) {
+		crypto_install_key(ID_KEY_UPDATE, epoch, new_key);
+		memcpy(nonce.installed, nonce.current, KEY_NONCE_SIZE);
+		draw_nonce(nonce.current);
+		nonce.announce = 0;
+
+		rekey.pending = 1;
+		rekey.epoch = epoch;
+		rekey.installed = HAL_GetTick();
+	}
+	memset(new_key, 0, sizeof(new_key));
+
+	if (!fresh && !repeated) {
+		printf("Key update rejected\r\n");
+		return;
+	}
+
+	/* The proof carries the nonce of the next update. Without room in the TX FIFO the
+	 * acknowledgement is dropped, the sender repeats the update */
+	ack[0] = epoch;
+	crypto_key_proof(ID_KEY_UPDATE, epoch, nonce.current, &ack[KEY_ACK_PROOF_OFFSET]);
+	if (fdcan_free_to_send()) {
+		fdcan_send(ID_KEY_ACK, ack, sizeof(ack));
+	}
+	if (fresh) {
+		rekey.cycles = DWT->CYCCNT - start_cycles;
+	}
+}
+
+uint8_t rekey_is_request(const FDCAN_RxHeaderTypeDef *RxHeader) {
+	return RxHeader->IdType == FDCAN_STANDARD_ID
+		&& RxHeader->Identifier == ID_KEY_REQUEST;
+}
+
+void rekey_request() {
+	send_nonce();
+}
+
+void rekey_poll() {
+	if (rekey.pending && keytable_epoch(ID_KEY_UPDATE) == rekey.epoch) {
+		rekey.pending = 0;
+		printf("Key epoch %u active after %u ms (%u cycles to install)\r\n",
+			(unsigned int)rekey.epoch,
+			(unsigned int)(HAL_GetTick() - rekey.installed),
+			(unsigned int)rekey.cycles);
+	}
+
+	/* The sender may hold a key lost at reset: it redistributes one on the announcement */
+	if (nonce.announce && HAL_GetTick() >= nonce.next_announce) {
+		send_nonce();
+		nonce.next_announce = HAL_GetTick() + REKEY_ANNOUNCE_INTERVAL;
+	}
+}
+
+/**
+ * @brief Draw a nonce from the RNG
+ *
+ * @param value Buffer to store the nonce (KEY_NONCE_SIZE bytes)
+ */
+static void draw_nonce(uint8_t *value) {
+	uint32_t word;
+
+	for (uint8_t i = 0; i < KEY_NONCE_SIZE; i += sizeof(word)) {
+		if (HAL_RNG_GenerateRandomNumber(&hrng, &word) != HAL_OK)
+		{
+			printf("Random number generation error\r\n");
+			Error_Handler();
+		}
+		memcpy(&value[i], &word, sizeof(word));
+	}
+}
+
+/**
+ * @brief Send the active epoch and the current nonce (dropped without room in the TX FIFO, sent again on request)
+ *
+ */
+static void send_nonce() {
+	uint8_t frame[KEY_NONCE_FRAME_SIZE] = {0};
+
+	if (!fdcan_free_to_send()) {
+		return;
+	}
+
+	frame[0] = keytable_epoch(ID_KEY_UPDATE);
+	memcpy(&frame[KEY_NONCE_OFFSET], nonce.current, KEY_NONCE_SIZE);
+	fdcan_send(ID_KEY_NONCE, frame, sizeof(frame));
+}
@@ -0,0 +1,146 @@
+/**
+ * @file replay.c
+ * @author Luan
+ * @brief Replay protection: per-identifier sliding window over the IV sequence
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include <string.h>
+#include "replay.h"
+#include "crypto.h"
+#include "uart.h"
+#include "ram.h"
+
+
+/* Window of one identifier (bit n of the bitmap is the sequence top - n) */
+typedef struct {
+	uint8_t valid;
+	uint8_t epoch;			/* Key epoch of the sequences in the window */
+	uint64_t top;
+	uint64_t bitmap;
+} ReplayWindow;
+
+/* Protected identifiers, the window of an identifier is at its index (kept, not copied) */
+static const uint32_t *tracked_ids = NULL;
+static uint32_t tracked_count = 0;
+static ReplayWindow windows[REPLAY_MAX_IDS] RAM_TABLES;
+
+/* Rejected messages per reason */
+static uint32_t rejected[REPLAY_UNTRACKED + 1];
+
+
+/* Static function prototypes */
+static ReplayWindow *find_window(uint32_t id);
+static uint64_t iv_sequence(const uint8_t *iv);
+
+
+void replay_setup(const uint32_t *ids, uint32_t count) {
+	if (count > REPLAY_MAX_IDS) {
+		printf("Too many replay-protected identifiers\r\n");
+		Error_Handler();
+	}
+
+	tracked_ids = ids;
+	tracked_count = count;
+	memset(windows, 0, sizeof(windows));
+}
+
+uint8_t replay_check(uint32_t id, const uint8_t *iv) {
+	ReplayWindow *window = find_window(id);
+	uint8_t result = REPLAY_FRESH;
+
+	/* Identifiers without a window cannot be tracked, so they are not trusted */
+	if (window == NULL) {
+		result = REPLAY_UNTRACKED;
+	}
+	else {
+		uint64_t sequence = iv_sequence(iv);
+
+		/* Under another key the sequence may have restarted, the tag decides */
+		if (window->valid && window->epoch == iv[0] && sequence <= window->top) {
+			uint64_t behind = window->top - sequence;
+			if (behind >= REPLAY_WINDOW_SIZE) {
+				result = REPLAY_STALE;
+			}
+			else if (window->bitmap & ((uint64_t)1 << behind)) {
+				result = REPLAY_DUPLICATE;
+			}
+		}
+	}
+
+	if (result != REPLAY_FRESH) {
+		rejected[result]++;
+	}
+	return result;
+}
+
+void replay_accept(uint32_t id, const uint8_t *iv) {
+	ReplayWindow *window = find_window(id);
+
+	if (window == NULL) {
+		return;
+	}
+
+	uint64_t sequence = iv_sequence(iv);
+
+	if (!window->valid || window->epoch != iv[0]) {
+		window->valid = 1;
+		window->epoch = iv[0];
+		window->top = sequence;
+		window->bitmap = 1;
+	}
+	else if (sequence > window->top) {
+		uint64_t ahead = sequence - window->top;
+		window->bitmap = ahead >= REPLAY_WINDOW_SIZE ? 0 : window->bitmap << ahead;
+		window->bitmap |= 1;
+		window->top = sequence;
+	}
+	else {
+		window->bitmap |= (uint64_t)1 << (window->top - sequence);
+	}
+}
+
+void replay_print() {
+	printf("replay: duplicate %u, stale %u, untracked %u\r\n",
+		(unsigned int)rejected[REPLAY_DUPLICATE],
+		(unsigned int)rejected[REPLAY_STALE],
+		(unsigned int)rejected[REPLAY_UNTRACKED]);
+}
+
+void replay_reset() {
+	memset(rejected, 0, sizeof(rejected));
+}
+
+/**
+ * @brief Get the window of an identifier
+ *
+ * @param id Identifier
+ * @return ReplayWindow* Window, NULL if the identifier is not protected
+ */
+static ReplayWindow *find_window(uint32_t id) {
+	for (uint32_t i = 0; i < tracked_count; i++) {
+		if (tracked_ids[i] == id) {
+			return &windows[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Get the sequence of an initialization vector
+ *
+ * @param iv Initialization vector
+ * @return uint64_t Sequence
+ */
+static uint64_t iv_sequence(const uint8_t *iv) {
+	uint64_t sequence = 0;
+	for (uint8_t i = 0; i < IV_SEQUENCE_SIZE; i++) {
+		sequence = (sequence << 8) | iv[IV_EPOCH_SIZE + IV_SESSION_SIZE + i];
+	}
+	return sequence;
+}
@@ -0,0 +1,167 @@
+/**
+ * @file timesync.c
+ * @author Luan
+ * @brief Bus time synchronisation, receiver side (offset and drift to the master)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include "timesync.h"
+#include "fdcan.h"
+#include "uart.h"
+
+
+/* Last sync frame received */
+static struct {
+	uint8_t valid;
+	uint8_t sequence;
+	uint32_t local;			/* Extended RX timestamp */
+} sync;
+
+/* Reference pair and drift of the local counter (parts per billion, positive if it runs fast) */
+static struct {
+	uint32_t samples;
+	uint32_t local;
+	uint32_t master;
+	int32_t drift_ppb;
+	int32_t residual;		/* Prediction error of the last pair (ticks) */
+	uint32_t max_residual;
+	uint32_t discards;		/* Consecutive pairs discarded */
+	uint32_t discarded;		/* Pairs discarded since boot */
+	uint32_t restarts;
+} ref;
+
+
+/* Static function prototypes */
+static uint32_t read_time(const uint8_t *data);
+static void update(uint32_t local, uint32_t master);
+
+
+uint8_t timesync_is_frame(const FDCAN_RxHeaderTypeDef *RxHeader) {
+	return RxHeader->IdType == FDCAN_STANDARD_ID
+		&& (RxHeader->Identifier == TIMESYNC_SYNC_ID || RxHeader->Identifier == TIMESYNC_FOLLOW_UP_ID);
+}
+
+void timesync_process(const FDCAN_RxHeaderTypeDef *RxHeader, const uint8_t *data) {
+	if (RxHeader->DataLength != FDCAN_DLC_BYTES_8) {
+		return;
+	}
+
+	if (RxHeader->Identifier == TIMESYNC_SYNC_ID) {
+		sync.valid = 1;
+		sync.sequence = data[0];
+		sync.local = fdcan_timestamp_extend(RxHeader->RxTimestamp);
+	}
+	else if (sync.valid && data[0] == sync.sequence) {
+		update(sync.local, read_time(data));
+		sync.valid = 0;
+	}
+}
+
+uint8_t timesync_locked() {
+	return ref.samples >= 2;
+}
+
+uint32_t timesync_to_global(uint32_t local) {
+	if (ref.samples == 0) {
+		return local;
+	}
+
+	/* Local ticks since the reference pair, scaled to master ticks */
+	int32_t elapsed = (int32_t)(local - ref.local);
+	int64_t scaled = (int64_t)elapsed * 1000000000 / (1000000000 + ref.drift_ppb);
+	return ref.master + (uint32_t)(int32_t)scaled;
+}
+
+void timesync_print() {
+	if (ref.samples == 0) {
+		printf("timesync: not synchronised, %u pairs discarded\r\n", (unsigned int)ref.discarded);
+		return;
+	}
+
+	int32_t offset = (int32_t)(ref.local - ref.master);
+	printf("timesync: %u syncs, offset %s%u us, drift %d ppb, last residual %s%u us, max %u us, %u pairs discarded, %u restarts\r\n",
+		(unsigned int)ref.samples,
+		offset < 0 ? "-" : "",
+		(unsigned int)fdcan_timestamp_to_usec(offset < 0 ? -offset : offset),
+		(int)ref.drift_ppb,
+		ref.residual < 0 ? "-" : "",
+		(unsigned int)fdcan_timestamp_to_usec(ref.residual < 0 ? -ref.residual : ref.residual),
+		(unsigned int)fdcan_timestamp_to_usec(ref.max_residual),
+		(unsigned int)ref.discarded,
+		(unsigned int)ref.restarts);
+}
+
+/**
+ * @brief Get the master time of a frame
+ *
+ * @param data Payload of a sync or follow-up frame
+ * @return uint32_t Master time in timestamp ticks
+ */
+static uint32_t read_time(const uint8_t *data) {
+	return (data[7] << 24) | (data[6] << 16) | (data[5] << 8) | data[4];
+}
+
+/**
+ * 1. Predict the master time of the new pair with the current model, the error is the residual
+ * 2. Discard the pair if it is off the model (wrong wrap-around or forged frame), restart the model after too many
+ * 3. Measure the drift over the interval since the reference pair and filter it
+ * 4. The new pair becomes the reference (the offset is corrected at every synchronisation)
+ */
+static void update(uint32_t local, uint32_t master) {
+	if (ref.samples > 0) {
+		uint32_t local_elapsed = local - ref.local;
+		uint32_t master_elapsed = master - ref.master;
+		int32_t residual;
+		uint32_t bound;
+
+		if (master_elapsed == 0) {
+			return;
+		}
+
+		/* Without a drift yet, the intervals may only differ by the largest drift */
+		if (ref.samples > 1) {
+			residual = (int32_t)(timesync_to_global(local) - master);
+			bound = TIMESYNC_MAX_RESIDUAL;
+		}
+		else {
+			residual = (int32_t)(local_elapsed - master_elapsed);
+			bound = TIMESYNC_MAX_RESIDUAL + (uint32_t)((uint64_t)master_elapsed * TIMESYNC_MAX_DRIFT_PPM / 1000000);
+		}
+		uint32_t magnitude = residual < 0 ? -residual : residual;
+
+		if (magnitude > bound) {
+			ref.discarded++;
+			if (++ref.discards >= TIMESYNC_MAX_DISCARDS) {
+				ref.samples = 0;
+				ref.discards = 0;
+				ref.restarts++;
+			}
+			return;
+		}
+		ref.discards = 0;
+
+		if (ref.samples > 1) {
+			ref.residual = residual;
+			if (magnitude > ref.max_residual) {
+				ref.max_residual = magnitude;
+			}
+		}
+
+		int32_t drift = (int32_t)(((int64_t)local_elapsed - master_elapsed) * 1000000000 / master_elapsed);
+		if (ref.samples == 1) {
+			ref.drift_ppb = drift;
+		}
+		else {
+			ref.drift_ppb += (drift - ref.drift_ppb) >> TIMESYNC_DRIFT_SHIFT;
+		}
+	}
+
+	ref.local = local;
+	ref.master = master;
+	ref.samples++;
+}
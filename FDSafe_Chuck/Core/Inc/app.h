@@ -16,9 +16,12 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include "stm32g4xx_hal.h"
 #include "uart.h"
 #include "fdcan.h"
+#include "idstats.h"
+#include "command.h"
 
 
 #define MILLISECONDS *1
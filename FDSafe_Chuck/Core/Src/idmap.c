@@ -0,0 +1,65 @@
+/**
+ * @file idmap.c
+ * @author Luan
+ * @brief Direct-indexed map from 11-bit identifiers to table slots
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include "idmap.h"
+#include "uart.h"
+#include "ram.h"
+
+
+/* Slot + 1 of each identifier (0 means no slot, so the map starts zeroed) */
+static uint8_t slot_map[IDMAP_ID_COUNT] RAM_TABLES;
+
+/* Identifier of each slot */
+static uint16_t slot_ids[IDMAP_MAX_SLOTS] RAM_TABLES;
+static uint8_t slot_count = 0;
+
+
+uint8_t idmap_lookup(uint32_t id) {
+	if (id >= IDMAP_ID_COUNT || slot_map[id] == 0) {
+		return IDMAP_NO_SLOT;
+	}
+	return slot_map[id] - 1;
+}
+
+uint8_t idmap_assign(uint32_t id) {
+	if (id >= IDMAP_ID_COUNT) {
+		return IDMAP_NO_SLOT;
+	}
+
+	if (slot_map[id] == 0) {
+		if (slot_count == IDMAP_MAX_SLOTS) {
+			return IDMAP_NO_SLOT;
+		}
+		slot_ids[slot_count] = (uint16_t)id;
+		slot_count++;
+		slot_map[id] = slot_count;
+	}
+
+	return slot_map[id] - 1;
+}
+
+void idmap_reserve(const uint32_t *ids, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		if (idmap_assign(ids[i]) == IDMAP_NO_SLOT) {
+			printf("Identifier map full\r\n");
+			Error_Handler();
+		}
+	}
+}
+
+uint8_t idmap_count() {
+	return slot_count;
+}
+
+uint32_t idmap_id(uint8_t slot) {
+	return slot_ids[slot];
+}
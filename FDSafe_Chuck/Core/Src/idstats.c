@@ -0,0 +1,119 @@
+/**
+ * @file idstats.c
+ * @author Luan
+ * @brief Per-identifier bus statistics
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+
+#include "idstats.h"
+#include "fdcan.h"
+#include "uart.h"
+#include "ram.h"
+
+
+/* Periods are clamped so the scaled EWMA cannot overflow */
+#define PERIOD_LIMIT (UINT32_MAX >> (IDSTATS_EWMA_SHIFT + 1))
+
+
+/* One entry per identifier slot */
+static IdStats table[IDMAP_MAX_SLOTS] RAM_LOGS;
+
+/* Frames of identifiers that did not fit in the table */
+static uint32_t overflow_count = 0;
+
+
+void idstats_update(const FDCAN_RxHeaderTypeDef *RxHeader) {
+	uint32_t timestamp = fdcan_timestamp_extend(RxHeader->RxTimestamp);
+	uint8_t slot = idmap_assign(RxHeader->Identifier);
+
+	if (slot == IDMAP_NO_SLOT) {
+		overflow_count++;
+		return;
+	}
+
+	IdStats *stats = &table[slot];
+
+	if (stats->count == 0) {
+		stats->dlc = RxHeader->DataLength;
+		stats->min_period = UINT32_MAX;
+	}
+	else {
+		if (RxHeader->DataLength != stats->dlc) {
+			stats->dlc_mismatch++;
+		}
+
+		uint32_t period = timestamp - stats->last_timestamp;
+		if (period > PERIOD_LIMIT) period = PERIOD_LIMIT;
+		if (period < stats->min_period) stats->min_period = period;
+		if (period > stats->max_period) stats->max_period = period;
+
+		if (stats->count == 1) {
+			/* First period seeds the average */
+			stats->ewma_period = period << IDSTATS_EWMA_SHIFT;
+		}
+		else {
+			uint32_t mean = stats->ewma_period >> IDSTATS_EWMA_SHIFT;
+			uint32_t deviation = period > mean ? period - mean : mean - period;
+			stats->ewma_period = stats->ewma_period - mean + period;
+			stats->ewma_jitter = stats->ewma_jitter - (stats->ewma_jitter >> IDSTATS_EWMA_SHIFT) + deviation;
+		}
+	}
+
+	stats->last_timestamp = timestamp;
+	stats->count++;
+}
+
+void idstats_auth(uint32_t id, uint8_t auth_ok) {
+	uint8_t slot = idmap_lookup(id);
+
+	if (slot == IDMAP_NO_SLOT) {
+		return;
+	}
+
+	if (auth_ok) {
+		table[slot].auth_ok++;
+	}
+	else {
+		table[slot].auth_fail++;
+	}
+}
+
+const IdStats *idstats_get(uint32_t id) {
+	uint8_t slot = idmap_lookup(id);
+
+	if (slot == IDMAP_NO_SLOT) {
+		return NULL;
+	}
+	return &table[slot];
+}
+
+void idstats_print() {
+	printf("ID count auth_ok auth_fail dlc_err min_us max_us avg_us jitter_us\r\n");
+
+	for (uint8_t slot = 0; slot < idmap_count(); slot++) {
+		IdStats *stats = &table[slot];
+		uint8_t has_period = stats->count > 1;
+
+		printf(
+			"%03X %u %u %u %u %u %u %u %u\r\n",
+			(unsigned int) idmap_id(slot),
+			(unsigned int) stats->count,
+			(unsigned int) stats->auth_ok,
+			(unsigned int) stats->auth_fail,
+			(unsigned int) stats->dlc_mismatch,
+			(unsigned int) (has_period ? fdcan_timestamp_to_usec(stats->min_period) : 0),
+			(unsigned int) fdcan_timestamp_to_usec(stats->max_period),
+			(unsigned int) fdcan_timestamp_to_usec(stats->ewma_period >> IDSTATS_EWMA_SHIFT),
+			(unsigned int) fdcan_timestamp_to_usec(stats->ewma_jitter >> IDSTATS_EWMA_SHIFT)
+		);
+	}
+
+	if (overflow_count) {
+		printf("overflow %u\r\n", (unsigned int) overflow_count);
+	}
+}
@@ -58,6 +58,9 @@ static void MX_USART1_UART_Init(void);
 /* USER CODE BEGIN PFP */
 
 void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs);
+void HAL_FDCAN_TimestampWraparoundCallback(FDCAN_HandleTypeDef *hfdcan);
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart);
 
 /* USER CODE END PFP */
 
@@ -185,9 +188,9 @@ static void MX_FDCAN1_Init(void)
 	hfdcan1.Init.NominalTimeSeg1 = 26;
 	hfdcan1.Init.NominalTimeSeg2 = 5;
 	hfdcan1.Init.DataPrescaler = 1;
-	hfdcan1.Init.DataSyncJumpWidth = 5;
-	hfdcan1.Init.DataTimeSeg1 = 26;
-	hfdcan1.Init.DataTimeSeg2 = 5;
+	hfdcan1.Init.DataSyncJumpWidth = 1;
+	hfdcan1.Init.DataTimeSeg1 = 2;
+	hfdcan1.Init.DataTimeSeg2 = 1;
 	hfdcan1.Init.StdFiltersNbr = 2;
 	hfdcan1.Init.ExtFiltersNbr = 0;
 	hfdcan1.Init.TxFifoQueueMode = FDCAN_TX_FIFO_OPERATION;
@@ -299,6 +302,21 @@ void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs)
 	fdcan_rx_callback(hfdcan, RxFifo0ITs);
 }
 
+void HAL_FDCAN_TimestampWraparoundCallback(FDCAN_HandleTypeDef *hfdcan)
+{
+	fdcan_timestamp_wrap_callback(hfdcan);
+}
+
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+	uart_rx_callback(huart);
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+	uart_error_callback(huart);
+}
+
 /* USER CODE END 4 */
 
 /**
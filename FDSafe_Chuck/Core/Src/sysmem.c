@@ -23,6 +23,46 @@
 /* Includes */
 #include <errno.h>
 #include <stdint.h>
+#include "main.h"
+#include <newlib.h>
+#include "ram.h"
+
+#if HEAPLESS
+
+/* newlib-nano (reduced reentrancy structure) before 4.3 allocates the stdio
+ * streams on the first stdio call, setvbuf() included: _sbrk() would stop
+ * the node at boot. From 4.3 the streams are static. */
+#if defined(_WANT_REENT_SMALL) && (__NEWLIB__ < 4 || (__NEWLIB__ == 4 && __NEWLIB_MINOR__ < 3))
+#error "The heapless build needs newlib 4.3 or later (static stdio streams), or HEAPLESS 0 in ram.h"
+#endif
+
+extern int __io_putchar(int ch);
+
+/**
+ * @brief _sbrk() of the heapless build: any allocation (malloc or a stdio
+ *        buffer) is a bug, so it is reported and the node stops
+ *
+ * The message is written character by character, printf could allocate again.
+ *
+ * @param incr Memory size
+ * @return (void *)-1 (never returns)
+ */
+void *_sbrk(ptrdiff_t incr)
+{
+  static const char message[] = "\r\n_sbrk: heap allocation in a heapless build\r\n";
+  (void)incr;
+
+  for (uint32_t i = 0; i < sizeof(message) - 1; i++)
+  {
+    __io_putchar(message[i]);
+  }
+  Error_Handler();
+
+  errno = ENOMEM;
+  return (void *)-1;
+}
+
+#else
 
 /**
  * Pointer to the current high watermark of the heap usage
@@ -77,3 +117,5 @@ void *_sbrk(ptrdiff_t incr)
 
   return (void *)prev_heap_end;
 }
+
+#endif
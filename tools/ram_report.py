@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""
+Report the static RAM budget of an FDSafe build by subsystem.
+
+Every buffer is static (HEAPLESS in Core/Inc/ram.h) and the large ones are
+grouped in arenas by the RAM_* attributes. The linker script brackets each
+arena with _sram_<arena> / _eram_<arena> symbols, which are read back from
+the GNU ld map file written by the build (-Wl,-Map):
+
+    python3 tools/ram_report.py FDSafe_Bob/Debug/FDSafe_Bob.map
+
+It runs as the post-build step of the three projects and fails the build
+(exit status 1) when the SRAM or the CCM SRAM has less than --min-free bytes
+left, or when the build reserves a heap.
+"""
+
+import argparse
+import re
+import sys
+
+# Must match the arenas of Core/Inc/ram.h and the linker script
+ARENAS = ["rings", "crypto", "logs", "tables", "buffers"]
+
+SYMBOL = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+(\w+)\s*=")
+SECTION = re.compile(r"^(\.\w+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+))?(?:\s+load address.*)?\s*$")
+ADDRESS_SIZE = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)(?:\s+load address.*)?\s*$")
+REGION = re.compile(r"^(\w+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)")
+
+
+def parse_map(lines):
+    """Return (regions, sections, symbols) of a GNU ld map file"""
+    regions = {}
+    sections = {}
+    symbols = {}
+    in_memory = False
+    pending = None
+    for line in lines:
+        line = line.rstrip("\n")
+        if line.startswith("Memory Configuration"):
+            in_memory = True
+            continue
+        if line.startswith("Linker script and memory map"):
+            in_memory = False
+            continue
+        if in_memory:
+            match = REGION.match(line)
+            if match and match.group(1) != "Name":
+                regions[match.group(1)] = (int(match.group(2), 16), int(match.group(3), 16))
+            continue
+
+        # Long section names put the address and size on the next line
+        if pending is not None:
+            match = ADDRESS_SIZE.match(line)
+            if match:
+                sections[pending] = (int(match.group(1), 16), int(match.group(2), 16))
+            pending = None
+            continue
+
+        match = SECTION.match(line)
+        if match:
+            if match.group(2) is None:
+                pending = match.group(1)
+            else:
+                sections[match.group(1)] = (int(match.group(2), 16), int(match.group(3), 16))
+            continue
+
+        match = SYMBOL.match(line)
+        if match:
+            symbols[match.group(2)] = int(match.group(1), 16)
+    return regions, sections, symbols
+
+
+def size_of(sections, name):
+    return sections.get(name, (0, 0))[1]
+
+
+def row(name, size, total=None):
+    if total:
+        print("  %-22s %7d  %5.1f%%" % (name, size, 100.0 * size / total))
+    else:
+        print("  %-22s %7d" % (name, size))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("map", help="map file of the build")
+    parser.add_argument("--min-free", type=int, default=0, help="bytes that must stay free in each RAM (default 0)")
+    args = parser.parse_args()
+
+    with open(args.map, errors="replace") as f:
+        regions, sections, symbols = parse_map(f)
+
+    if "RAM" not in regions or ".bss" not in sections:
+        print("No RAM region or .bss section found in %s" % args.map)
+        return 1
+
+    ram = regions["RAM"][1]
+    bss = size_of(sections, ".bss")
+    data = size_of(sections, ".data")
+    heap = symbols.get("_Min_Heap_Size", 0)
+    stack = symbols.get("_Min_Stack_Size", size_of(sections, "._user_heap_stack") - heap)
+
+    print("SRAM (%d bytes)" % ram)
+    arenas = 0
+    for arena in ARENAS:
+        start = symbols.get("_sram_" + arena)
+        end = symbols.get("_eram_" + arena)
+        if start is None or end is None:
+            continue
+        row(arena, end - start, ram)
+        arenas += end - start
+    row("other .bss", bss - arenas, ram)
+    row(".data", data, ram)
+    row("heap", heap, ram)
+    row("stack (minimum)", stack, ram)
+    used = bss + data + heap + stack
+    print("  %-22s %7d  %5.1f%%" % ("used", used, 100.0 * used / ram))
+    print("  %-22s %7d" % ("free", ram - used))
+    status = 0
+    if ram - used < args.min_free:
+        print("Error: SRAM over budget (%d bytes free, %d required)" % (ram - used, args.min_free))
+        status = 1
+
+    if "CCMRAM" in regions:
+        ccm = regions["CCMRAM"][1]
+        code = size_of(sections, ".ccmram")
+        ccm_data = size_of(sections, ".ccmram_bss")
+        print("CCM SRAM (%d bytes)" % ccm)
+        row("code", code, ccm)
+        row("data", ccm_data, ccm)
+        print("  %-22s %7d" % ("free", ccm - code - ccm_data))
+        if ccm - code - ccm_data < args.min_free:
+            print("Error: CCM SRAM over budget (%d bytes free, %d required)" % (ccm - code - ccm_data, args.min_free))
+            status = 1
+
+    if heap:
+        print("Error: the build reserves %d bytes of heap" % heap)
+        status = 1
+    return status
+
+
+if __name__ == "__main__":
+    sys.exit(main())
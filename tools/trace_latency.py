@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""
+Reconstruct the per-frame latency breakdown from FDSafe trace dumps.
+
+The firmware prints the trace ring through UART as:
+
+    TRACE BEGIN <count> <SystemCoreClock>
+    T,<cycles>,<event>,<arg>
+    ...
+    TRACE END
+
+The records are printed a few per main loop iteration, so other output may
+come between them. Any other line of the serial log is ignored, so the whole
+capture can be given as input. Usage:
+
+    python3 tools/trace_latency.py bob_log.txt [--csv frames.csv]
+"""
+
+import argparse
+import sys
+
+# Must match TraceEvent in Core/Inc/trace.h
+RX_ISR = 0
+RX_DEQUEUE = 1
+DECRYPT_START = 2
+DECRYPT_END = 3
+DECODE = 4
+OUTPUT = 5
+ENCRYPT_START = 6
+ENCRYPT_END = 7
+TX_COMMIT = 8
+
+RX_STAGES = ["isr->dequeue", "dequeue->decrypt", "decrypt", "decrypt->decode", "decode->output", "total"]
+TX_STAGES = ["encrypt", "encrypt->commit", "total"]
+
+
+def parse_blocks(lines):
+    """Yield (clock, records) for every complete trace block"""
+    records = None
+    clock = 0
+    for line in lines:
+        line = line.strip()
+        if line.startswith("TRACE BEGIN"):
+            fields = line.split()
+            clock = int(fields[3]) if len(fields) > 3 else 0
+            records = []
+        elif line.startswith("TRACE END"):
+            if records is not None:
+                yield clock, records
+            records = None
+        elif records is not None and line.startswith("T,"):
+            try:
+                cycles, event, arg = (int(v) for v in line[2:].split(","))
+            except ValueError:
+                continue
+            records.append((cycles, event, arg))
+
+
+def delta(start, end):
+    """Cycle difference, taking the 32-bit counter wrap into account"""
+    return (end - start) & 0xFFFFFFFF
+
+
+def rx_frames(records):
+    """Group receiver records into frames, matching ISRs in FIFO order"""
+    isr_queue = []
+    frames = []
+    frame = None
+    for cycles, event, arg in records:
+        if event == RX_ISR:
+            isr_queue.append(cycles)
+        elif event == RX_DEQUEUE:
+            if frame is not None:
+                frames.append(frame)
+            frame = {"id": arg, RX_DEQUEUE: cycles}
+            if isr_queue:
+                frame[RX_ISR] = isr_queue.pop(0)
+        elif frame is not None and event in (DECRYPT_START, DECRYPT_END, DECODE, OUTPUT):
+            frame[event] = cycles
+            if event == DECRYPT_END:
+                frame["auth"] = arg
+            if event == OUTPUT:
+                frames.append(frame)
+                frame = None
+    if frame is not None:
+        frames.append(frame)
+
+    result = []
+    for f in frames:
+        stages = {}
+        start = f.get(RX_ISR, f[RX_DEQUEUE])
+        last = max((k for k in (RX_DEQUEUE, DECRYPT_START, DECRYPT_END, DECODE, OUTPUT) if k in f),
+                   key=lambda k: delta(start, f[k]))
+        if RX_ISR in f:
+            stages["isr->dequeue"] = delta(f[RX_ISR], f[RX_DEQUEUE])
+        if DECRYPT_START in f:
+            stages["dequeue->decrypt"] = delta(f[RX_DEQUEUE], f[DECRYPT_START])
+        if DECRYPT_START in f and DECRYPT_END in f:
+            stages["decrypt"] = delta(f[DECRYPT_START], f[DECRYPT_END])
+        if DECRYPT_END in f and DECODE in f:
+            stages["decrypt->decode"] = delta(f[DECRYPT_END], f[DECODE])
+        if DECODE in f and OUTPUT in f:
+            stages["decode->output"] = delta(f[DECODE], f[OUTPUT])
+        stages["total"] = delta(start, f[last])
+        result.append((f["id"], stages))
+    return result
+
+
+def tx_frames(records):
+    """Group transmitter records into frames, closed by the TX commit"""
+    result = []
+    frame = {}
+    for cycles, event, arg in records:
+        if event == ENCRYPT_START:
+            frame = {ENCRYPT_START: cycles}
+        elif event == ENCRYPT_END:
+            frame[ENCRYPT_END] = cycles
+        elif event == TX_COMMIT:
+            stages = {}
+            start = frame.get(ENCRYPT_START, cycles)
+            if ENCRYPT_START in frame and ENCRYPT_END in frame:
+                stages["encrypt"] = delta(frame[ENCRYPT_START], frame[ENCRYPT_END])
+                stages["encrypt->commit"] = delta(frame[ENCRYPT_END], cycles)
+            stages["total"] = delta(start, cycles)
+            result.append((arg, stages))
+            frame = {}
+    return result
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0
+    index = min(len(sorted_values) - 1, int(round(p / 100.0 * (len(sorted_values) - 1))))
+    return sorted_values[index]
+
+
+def report(title, frames, stage_names, clock):
+    print(title)
+    print("  %-18s %7s %9s %9s %9s %9s %9s" % ("stage", "count", "min", "p50", "p90", "p99", "max"))
+    unit = 1e6 / clock if clock else None
+    for name in stage_names:
+        values = sorted(s[name] for _, s in frames if name in s)
+        if not values:
+            continue
+        row = [values[0], percentile(values, 50), percentile(values, 90), percentile(values, 99), values[-1]]
+        print("  %-18s %7d %9d %9d %9d %9d %9d  cycles" % ((name, len(values)) + tuple(row)))
+        if unit:
+            print("  %-18s %7s %9.2f %9.2f %9.2f %9.2f %9.2f  us" % (("", "") + tuple(v * unit for v in row)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", nargs="?", help="serial log file (default: stdin)")
+    parser.add_argument("--csv", help="write the per-frame breakdown (in cycles) to this file")
+    args = parser.parse_args()
+
+    lines = open(args.log, errors="replace") if args.log else sys.stdin
+    rx, tx = [], []
+    clock = 0
+    for block_clock, records in parse_blocks(lines):
+        clock = block_clock or clock
+        rx += rx_frames(records)
+        tx += tx_frames(records)
+
+    if not rx and not tx:
+        print("No trace records found")
+        return 1
+
+    if rx:
+        report("Receive path (%d frames)" % len(rx), rx, RX_STAGES, clock)
+    if tx:
+        report("Transmit path (%d frames)" % len(tx), tx, TX_STAGES, clock)
+
+    if args.csv:
+        with open(args.csv, "w") as out:
+            names = RX_STAGES if rx else TX_STAGES
+            out.write("id," + ",".join(names) + "\n")
+            for frame_id, stages in (rx or tx):
+                out.write("%X," % frame_id + ",".join(str(stages.get(n, "")) for n in names) + "\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())